@@ -139,6 +139,18 @@ PYBIND11_MODULE(_broker, m) {
          [](broker::optional<topic_data_pair>& i) { return *i; })
     .def("__repr__", [](const broker::optional<topic_data_pair>& i) { return to_string(i); });
 
+  using subscriber_buffer = std::vector<subscriber_base::value_type>;
+
+  py::class_<subscriber_buffer>(m, "SubscriberBuffer")
+    .def(py::init<>())
+    .def("__len__", [](const subscriber_buffer& xs) { return xs.size(); })
+    .def("__getitem__",
+         [](const subscriber_buffer& xs, size_t i) -> topic_data_pair {
+       if (i >= xs.size())
+         throw py::index_error();
+       return std::make_pair(broker::get_topic(xs[i]), broker::get_data(xs[i]));
+      });
+
   py::class_<subscriber_base>(m, "SubscriberBase")
     .def("get",
          [](subscriber_base& ep) -> topic_data_pair {
@@ -177,7 +189,31 @@ PYBIND11_MODULE(_broker, m) {
        return rval;
 	  })
 
-    .def("poll", &subscriber_base::poll)
+    .def("get_into",
+         [](subscriber_base& ep, subscriber_buffer& buf, size_t num) {
+       return ep.get(buf, num);
+      })
+
+    .def("get_into",
+         [](subscriber_base& ep, subscriber_buffer& buf, size_t num, double secs) {
+       return ep.get(buf, num, broker::to_duration(secs));
+      })
+
+    .def("poll",
+         [](subscriber_base& ep) -> std::vector<topic_data_pair> {
+       auto res = ep.poll();
+       std::vector<topic_data_pair> rval;
+       rval.reserve(res.size());
+       for ( auto& e : res )
+         rval.emplace_back(std::make_pair(broker::get_topic(e), broker::get_data(e)));
+       return rval;
+      })
+
+    .def("poll_into",
+         [](subscriber_base& ep, subscriber_buffer& buf) {
+       return ep.poll(buf);
+      })
+
     .def("available", &subscriber_base::available)
     .def("fd", &subscriber_base::fd);
 
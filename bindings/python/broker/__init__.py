@@ -113,6 +113,29 @@ def _make_topics(ts):
 
     return _broker.VectorTopic(ts)
 
+# Reusable storage for receiving messages in batches. Subscribers fill the
+# buffer in place, which avoids allocating a new container for each batch.
+class SubscriberBuffer:
+    def __init__(self):
+        self._buffer = _broker.SubscriberBuffer()
+
+    def __len__(self):
+        return len(self._buffer)
+
+    def __getitem__(self, i):
+        if i < 0:
+            i += len(self._buffer)
+
+        if i < 0 or i >= len(self._buffer):
+            raise IndexError("SubscriberBuffer index out of range")
+
+        (t, d) = self._buffer[i]
+        return (t.string(), Data.to_py(d))
+
+    def __iter__(self):
+        for i in range(len(self._buffer)):
+            yield self[i]
+
 # This class does not derive from the internal class because we
 # need to pass in existign instances. That means we need to
 # wrap all methods, even those that just reuse the internal
@@ -145,6 +168,19 @@ class Subscriber:
         msgs = self._subscriber.poll()
         return [(d[0].string(), Data.to_py(d[1])) for d in msgs]
 
+    def get_into(self, buf, num, timeout=None):
+        """Fills the SubscriberBuffer buf with num messages, replacing its
+        previous content. Returns fewer messages only on timeout."""
+        if timeout is None:
+            return self._subscriber.get_into(buf._buffer, num)
+
+        return self._subscriber.get_into(buf._buffer, num, timeout)
+
+    def poll_into(self, buf):
+        """Moves all available messages into the SubscriberBuffer buf without
+        blocking, replacing its previous content."""
+        return self._subscriber.poll_into(buf._buffer)
+
     def available(self):
         return self._subscriber.available()
 
@@ -50,6 +50,7 @@ using write = caf::atom_constant<caf::atom("write")>;
 
 /// --- communication with workers ---------------------------------------------
 
+using flush = caf::atom_constant<caf::atom("flush")>;
 using resume = caf::atom_constant<caf::atom("resume")>;
 
 /// --- communication with stores ----------------------------------------------
@@ -75,6 +76,8 @@ using sync_point = caf::atom_constant<caf::atom("sync_point")>;
 /// --- communciation with core actor ------------------------------------------
 
 using no_events = caf::atom_constant<caf::atom("noEvents")>;
+using shard = caf::atom_constant<caf::atom("shard")>;
+using stats = caf::atom_constant<caf::atom("stats")>;
 using subscriptions = caf::atom_constant<caf::atom("subs")>;
 using snapshot = caf::atom_constant<caf::atom("snapshot")>;
 
@@ -80,8 +80,7 @@ struct core_state {
   void emit_error(caf::actor hdl, const char* msg) {
     auto emit = [=](network_info x) {
       BROKER_INFO("error" << ErrorCode << x);
-      self->send(
-        errors_, atom::local::value,
+      report_error(
         make_error(ErrorCode, endpoint_info{hdl.node(), std::move(x)}, msg));
     };
     if (self->node() != hdl.node())
@@ -104,12 +103,14 @@ struct core_state {
       emit_error<ErrorCode>(std::move(*x), msg);
     else {
       BROKER_INFO("error" << ErrorCode << inf);
-      self->send(
-        errors_, atom::local::value,
-        make_error(ErrorCode, endpoint_info{node_id(), inf}, msg));
+      report_error(make_error(ErrorCode, endpoint_info{node_id(), inf}, msg));
     }
   }
 
+  /// Sends `err` to the error group of the endpoint. Secondary shards have no
+  /// group of their own and forward `err` to the primary core instead.
+  void report_error(caf::error err);
+
   template <sc StatusCode>
   void emit_status(caf::actor hdl, const char* msg) {
     static_assert(StatusCode != sc::peer_added,
@@ -137,6 +138,45 @@ struct core_state {
 
   void sync_with_status_subscribers(caf::actor new_peer);
 
+  // --- sharding --------------------------------------------------------------
+
+  /// Asks `peer_hdl` for its secondary shards and peers each of our secondary
+  /// shards with its remote counterpart. Delivers `peer_hdl` to `rp` once all
+  /// shards have peered successfully.
+  void peer_shards(caf::actor peer_hdl, caf::response_promise rp);
+
+  /// Asks `peer_hdl` for the ports of its stripes and lets each of our
+  /// secondary shards connect to its remote counterpart over a separate
+  /// connection. Delivers `peer_hdl` to `rp` once all stripes have peered
+  /// successfully.
+  void peer_stripes(caf::actor peer_hdl, caf::response_promise rp);
+
+  /// Sends `atom::peer` with `targets[i]` to shard `i` for all shards.
+  template <class T>
+  void connect_shards(caf::actor peer_hdl, std::vector<T> targets,
+                      caf::response_promise rp);
+
+  /// Drops `peer_hdl` after failing to connect our shards.
+  void abort_shard_peering(const caf::actor& peer_hdl,
+                           caf::response_promise& rp, caf::error err);
+
+  /// Tells each of our secondary shards to unpeer from its counterpart at
+  /// `peer_hdl`.
+  void unpeer_shards(const caf::actor& peer_hdl);
+
+  /// Returns the shard layout that we announce in peering handshakes.
+  detail::shard_layout shard_layout() const;
+
+  /// Checks whether `peer_layout` matches our own shard layout. On a
+  /// mismatch, rejects the peering on both sides.
+  /// @returns `true` if the layouts match, `false` otherwise.
+  bool check_shard_layout(const caf::actor& peer_hdl,
+                          detail::shard_layout peer_layout);
+
+  /// Drops all state for `peer_hdl` after the peering failed during the
+  /// handshake and reports `err`.
+  void reject_peer(const caf::actor& peer_hdl, caf::error err);
+
   // --- member variables ------------------------------------------------------
 
   /// A copy of the current Broker configuration options.
@@ -193,10 +233,44 @@ struct core_state {
 
   /// Handle for recording all peers (if enabled).
   std::ofstream peers_file;
+
+  /// Set to `true` for all but the first core actor of a sharded endpoint.
+  /// Secondary shards neither record meta data nor emit status events, since
+  /// the primary core already reports the status of each peering. Errors go
+  /// to the primary core.
+  bool secondary = false;
+
+  /// Points to the first core actor of the endpoint. Only secondary shards
+  /// have a valid handle.
+  caf::actor primary;
+
+  /// Stores the secondary shards of this endpoint. Only the first core actor
+  /// of a sharded endpoint has a non-empty list.
+  std::vector<caf::actor> shards;
+
+  /// Maps peers to their secondary shards.
+  std::unordered_map<caf::actor, std::vector<caf::actor>> shard_peers;
+
+  /// Set to `true` if the secondary shards run in separate actor systems
+  /// with their own connections (see `broker.peer-stripes`).
+  bool striped = false;
+
+  /// Stores the ports of the secondary shards. Only the first core actor of
+  /// a striped endpoint has a non-empty list, once the endpoint listens.
+  std::vector<uint16_t> stripe_ports;
 };
 
 caf::behavior core_actor(caf::stateful_actor<core_state>* self,
                          filter_type initial_filter, broker_options opts,
                          endpoint::clock* clock);
 
+/// Spawns a secondary core actor for a sharded endpoint. Each shard routes a
+/// disjoint subset of all topics and peers only with the shard at the same
+/// position on the remote side. Hence, all messages for a given topic travel
+/// along the same sequence of core actors.
+/// Secondary shards report their errors to `primary`.
+caf::behavior core_shard_actor(caf::stateful_actor<core_state>* self,
+                               broker_options opts, endpoint::clock* clock,
+                               caf::actor primary);
+
 } // namespace broker
@@ -2,6 +2,8 @@
 
 #include "caf/string_view.hpp"
 
+#include "broker/time.hh"
+
 // This header contains hard-coded default values for various Broker options.
 
 namespace broker {
@@ -11,5 +13,31 @@ extern const caf::string_view recording_directory;
 
 extern const size_t output_generator_file_cap;
 
+extern const bool topic_dictionary;
+
+extern const bool compact_data;
+
+extern const caf::string_view compression;
+
+extern const size_t compression_threshold;
+
+extern const size_t core_shards;
+
+extern const bool local_delivery;
+
+extern const size_t peer_stripes;
+
+extern const bool deduplicate;
+
+extern const size_t command_log_size;
+
+extern const size_t group_commit_size;
+
+extern const timespan group_commit_interval;
+
+extern const timespan expiry_interval;
+
+extern const size_t snapshot_pending_updates;
+
 } // namespace defaults
 } // namespace broker
@@ -6,6 +6,8 @@
 #include "broker/snapshot.hh"
 
 #include <deque>
+#include <memory>
+#include <vector>
 
 namespace broker {
 namespace detail {
@@ -13,6 +15,23 @@ namespace detail {
 using expirable = std::pair<broker::data, timestamp>;
 using expirables = std::deque<expirable>;
 
+/// Iterates over all key-value pairs of a backend without materializing the
+/// entire store. Unless the backend has isolated cursors, a cursor remains
+/// valid only as long as nobody modifies the backend. A cursor must never
+/// outlive its backend.
+class snapshot_cursor {
+public:
+  virtual ~snapshot_cursor() = default;
+
+  /// Appends up to `n` key-value pairs to `xs`.
+  /// @returns `false` if the cursor reached the end of the store, `true` if
+  ///          more key-value pairs may follow.
+  virtual expected<bool> next(std::vector<snapshot_entry>& xs, size_t n) = 0;
+};
+
+/// Owning smart pointer to a cursor.
+using snapshot_cursor_ptr = std::unique_ptr<snapshot_cursor>;
+
 /// Abstract base class for a key-value storage backend.
 class abstract_backend {
 public:
@@ -69,6 +88,15 @@ public:
   virtual expected<bool> expire(const data& key,
                                 timestamp current_time) = 0;
 
+  /// Expires multiple keys at once. The default implementation calls
+  /// `expire` for each key.
+  /// @param keys The keys to expire.
+  /// @param current_time The time used to compare whether to actual
+  /// expire the given keys.
+  /// @returns the keys that were expired (and deleted) successfully.
+  virtual expected<std::vector<data>> bulk_expire(const std::vector<data>& keys,
+                                                  timestamp current_time);
+
   // --- inspectors -----------------------------------------------------------
 
   /// Retrieves the value associated with a given key.
@@ -100,8 +128,31 @@ public:
   /// @returns A snapshot of the store that includes its content.
   virtual expected<broker::snapshot> snapshot() const = 0;
 
+  /// Creates a cursor for retrieving all key-value pairs in chunks. The
+  /// default implementation iterates over the result of `snapshot()`.
+  /// @returns A cursor that points to the first key-value pair.
+  virtual expected<snapshot_cursor_ptr> cursor() const;
+
+  /// Checks whether cursors read from a snapshot of the backend, i.e.,
+  /// whether later modifications remain invisible to existing cursors. The
+  /// default implementation returns `true`, because the default cursor
+  /// materializes the entire store.
+  virtual bool cursor_is_isolated() const;
+
   /// @returns the set of all keys that have expiry times.
   virtual expected<expirables> expiries() const = 0;
+
+  // --- transactions ---------------------------------------------------------
+
+  /// Groups all following modifications until the next call to
+  /// `commit_transaction` into a single transaction. Backends without
+  /// transaction support ignore this hint.
+  /// @returns `nil` on success.
+  virtual expected<void> begin_transaction();
+
+  /// Commits all modifications since the last call to `begin_transaction`.
+  /// @returns `nil` on success or if no transaction is open.
+  virtual expected<void> commit_transaction();
 };
 
 } // namespace detail
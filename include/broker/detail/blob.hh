@@ -6,6 +6,11 @@
 #include <caf/stream_deserializer.hpp>
 #include <caf/stream_serializer.hpp>
 
+#include "broker/data.hh"
+#include "broker/detail/data_codec.hh"
+#include "broker/error.hh"
+#include "broker/expected.hh"
+
 namespace broker {
 namespace detail {
 
@@ -33,5 +38,41 @@ T from_blob(const std::string& str) {
   return from_blob<T>(str.data(), str.size());
 }
 
+/// Marks blobs that use the compact codec. Legacy blobs start with the type
+/// index of the variant, which never reaches this value.
+constexpr char compact_blob_marker = static_cast<char>(0x80
+                                                       | data_codec_version);
+
+/// Serializes a value for storing it in a backend.
+inline std::string to_data_blob(const data& x) {
+  std::string buf;
+  buf += compact_blob_marker;
+  compact_encode(x, buf);
+  return buf;
+}
+
+/// Deserializes a value from a backend. Accepts blobs from `to_data_blob` as
+/// well as blobs from `to_blob` that previous versions have stored.
+/// @returns the value or `ec::backend_failure` if the blob is corrupt.
+inline expected<data> from_data_blob(const void* buf, size_t size) {
+  auto bytes = static_cast<const char*>(buf);
+  data result;
+  if (size == 0 || bytes[0] != compact_blob_marker) {
+    auto ptr = const_cast<char*>(bytes);
+    caf::arraybuf<char> sb{ptr, size};
+    caf::stream_deserializer<caf::arraybuf<char>&> source{sb};
+    if (auto err = source(result))
+      return ec::backend_failure;
+    return result;
+  }
+  if (!compact_decode(bytes + 1, size - 1, result))
+    return ec::backend_failure;
+  return result;
+}
+
+inline expected<data> from_data_blob(const std::string& str) {
+  return from_data_blob(str.data(), str.size());
+}
+
 } // namespace detail
 } // namespace broker
@@ -41,6 +41,9 @@ public:
 
   void command(internal_command& cmd);
 
+  /// Applies an update from the master and remembers its sequence number.
+  void apply(internal_command& cmd);
+
   void operator()(none);
 
   void operator()(put_command&);
@@ -61,6 +64,10 @@ public:
 
   void operator()(clear_command&);
 
+  /// Applies all updates that arrived while waiting for the snapshot, unless
+  /// the clone still waits for its sync point.
+  void snapshot_complete();
+
   data keys() const;
 
   caf::event_based_actor* self;
@@ -89,6 +96,14 @@ public:
 
   bool awaiting_snapshot_sync;
 
+  /// Sequence number of the last update from the master that this clone has
+  /// applied or 0 if unknown.
+  uint64_t last_seq;
+
+  /// Master that `last_seq` refers to. Reconnecting to the same master only
+  /// requires the updates after `last_seq` instead of a full snapshot.
+  caf::actor_addr last_master;
+
   endpoint::clock* clock;
 };
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+namespace broker {
+namespace detail {
+
+// Building blocks for the compact encodings of ::data (see data_codec.hh) and
+// of `zeek::LogWriteBatch`.
+
+/// Prefix of IPv4-mapped IPv6 addresses.
+inline constexpr uint8_t v4_mapped_prefix[] = {0, 0, 0, 0, 0,    0,
+                                               0, 0, 0, 0, 0xff, 0xff};
+
+/// Maps signed integers to unsigned integers such that values close to zero
+/// have a short varint encoding.
+inline uint64_t zig_zag(int64_t x) {
+  return (static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63);
+}
+
+/// Reverses `zig_zag`.
+inline int64_t unzig_zag(uint64_t x) {
+  return static_cast<int64_t>(x >> 1) ^ -static_cast<int64_t>(x & 1);
+}
+
+/// Appends `x` to `buf` in 7-bit groups, least significant group first. All
+/// bytes but the last have the most significant bit set.
+template <class Buffer>
+void put_varint(Buffer& buf, uint64_t x) {
+  while (x >= 0x80) {
+    buf.push_back(static_cast<char>(x | 0x80));
+    x >>= 7;
+  }
+  buf.push_back(static_cast<char>(x));
+}
+
+/// Reads a varint from the range `[first, last)` into `x`.
+/// @returns a pointer to the first byte after the varint or `nullptr` if the
+///          range ends early or the varint exceeds 64 bits.
+inline const char* get_varint(const char* first, const char* last,
+                              uint64_t& x) {
+  x = 0;
+  for (int shift = 0; shift < 64 && first != last; shift += 7) {
+    auto byte = static_cast<uint8_t>(*first++);
+    x |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return first;
+  }
+  return nullptr;
+}
+
+} // namespace detail
+} // namespace broker
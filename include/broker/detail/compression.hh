@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace broker {
+namespace detail {
+
+/// Selects the algorithm for compressing payloads on peer paths.
+enum class compression_method : uint8_t {
+  /// Sends payloads uncompressed.
+  none,
+  /// Built-in LZ77 codec that favors speed over compression ratio.
+  lz,
+  /// Deflate via zlib, if available.
+  zlib,
+};
+
+/// Number of values in ::compression_method.
+constexpr size_t num_compression_methods = 3;
+
+/// Returns whether this build of Broker supports `x`.
+bool compression_available(compression_method x);
+
+/// Appends the compressed form of `[first, first + size)` to `out`.
+/// @returns `false` if `method` is not available, `true` otherwise.
+bool compress(compression_method method, const char* first, size_t size,
+              std::vector<char>& out);
+
+/// Appends `raw_size` bytes of decompressed output for `[first, first + size)`
+/// to `out`.
+/// @returns `false` if the input is malformed or does not decompress to
+///          exactly `raw_size` bytes, `true` otherwise.
+bool decompress(compression_method method, const char* first, size_t size,
+                size_t raw_size, std::vector<char>& out);
+
+/// @relates compression_method
+bool convert(const std::string& str, compression_method& x);
+
+/// @relates compression_method
+const char* to_string(compression_method x);
+
+} // namespace detail
+} // namespace broker
@@ -13,11 +13,17 @@
 #include <caf/fused_downstream_manager.hpp>
 #include <caf/fwd.hpp>
 #include <caf/message.hpp>
+#include <caf/node_id.hpp>
 #include <caf/stream_slot.hpp>
 
 #include "broker/data.hh"
 #include "broker/detail/assert.hh"
+#include "broker/detail/core_stats.hh"
+#include "broker/detail/dedup_table.hh"
 #include "broker/detail/generator_file_writer.hh"
+#include "broker/detail/peer_features.hh"
+#include "broker/detail/routing_table.hh"
+#include "broker/detail/topic_dictionary.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal_command.hh"
 #include "broker/logger.hh"
@@ -84,17 +90,21 @@ public:
     = caf::fused_downstream_manager<peer_trait::manager, worker_trait::manager,
                                     store_trait::manager>;
 
-  /// Stream handshake in step 1 that includes our own filter. The receiver
-  /// replies with a step2 handshake.
+  /// Stream handshake in step 1 that includes our own filter, protocol
+  /// features and shard layout. The receiver replies with a step2 handshake.
   using step1_handshake = caf::outbound_stream_slot<node_message,
                                                     filter_type,
-                                                    caf::actor>;
+                                                    caf::actor,
+                                                    peer_features,
+                                                    shard_layout>;
 
-  /// Stream handshake in step 2. The receiver already has our filter
-  /// installed.
+  /// Stream handshake in step 2 that includes our protocol features and shard
+  /// layout. The receiver already has our filter installed.
   using step2_handshake = caf::outbound_stream_slot<node_message,
                                                     caf::atom_value,
-                                                    caf::actor>;
+                                                    caf::actor,
+                                                    peer_features,
+                                                    shard_layout>;
 
   core_policy(caf::detail::stream_distribution_tree<core_policy>* parent,
               core_state* state, filter_type filter);
@@ -184,6 +194,7 @@ public:
     auto slot = add(send_own_filter_token, peer_hdl);
     // Make sure the peer receives the correct traffic.
     out().assign<peer_trait::manager>(slot);
+    peer_routes_.set(slot, peer_filter);
     peers().set_filter(slot,
                        std::make_pair(peer_hdl.address(),
                                       std::move(peer_filter)));
@@ -199,6 +210,26 @@ public:
   void ack_peering(const caf::stream<node_message>& in,
                    const caf::actor& peer_hdl);
 
+  /// Enables all protocol features on the outbound path to `peer_hdl` that
+  /// both sides support (step #2/3 in core_actor.cc).
+  /// @param peer_hdl Handle to the peering (remote) core actor.
+  /// @param features Features announced by the peer in its handshake.
+  void negotiate(const caf::actor& peer_hdl, peer_features features);
+
+  /// Returns traffic counters for peer paths.
+  const core_stats& stats() const noexcept {
+    return stats_;
+  }
+
+  /// Returns compression counters for each peer.
+  std::vector<std::pair<caf::node_id, compression_stats>>
+  compression_stats_by_peer() const;
+
+  /// Returns the protocol features that this endpoint supports.
+  peer_features features() const noexcept {
+    return features_;
+  }
+
   /// Queries whether we have an outbound path to `hdl`.
   bool has_outbound_path_to(const caf::actor& peer_hdl);
 
@@ -226,6 +257,12 @@ public:
   caf::outbound_stream_slot<store_trait::element>
   add_store(filter_type filter);
 
+  /// Sets the filter of the worker at `slot`.
+  void set_worker_filter(caf::stream_slot slot, filter_type filter);
+
+  /// Sets the filter of the store at `slot`.
+  void set_store_filter(caf::stream_slot slot, filter_type filter);
+
   // -- selectively pushing data into the streams ------------------------------
 
   /// Pushes data to workers without forwarding it to peers.
@@ -334,13 +371,13 @@ private:
       auto ttl0 = initial_ttl();
       auto push_unrecorded = [&](iterator_type first, iterator_type last) {
         for (auto i = first; i != last; ++i)
-          peers().push(make_node_message(std::move(*i), ttl0));
+          route(peers(), peer_routes_, make_own_message(std::move(*i), ttl0));
       };
       auto push_recorded = [&](iterator_type first, iterator_type last) {
         for (auto i = first; i != last; ++i) {
           if (!try_record(*i))
             return i;
-          peers().push(make_node_message(std::move(*i), ttl0));
+          route(peers(), peer_routes_, make_own_message(std::move(*i), ttl0));
         }
         return last;
       };
@@ -361,9 +398,146 @@ private:
     return false;
   }
 
+  /// Returns whether `f` belongs to the peer that sent the current batch.
+  bool is_active_sender(const peer_filter& f) const {
+    return f.first == peers().selector().active_sender;
+  }
+
+  /// Local actors never send batches to the core via their own path.
+  bool is_active_sender(const filter_type&) const {
+    return false;
+  }
+
+  /// Calls `f(slot, path, buf)` for each path of `mgr` that subscribed to
+  /// `t` according to `routes`, where `buf` is the buffer of the path. Skips
+  /// closing paths and the path back to the sender of the current batch.
+  template <class Manager, class F>
+  void for_each_target(Manager& mgr, routing_table& routes, const topic& t,
+                       F f) {
+    auto& slots = routes.match(t);
+    if (slots.empty())
+      return;
+    std::vector<caf::stream_slot> stale;
+    auto& states = mgr.states();
+    for (auto slot : slots) {
+      auto i = states.find(slot);
+      if (i == states.end()) {
+        // The manager dropped the path without telling us.
+        stale.emplace_back(slot);
+        continue;
+      }
+      auto ptr = mgr.path(slot);
+      if (ptr == nullptr || ptr->closing || is_active_sender(i->second.filter))
+        continue;
+      f(slot, *ptr, i->second.buf);
+    }
+    for (auto slot : stale)
+      routes.erase(slot);
+  }
+
+  /// Pushes `x` directly into the buffer of each path that subscribed to its
+  /// topic according to `routes`. Bypasses the central buffer of `mgr` and
+  /// thus its linear scan over all filters.
+  template <class Manager, class T>
+  void route(Manager& mgr, routing_table& routes, T x) {
+    payload_buffer_set payloads;
+    auto f = [&](caf::stream_slot slot, const caf::outbound_path& path,
+                 auto& buf) {
+      buf.emplace_back(x);
+      if (!share_payload(slot, path, buf.back(), payloads)) {
+        buf.pop_back();
+        return;
+      }
+      encode(slot, buf.back());
+    };
+    for_each_target(mgr, routes, get_topic(x), f);
+  }
+
+  /// An output path to a peer that receives messages on some topic.
+  struct peer_target {
+    caf::stream_slot slot;
+    const caf::outbound_path* path;
+    peer_trait::batch* buf;
+  };
+
+  /// Routing decision for all messages on one topic in a batch from a peer.
+  struct batch_route {
+    /// Buffers of local workers that subscribed to the topic.
+    std::vector<worker_trait::batch*> workers;
+
+    /// Output paths of other peers that subscribed to the topic.
+    std::vector<peer_target> peers;
+
+    /// Whether the core forwards messages on this topic to other peers.
+    bool forward = false;
+  };
+
+  /// Dispatches a batch from a peer to local workers, stores and other peers.
+  /// Handles runs of messages with the same topic in one go and computes the
+  /// targets only once per distinct topic.
+  void handle_peer_batch(caf::stream_slot slot, peer_trait::batch& xs);
+
+  /// Returns the routing decision for topic `t` in the current batch.
+  batch_route& batch_route_for(const topic& t, bool forward);
+
+  /// Delivers the data messages in `[first, last)` to local workers.
+  void deliver_run(const batch_route& r, peer_trait::batch::iterator first,
+                   peer_trait::batch::iterator last);
+
+  /// Decrements the TTL of all messages in `[first, last)` and pushes them
+  /// to other peers, one output path at a time.
+  void forward_run(const batch_route& r, peer_trait::batch::iterator first,
+                   peer_trait::batch::iterator last);
+
+  /// Attaches a payload buffer in the negotiated encoding of `slot` to `x` if
+  /// `path` leads to a remote peer. Serializes and compresses the data only
+  /// if `cache` has no buffer in that encoding yet, i.e., all copies of a
+  /// message that the core pushes to other paths share one buffer per
+  /// encoding.
+  /// @returns `false` if `x` cannot be encoded, `true` otherwise.
+  bool share_payload(caf::stream_slot slot, const caf::outbound_path& path,
+                     node_message& x, payload_buffer_set& cache);
+
+  /// Local actors receive messages as-is.
+  template <class T>
+  bool share_payload(caf::stream_slot, const caf::outbound_path&, T&,
+                     payload_buffer_set&) {
+    return true;
+  }
+
+  /// Prepares `x` for transmission on the peer path `slot`.
+  void encode(caf::stream_slot slot, node_message& x);
+
+  /// Local actors receive messages as-is.
+  template <class T>
+  void encode(caf::stream_slot, T&) {
+    // nop
+  }
+
+  /// Restores `x` after receiving it on the peer path `slot`.
+  /// @returns `false` if `x` is malformed, `true` otherwise.
+  bool decode(caf::stream_slot slot, node_message& x);
+
   /// Returns the initial TTL value when publishing data.
   ttl initial_ttl() const;
 
+  /// Wraps `content` into a ::node_message that originates at this core.
+  /// Assigns the next message ID if the core drops duplicates.
+  template <class T>
+  node_message make_own_message(T&& content, uint16_t ttl) {
+    auto result = make_node_message(std::forward<T>(content), ttl);
+    if ((features_ & message_id_feature) != 0) {
+      result.origin = origin_;
+      result.seq = ++next_seq_;
+    }
+    return result;
+  }
+
+  /// Checks whether the core has seen `x` before, i.e., whether `x` is a
+  /// message that this core published or a message with an ID that
+  /// `dedup_` already contains. Updates `dedup_` and the counters.
+  bool is_duplicate(const node_message& x);
+
   /// Adds entries to `peer_to_ipath_` and `ipath_to_peer_`.
   void add_ipath(caf::stream_slot slot, const caf::actor& peer_hdl);
 
@@ -407,6 +581,59 @@ private:
   /// Messages that are currently buffered.
   std::unordered_map<caf::actor, std::vector<caf::message>> blocked_msgs;
 
+  /// Maps topic prefixes to the output paths of peers.
+  routing_table peer_routes_;
+
+  /// Maps topic prefixes to the output paths of workers.
+  routing_table worker_routes_;
+
+  /// Maps topic prefixes to the output paths of stores.
+  routing_table store_routes_;
+
+  /// Protocol features that this endpoint supports.
+  peer_features features_;
+
+  /// Topic dictionaries for output paths to peers.
+  std::unordered_map<caf::stream_slot, topic_encoder> topic_encoders_;
+
+  /// Topic dictionaries for input paths from peers.
+  std::unordered_map<caf::stream_slot, topic_decoder> topic_decoders_;
+
+  /// Settings and counters for encoding data on an output path to a peer.
+  struct peer_encoding {
+    payload_format format = payload_format::binary;
+    compression_method compression = compression_method::none;
+    compression_stats stats;
+    bool message_ids = false;
+  };
+
+  /// Negotiated encodings for output paths to peers.
+  std::unordered_map<caf::stream_slot, peer_encoding> peer_encodings_;
+
+  /// Compresses payloads to peers that support this method.
+  compression_method compression_;
+
+  /// Payloads below this size remain uncompressed.
+  size_t compression_threshold_;
+
+  /// Traffic counters for peer paths.
+  core_stats stats_;
+
+  /// Identifies this core in the IDs of messages that it publishes.
+  uint64_t origin_;
+
+  /// Sequence number of the last message that this core published.
+  uint64_t next_seq_;
+
+  /// Message IDs that this core has received recently.
+  dedup_table dedup_;
+
+  /// Routing decisions for the batch from a peer that we currently handle.
+  std::unordered_map<topic, batch_route> batch_routes_;
+
+  /// Payload caches for the messages of a single run in `forward_run`.
+  std::vector<payload_buffer_set> batch_payloads_;
+
   /// Helper for recording meta data of published messages.
   detail::generator_file_writer_ptr recorder_;
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+#include <caf/meta/type_name.hpp>
+
+#include "broker/time.hh"
+
+namespace broker {
+namespace detail {
+
+/// Counters for the traffic that a core actor sends to its peers.
+struct core_stats {
+  /// Number of messages that the core serialized for remote peers.
+  uint64_t encoded_messages = 0;
+
+  /// Number of bytes that the core serialized for remote peers.
+  uint64_t encoded_bytes = 0;
+
+  /// Number of bytes that additional remote peers received without
+  /// serializing the same message again.
+  uint64_t shared_bytes = 0;
+
+  /// Number of messages from peers that the core deserialized for local
+  /// subscribers. Messages that the core only forwards remain serialized.
+  uint64_t decoded_messages = 0;
+
+  /// Number of messages from peers that the core dropped, because it has
+  /// received them before over a different path.
+  uint64_t suppressed_duplicates = 0;
+};
+
+/// Counters for compressing the traffic to a single peer.
+struct compression_stats {
+  /// Number of messages that the peer received compressed.
+  uint64_t compressed_messages = 0;
+
+  /// Number of messages that the peer received uncompressed, because they
+  /// were smaller than the configured threshold.
+  uint64_t skipped_messages = 0;
+
+  /// Size of the compressed messages before compression.
+  uint64_t raw_bytes = 0;
+
+  /// Size of the compressed messages after compression.
+  uint64_t compressed_bytes = 0;
+
+  /// Time the core spent compressing messages for this peer. Messages that
+  /// also go to other peers count only once.
+  timespan cpu_time{0};
+
+  /// Returns the ratio of raw to compressed bytes.
+  double ratio() const noexcept {
+    if (compressed_bytes == 0)
+      return 1.0;
+    return static_cast<double>(raw_bytes) / compressed_bytes;
+  }
+};
+
+/// @relates compression_stats
+template <class Inspector>
+typename Inspector::result_type inspect(Inspector& f, compression_stats& x) {
+  return f(caf::meta::type_name("compression_stats"), x.compressed_messages,
+           x.skipped_messages, x.raw_bytes, x.compressed_bytes, x.cpu_time);
+}
+
+/// @relates core_stats
+template <class Inspector>
+typename Inspector::result_type inspect(Inspector& f, core_stats& x) {
+  return f(caf::meta::type_name("core_stats"), x.encoded_messages,
+           x.encoded_bytes, x.shared_bytes, x.decoded_messages,
+           x.suppressed_duplicates);
+}
+
+} // namespace detail
+} // namespace broker
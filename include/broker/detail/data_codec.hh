@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "broker/data.hh"
+
+namespace broker {
+namespace detail {
+
+/// Version of the compact wire format for ::data. Peers announce support for
+/// this version via `compact_data_feature` in their handshakes.
+///
+/// Each value starts with a header byte. The lower four bits store the type
+/// and the upper four bits store a small integer: the value itself for
+/// booleans, counts and integers, the length for strings and enum values,
+/// the size for containers, the protocol for ports and the address family
+/// for addresses and subnets. If the small integer does not fit into four
+/// bits, the upper bits are all set and a varint with the remainder follows
+/// the header byte. Integers, timestamps and timespans use zig-zag encoding.
+constexpr uint8_t data_codec_version = 1;
+
+/// Appends the compact encoding of `x` to `buf`.
+void compact_encode(const data& x, std::vector<char>& buf);
+
+/// Appends the compact encoding of `x` to `buf`.
+void compact_encode(const data& x, std::string& buf);
+
+/// Decodes a single value from the range `[first, last)`.
+/// @returns a pointer to the first byte after the value or `nullptr` if the
+///          input is malformed.
+const char* compact_decode(const char* first, const char* last, data& x);
+
+/// Decodes `size` bytes at `buf` into `x`.
+/// @returns `true` if `buf` contains exactly one valid value.
+inline bool compact_decode(const void* buf, size_t size, data& x) {
+  auto first = static_cast<const char*>(buf);
+  auto last = first + size;
+  return compact_decode(first, last, x) == last;
+}
+
+} // namespace detail
+} // namespace broker
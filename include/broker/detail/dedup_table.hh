@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace broker {
+namespace detail {
+
+/// Remembers which messages a core has seen recently, identified by the
+/// origin of a message plus a sequence number that the origin increments for
+/// each message. Keeps one sliding window per origin that covers the last
+/// `window_size` sequence numbers. The table forgets about the least recently
+/// active origin once it tracks `max_origins` origins.
+class dedup_table {
+public:
+  /// Number of sequence numbers per window.
+  static constexpr size_t window_size = 1024;
+
+  /// Default for the maximum number of origins.
+  static constexpr size_t default_max_origins = 4096;
+
+  explicit dedup_table(size_t max_origins = default_max_origins);
+
+  /// Registers message `seq` from `origin`.
+  /// @returns `true` if the table has not seen the message before, `false`
+  ///          for duplicates. Messages that are older than the window of
+  ///          `origin` count as new, because the table cannot tell whether
+  ///          it has seen them.
+  bool insert(uint64_t origin, uint64_t seq);
+
+  /// Returns the number of known origins.
+  size_t size() const noexcept {
+    return windows_.size();
+  }
+
+private:
+  using word = uint64_t;
+
+  static constexpr size_t word_bits = 64;
+
+  struct window {
+    /// Highest sequence number seen so far.
+    uint64_t last;
+
+    /// Value of `ticks_` at the last insert for this origin.
+    uint64_t last_active;
+
+    /// Ring of bits, one for each sequence number in `(last - window_size,
+    /// last]`.
+    std::array<word, window_size / word_bits> bits;
+
+    bool test(uint64_t seq) const noexcept {
+      auto pos = seq % window_size;
+      return (bits[pos / word_bits] & (word{1} << (pos % word_bits))) != 0;
+    }
+
+    void set(uint64_t seq) noexcept {
+      auto pos = seq % window_size;
+      bits[pos / word_bits] |= word{1} << (pos % word_bits);
+    }
+
+    void reset(uint64_t seq) noexcept {
+      auto pos = seq % window_size;
+      bits[pos / word_bits] &= ~(word{1} << (pos % word_bits));
+    }
+  };
+
+  /// Drops the window of the least recently active origin.
+  void evict();
+
+  size_t max_origins_;
+
+  /// Counts calls to `insert` for finding idle origins.
+  uint64_t ticks_ = 0;
+
+  std::unordered_map<uint64_t, window> windows_;
+};
+
+} // namespace detail
+} // namespace broker
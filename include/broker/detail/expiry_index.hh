@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "broker/data.hh"
+#include "broker/optional.hh"
+#include "broker/time.hh"
+
+namespace broker {
+namespace detail {
+
+/// Keeps track of the next expiration time for each key of a store. Each key
+/// appears at most once, i.e., setting a new expiration time for a key
+/// replaces the previous one.
+class expiry_index {
+public:
+  /// Sets the expiration time of `key` to `expiry`.
+  void add(const data& key, timestamp expiry);
+
+  /// Removes `key` from the index.
+  void erase(const data& key);
+
+  /// Removes all keys from the index.
+  void clear();
+
+  /// Removes all keys with an expiration time at or before `now` from the
+  /// index.
+  /// @returns the removed keys, ordered by their expiration time.
+  std::vector<data> take_due(timestamp now);
+
+  /// Returns the earliest expiration time in the index, if any.
+  optional<timestamp> next() const;
+
+  /// Returns the number of keys in the index.
+  size_t size() const noexcept {
+    return deadlines_.size();
+  }
+
+  /// Checks whether the index contains no keys.
+  bool empty() const noexcept {
+    return deadlines_.empty();
+  }
+
+private:
+  /// Keys ordered by their expiration time.
+  std::set<std::pair<timestamp, data>> queue_;
+
+  /// Maps each key to its current position in `queue_`.
+  std::unordered_map<data, timestamp> deadlines_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <chrono>
+#include <mutex>
+
 #include "broker/time.hh"
 
 namespace broker {
@@ -12,14 +15,19 @@ namespace detail {
 /// signal availability of a resource across threads, both access to that
 /// resource and the use of the fire/extinguish functions must be performed in
 /// a thread-safe manner in order for that to work correctly.
+///
+/// The flare counts how often it has been fired in user space and only
+/// touches the file descriptor when the count changes from zero to non-zero
+/// or vice versa. Hence, firing a flare that is already active costs no
+/// system call. On Linux, the flare uses an `eventfd` instead of a pipe.
 class flare {
 public:
   using timeout_type = clock::time_point;
 
-  /// Constructs a flare by opening a UNIX pipe.
+  /// Constructs a flare by opening an eventfd or a UNIX pipe.
   flare();
 
-  /// Destructs the flare, closing the UNIX pipe's file descriptors.
+  /// Destructs the flare, closing its file descriptors.
   ~flare();
 
   flare(const flare&) = delete;
@@ -29,32 +37,38 @@ public:
   /// "fired" and not yet "extinguishedd."
   int fd() const;
 
-  /// Puts the object in the "ready" state by writing `n` bytes into the
-  /// underlying pipe.
+  /// Puts the object in the "ready" state by adding `num` to its count.
   void fire(size_t num = 1);
 
-  // Takes the object out of the "ready" state by consuming all bytes from the
-  // underlying pipe.
-  // @returns the number of consumed bytes
+  // Takes the object out of the "ready" state by resetting its count.
+  // @returns the count before resetting it
   size_t extinguish();
 
-  /// Attempts to consume only one byte from the pipe, potentially leaving the
-  /// flare in "ready" state.
-  /// @returns `true` if one byte was read successfully from the pipe and
-  ///          `false` if the pipe had no data to be read.
+  /// Attempts to decrement the count by one, potentially leaving the flare in
+  /// "ready" state.
+  /// @returns `true` if the count was non-zero and `false` otherwise.
   bool extinguish_one();
 
-  /// Attempts to consume only one byte from the pipe, potentially leaving the
-  /// flare in "ready" state.
-  /// @returns `true` if one byte was read successfully from the pipe and
-  ///          `false` if the pipe had no data to be read.
+  /// Attempts to decrement the count by `num`, potentially leaving the flare
+  /// in "ready" state.
+  /// @returns the number of decrements, i.e., `min(num, count)`.
   size_t extinguish_some(size_t num);
 
-  /// Blocks the caller until the object could consume one byte from the pipe.
+  /// Returns whether the flare is in "ready" state without a system call.
+  bool active() const {
+    return count_.load() > 0;
+  }
+
+  /// Busy-waits for up to `window` until the flare is in "ready" state. Unlike
+  /// `await_one`, this function never performs a system call.
+  /// @returns `true` if the flare became ready, `false` otherwise.
+  bool spin_one(timespan window) const;
+
+  /// Blocks the caller until the flare is in "ready" state.
   void await_one();
 
-  /// Blocks the caller until the object could consume one byte from the pipe
-  /// or or a timeout occurs.
+  /// Blocks the caller until the flare is in "ready" state or a timeout
+  /// occurs.
   template <class Timeout>
   bool await_one(Timeout timeout) {
     using clk = typename Timeout::clock;
@@ -68,7 +82,27 @@ public:
 private:
   bool await_one_impl(int ms_timeout);
 
+  /// Makes the file descriptor ready if `count_ > 0` or clears it otherwise.
+  void sync();
+
+  /// Makes the file descriptor ready.
+  void signal();
+
+  /// Makes the file descriptor not ready.
+  void clear();
+
+  /// Stores the read handle at index 0 and the write handle at index 1. Both
+  /// handles are equal when using an eventfd.
   int fds_[2];
+
+  /// Stores how often the flare was fired but not yet extinguished.
+  std::atomic<size_t> count_;
+
+  /// Serializes state changes of the file descriptor.
+  std::mutex mtx_;
+
+  /// Stores whether the file descriptor is currently ready.
+  bool signaled_;
 };
 
 } // namespace detail
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "broker/data.hh"
+#include "broker/filter_type.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+#include "broker/detail/subscriber_queue.hh"
+
+namespace broker {
+namespace detail {
+
+/// Delivers messages from publishers to subscribers of the same endpoint
+/// without going through the core actor. Publishers resolve the matching
+/// subscribers once per topic and only resolve them again after a subscriber
+/// changes.
+class local_dispatcher {
+public:
+  using queue_ptr = subscriber_queue_ptr<>;
+
+  /// Caches the subscriber queues that match a single topic.
+  struct route {
+    /// Version of the dispatcher when computing `queues`.
+    uint64_t version;
+
+    /// All queues with a matching filter.
+    std::vector<queue_ptr> queues;
+  };
+
+  using route_ptr = std::shared_ptr<const route>;
+
+  local_dispatcher();
+
+  /// Registers `q` with `filter` or updates the filter of `q`.
+  void subscribe(queue_ptr q, filter_type filter);
+
+  /// Removes `q`.
+  void unsubscribe(const queue_ptr& q);
+
+  /// Returns an up-to-date route for topic `t`, reusing `cached` if possible.
+  route_ptr lookup(const topic& t, route_ptr cached) const;
+
+  /// Delivers `x` to all queues in `r`. Queues share the content of `x`.
+  static void deliver(const route& r, const data_message& x);
+
+  /// Delivers `x` to all queues with a matching filter. Callers that publish
+  /// on the same topic repeatedly should cache the result of `lookup`
+  /// instead.
+  void deliver(const data_message& x) const;
+
+  /// Returns the current version, which changes with each (un)subscription.
+  uint64_t version() const noexcept {
+    return version_.load();
+  }
+
+private:
+  using subscription = std::pair<queue_ptr, filter_type>;
+
+  mutable std::mutex mtx_;
+  std::vector<subscription> subscriptions_;
+  std::atomic<uint64_t> version_;
+};
+
+using local_dispatcher_ptr = std::shared_ptr<local_dispatcher>;
+
+} // namespace detail
+} // namespace broker
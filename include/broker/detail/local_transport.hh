@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+#include <caf/actor.hpp>
+#include <caf/fwd.hpp>
+
+namespace broker {
+namespace detail {
+
+/// Prefix of addresses that select the shared-memory transport.
+constexpr char shm_scheme[] = "shm://";
+
+/// Prefix of addresses that select Unix domain sockets.
+constexpr char unix_scheme[] = "unix://";
+
+/// Checks whether `address` selects the shared-memory transport.
+bool is_shm_address(const std::string& address);
+
+/// Checks whether `address` selects Unix domain sockets.
+bool is_unix_address(const std::string& address);
+
+/// Checks whether `address` selects one of the transports for peering with
+/// endpoints on the same host.
+inline bool is_local_address(const std::string& address) {
+  return is_shm_address(address) || is_unix_address(address);
+}
+
+/// Returns the address for the Unix domain socket at `path`.
+inline std::string make_unix_address(const std::string& path) {
+  return unix_scheme + path;
+}
+
+/// Returns the middleman actor for peering with endpoints on the same host,
+/// spawning it on first use. The actor understands the same messages as the
+/// middleman actor of CAF, but only accepts `shm://` and `unix://`
+/// addresses. BASP and all Broker protocols on top remain unchanged.
+///
+/// Unix domain sockets (`unix://path`) carry the same byte stream as TCP
+/// connections, but bypass the TCP stack. The file system permissions of
+/// the socket file control who may connect.
+///
+/// Shared-memory connections (`shm://name`) consist of one segment with two
+/// byte rings (one per direction) plus a Unix domain socket. The socket
+/// carries the file descriptor of the segment during the handshake, wakes up
+/// sleeping readers and writers, and signals disconnects. Both sides only
+/// accept peers that run as the same user and never trust the ring headers
+/// of the other side.
+caf::actor local_middleman(caf::actor_system& sys);
+
+/// Terminates the actor returned by `local_middleman` (if any).
+void shutdown_local_middleman(caf::actor_system& sys);
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <iterator>
+
+#include <caf/intrusive_ptr.hpp>
+#include <caf/make_counted.hpp>
+
+#include "broker/detail/lock_free_queue.hh"
+#include "broker/message.hh"
+
+namespace broker {
+namespace detail {
+
+/// Lock-free drop-in replacement for `shared_publisher_queue`. Any number of
+/// users produce items, while the worker consumes them.
+///
+/// The protocol on the flare is as follows:
+/// - the flare starts active
+/// - the flare is active as long as the queue has less than `capacity` items
+/// - consume() syncs the flare when the size drops below the capacity
+/// - produce() syncs the flare when the size reaches the capacity
+template <class ValueType = data_message>
+class lock_free_publisher_queue : public lock_free_queue<ValueType> {
+public:
+  using value_type = ValueType;
+
+  using super = lock_free_queue<ValueType>;
+
+  explicit lock_free_publisher_queue(size_t buffer_size)
+    : super(buffer_size), capacity_(buffer_size) {
+    // The flare is active as long as publishers can write.
+    sync();
+  }
+
+  // Called to pull items out of the queue. Signals demand to the user if less
+  // than `num` items can be published from the buffer.
+  template <class F>
+  size_t consume(size_t num, F fun) {
+    auto n = this->pop(num, fun);
+    if (n == 0) {
+      this->pending_ = static_cast<long>(num);
+      return 0;
+    }
+    auto old_size = this->drop(n);
+    if (old_size >= capacity_ && old_size - n < capacity_)
+      sync();
+    if (num - n > 0)
+      this->pending_ = static_cast<long>(num - n);
+    return n;
+  }
+
+  /// Returns true if the caller must wake up the consumer. This function can
+  /// go beyond the capacity of the queue.
+  template <class Iterator>
+  bool produce(const topic& t, Iterator first, Iterator last) {
+    await_consumer();
+    return append(t, first, last);
+  }
+
+  // Returns true if the caller must wake up the consumer.
+  bool produce(const topic& t, data&& y) {
+    await_consumer();
+    return add(1, [&] { return value_type{t, std::move(y)}; });
+  }
+
+  /// Like `produce`, but never blocks. Hence, this function can exceed the
+  /// capacity of the queue arbitrarily.
+  /// @returns true if the caller must wake up the consumer.
+  template <class Iterator>
+  bool append(const topic& t, Iterator first, Iterator last) {
+    auto n = static_cast<size_t>(std::distance(first, last));
+    if (n == 0)
+      return false;
+    return add(n, [&] { return value_type{t, std::move(*first++)}; });
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+private:
+  template <class F>
+  bool add(size_t n, F next) {
+    auto old_size = this->push(n, next);
+    if (old_size < capacity_ && old_size + n >= capacity_)
+      sync();
+    return old_size == 0;
+  }
+
+  void await_consumer() {
+    // Block the caller until the consumer catched up.
+    while (this->buffer_size() >= capacity_)
+      this->wait_on_flare();
+  }
+
+  void sync() {
+    this->sync_flare([this](size_t size) { return size < capacity_; });
+  }
+
+  // Configures the amound of items for the queue.
+  const size_t capacity_;
+};
+
+template <class ValueType = data_message>
+using lock_free_publisher_queue_ptr
+  = caf::intrusive_ptr<lock_free_publisher_queue<ValueType>>;
+
+template <class ValueType = data_message>
+lock_free_publisher_queue_ptr<ValueType>
+make_lock_free_publisher_queue(size_t buffer_size) {
+  return caf::make_counted<lock_free_publisher_queue<ValueType>>(buffer_size);
+}
+
+} // namespace detail
+} // namespace broker
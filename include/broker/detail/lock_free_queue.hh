@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <caf/duration.hpp>
+#include <caf/ref_counted.hpp>
+
+#include "broker/data.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+#include "broker/detail/flare.hh"
+#include "broker/detail/ring_buffer.hh"
+
+namespace broker {
+namespace detail {
+
+/// Base class for `lock_free_publisher_queue` and `lock_free_subscriber_queue`.
+/// Provides the same interface as `shared_queue`, but stores values in a
+/// `ring_buffer` instead of a mutex-guarded `std::deque`. Hence, producers and
+/// the consumer only synchronize via atomics as long as the ring buffer has
+/// free slots. Values that do not fit into the ring buffer go to a
+/// mutex-guarded overflow list, which preserves the FIFO order and allows the
+/// queue to exceed its capacity just like `shared_queue`.
+///
+/// The flare tracks a readiness predicate that only depends on the size of
+/// the queue. Changing the flare requires a (rarely contended) mutex, but the
+/// queue only touches the flare when the size crosses a threshold.
+///
+/// @warning Only one thread at a time may consume values.
+template <class ValueType = data_message>
+class lock_free_queue : public caf::ref_counted {
+public:
+  using value_type = ValueType;
+
+  using guard_type = std::unique_lock<std::mutex>;
+
+  // --- accessors -------------------------------------------------------------
+
+  int fd() const {
+    return fx_.fd();
+  }
+
+  long pending() const {
+    return pending_.load();
+  }
+
+  long rate() const {
+    return rate_.load();
+  }
+
+  size_t buffer_size() const {
+    return size_.load();
+  }
+
+  // --- mutators --------------------------------------------------------------
+
+  void pending(long x) {
+    pending_ = x;
+  }
+
+  void rate(long x) {
+    rate_ = x;
+  }
+
+  void wait_on_flare() {
+    fx_.await_one();
+  }
+
+  bool wait_on_flare(caf::duration timeout) {
+    if (!timeout.valid()) {
+      fx_.await_one();
+      return true;
+    }
+    auto abs_timeout = std::chrono::high_resolution_clock::now();
+    abs_timeout += timeout;
+    return fx_.await_one(abs_timeout);
+  }
+
+  template <class T>
+  bool wait_on_flare_abs(T abs_timeout) {
+    return fx_.await_one(abs_timeout);
+  }
+
+  /// Busy-waits for up to `window` until the flare becomes ready.
+  bool spin_on_flare(timespan window) {
+    return fx_.spin_one(window);
+  }
+
+protected:
+  /// Smallest number of slots in the ring buffer.
+  static constexpr size_t min_ring_size = 64;
+
+  /// Largest number of slots in the ring buffer. Additional values go to the
+  /// overflow list.
+  static constexpr size_t max_ring_size = 4096;
+
+  explicit lock_free_queue(size_t capacity_hint)
+    : ring_(std::min(std::max(capacity_hint * 2, size_t{min_ring_size}),
+                     size_t{max_ring_size})),
+      pending_(0),
+      rate_(0),
+      size_(0),
+      overflow_size_(0),
+      ready_(false) {
+    // nop
+  }
+
+  /// Appends `n` values, obtaining each value by calling `next`. Consumers
+  /// see the new size before the values, but `pop` waits for counted values.
+  /// @returns the size of the queue before adding the values.
+  template <class F>
+  size_t push(size_t n, F next) {
+    auto result = size_.fetch_add(n, std::memory_order_acq_rel);
+    for (size_t i = 0; i < n; ++i) {
+      value_type x = next();
+      // Once a value went to the overflow list, all subsequent values must
+      // follow it until the consumer has drained the list.
+      if (overflow_size_.load(std::memory_order_acquire) == 0
+          && ring_.try_push(x))
+        continue;
+      guard_type guard{overflow_mtx_};
+      overflow_.emplace_back(std::move(x));
+      overflow_size_.fetch_add(1, std::memory_order_release);
+    }
+    return result;
+  }
+
+  /// Passes up to `num` values to `f`, stopping early only if the queue
+  /// becomes empty. The caller must call `drop` afterwards.
+  /// @returns the number of consumed values.
+  template <class F>
+  size_t pop(size_t num, F& f) {
+    auto n = std::min(num, size_.load(std::memory_order_acquire));
+    for (size_t i = 0; i < n; ++i)
+      while (!pop_one(f)) {
+        // A producer has counted the value but not yet stored it.
+        std::this_thread::yield();
+      }
+    return n;
+  }
+
+  /// Removes `n` consumed values from the size of the queue.
+  /// @returns the size of the queue before removing the values.
+  size_t drop(size_t n) {
+    return size_.fetch_sub(n, std::memory_order_acq_rel);
+  }
+
+  /// Fires or extinguishes the flare depending on `is_ready(size)`. Callers
+  /// only need to call this function after crossing a threshold.
+  template <class Predicate>
+  void sync_flare(Predicate is_ready) {
+    guard_type guard{flare_mtx_};
+    auto ready = is_ready(size_.load());
+    if (ready && !ready_)
+      fx_.fire();
+    else if (!ready && ready_)
+      fx_.extinguish();
+    ready_ = ready;
+  }
+
+  /// Stores values that are currently in the queue.
+  ring_buffer<value_type> ring_;
+
+  /// Stores what demand the worker has last signaled to the core or vice
+  /// versa, depending on the message direction.
+  std::atomic<long> pending_;
+
+  /// Stores consumption or production rate.
+  std::atomic<size_t> rate_;
+
+  /// Stores the number of values in the queue, including values that
+  /// producers are about to store.
+  std::atomic<size_t> size_;
+
+private:
+  template <class F>
+  bool pop_one(F& f) {
+    if (ring_.try_pop(f))
+      return true;
+    if (overflow_size_.load(std::memory_order_acquire) == 0)
+      return false;
+    guard_type guard{overflow_mtx_};
+    if (overflow_.empty())
+      return false;
+    f(std::move(overflow_.front()));
+    overflow_.pop_front();
+    overflow_size_.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /// Guards access to `overflow_`.
+  std::mutex overflow_mtx_;
+
+  /// Buffers values that did not fit into the ring buffer.
+  std::deque<value_type> overflow_;
+
+  /// Stores the size of `overflow_` for checking it without locking.
+  std::atomic<size_t> overflow_size_;
+
+  /// Guards access to `fx_` and `ready_`.
+  std::mutex flare_mtx_;
+
+  /// Signals to users when data can be read or written.
+  mutable flare fx_;
+
+  /// Stores whether `fx_` is currently active.
+  bool ready_;
+};
+
+} // namespace detail
+} // namespace broker
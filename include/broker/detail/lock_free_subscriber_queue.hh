@@ -0,0 +1,99 @@
+#pragma once
+
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include <caf/intrusive_ptr.hpp>
+#include <caf/make_counted.hpp>
+
+#include "broker/detail/lock_free_queue.hh"
+#include "broker/message.hh"
+
+namespace broker {
+namespace detail {
+
+/// Lock-free drop-in replacement for `shared_subscriber_queue`. The worker
+/// produces items, while the user consumes them.
+///
+/// The protocol on the flare is as follows:
+/// - the flare starts inactive
+/// - the flare is active as long as the queue has at least one item
+/// - produce() syncs the flare when the queue was empty
+/// - consume() syncs the flare when it removes the last item
+template <class ValueType = data_message>
+class lock_free_subscriber_queue : public lock_free_queue<ValueType> {
+public:
+  using value_type = ValueType;
+
+  using super = lock_free_queue<value_type>;
+
+  explicit lock_free_subscriber_queue(size_t capacity_hint)
+    : super(capacity_hint) {
+    // nop
+  }
+
+  // Called to pull up to `num` items out of the queue. Returns the number of
+  // consumed elements.
+  template <class F>
+  size_t consume(size_t num, size_t* size_before_consume, F fun) {
+    auto n = this->pop(num, fun);
+    if (n == 0)
+      return 0;
+    auto old_size = this->drop(n);
+    if (size_before_consume)
+      *size_before_consume = old_size;
+    if (old_size == n)
+      sync();
+    return n;
+  }
+
+  std::vector<value_type> consume_all() {
+    std::vector<value_type> rval;
+    consume_all(rval);
+    return rval;
+  }
+
+  // Appends all items to `buf`. Returns the number of consumed elements.
+  size_t consume_all(std::vector<value_type>& buf) {
+    buf.reserve(buf.size() + this->buffer_size());
+    return consume(std::numeric_limits<size_t>::max(), nullptr,
+                   [&](value_type&& x) { buf.emplace_back(std::move(x)); });
+  }
+
+  // Inserts the range `[i, e)` into the queue.
+  template <class Iter>
+  void produce(size_t num, Iter i, Iter e) {
+    CAF_IGNORE_UNUSED(e);
+    CAF_ASSERT(num == std::distance(i, e));
+    if (num == 0)
+      return;
+    if (this->push(num, [&] { return value_type{*i++}; }) == 0)
+      sync();
+  }
+
+  // Inserts `x` into the queue.
+  void produce(ValueType x) {
+    if (this->push(1, [&] { return std::move(x); }) == 0)
+      sync();
+  }
+
+private:
+  void sync() {
+    this->sync_flare([](size_t size) { return size > 0; });
+  }
+};
+
+template <class ValueType = data_message>
+using lock_free_subscriber_queue_ptr
+  = caf::intrusive_ptr<lock_free_subscriber_queue<ValueType>>;
+
+template <class ValueType = data_message>
+lock_free_subscriber_queue_ptr<ValueType>
+make_lock_free_subscriber_queue(size_t capacity_hint) {
+  return caf::make_counted<lock_free_subscriber_queue<ValueType>>(
+    capacity_hint);
+}
+
+} // namespace detail
+} // namespace broker
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include <caf/actor.hpp>
 #include <caf/behavior.hpp>
@@ -8,6 +12,8 @@
 #include <caf/event_based_actor.hpp>
 
 #include "broker/data.hh"
+#include "broker/detail/abstract_backend.hh"
+#include "broker/detail/expiry_index.hh"
 #include "broker/fwd.hh"
 #include "broker/internal_command.hh"
 #include "broker/topic.hh"
@@ -16,7 +22,28 @@
 namespace broker {
 namespace detail {
 
-class abstract_backend;
+/// Reads a snapshot from a backend cursor until the master detaches it.
+/// Detaching copies all remaining key-value pairs into memory and releases
+/// the backend cursor. Afterwards, the master may modify the backend without
+/// affecting the snapshot.
+class detachable_cursor : public snapshot_cursor {
+public:
+  explicit detachable_cursor(snapshot_cursor_ptr src);
+
+  expected<bool> next(std::vector<snapshot_entry>& xs, size_t n) override;
+
+  /// Copies all remaining key-value pairs into memory.
+  expected<void> detach();
+
+  bool detached() const noexcept {
+    return src_ == nullptr;
+  }
+
+private:
+  snapshot_cursor_ptr src_;
+  std::vector<snapshot_entry> buf_;
+  size_t pos_;
+};
 
 class master_state {
 public:
@@ -36,20 +63,73 @@ public:
   /// Sends `x` to all clones.
   void broadcast(internal_command&& x);
 
+  /// Assigns the next sequence number to `x`, adds it to the command log and
+  /// sends it to all clones.
+  void publish_update(internal_command&& x);
+
   template <class T>
   void broadcast_cmd_to_clones(T cmd) {
-    if (!clones.empty())
-      broadcast(internal_command{std::move(cmd)});
+    publish_update(internal_command{std::move(cmd)});
   }
 
-  void remind(timespan expiry, const data& key);
+  /// Sends all updates after `last_seq` to `clone`.
+  /// @returns `false` if the command log no longer contains all updates
+  ///          after `last_seq`, `true` otherwise.
+  bool send_missed_updates(const caf::actor& clone, uint64_t last_seq);
+
+  /// Schedules the expiration of `key` at `expiry`, replacing any previous
+  /// expiration time of `key`.
+  void remind(timestamp expiry, const data& key);
 
-  void expire(data& key);
+  /// Schedules a tick for the time slice of the next expiring key unless an
+  /// earlier tick is already pending.
+  void schedule_tick();
+
+  /// Expires all keys that are due at the time slice `t`.
+  void tick(timestamp t);
+
+  /// Removes `keys` from the backend if their expiration time lies at or
+  /// before `now` and tells all clones about the removed keys.
+  void expire(std::vector<data> keys, timestamp now);
 
   void command(internal_command& cmd);
 
   void command(internal_command::variant_type& cmd);
 
+  /// Opens a transaction for the next group of updates if group commit is
+  /// enabled and no transaction is open yet.
+  void begin_update();
+
+  /// Commits the current transaction once it reaches its maximum size or
+  /// age.
+  void end_update();
+
+  /// Commits the current transaction, if any.
+  void commit_updates();
+
+  /// Releases the cursor of a snapshot stream and applies all commands that
+  /// arrived in the meantime once no snapshot stream remains.
+  void finish_snapshot(snapshot_cursor* cursor);
+
+  /// Checks whether the master must hold back updates, because a snapshot
+  /// stream reads from the live backend.
+  bool holds_back_updates() const;
+
+  /// Detaches all snapshots once the master holds back too many updates.
+  void limit_pending_updates();
+
+  /// Detaches all snapshots if the master holds back any updates. Reads and
+  /// sync points call this first, since they must observe all previous
+  /// writes.
+  void settle_updates();
+
+  /// Copies the remainder of all snapshots into memory and applies all
+  /// updates that the master held back.
+  void detach_snapshots();
+
+  /// Applies all commands and expirations that the master held back.
+  void apply_pending_updates();
+
   void operator()(none);
 
   void operator()(put_command&);
@@ -78,6 +158,56 @@ public:
 
   backend_pointer backend;
 
+  /// Cursors of the snapshots that the master currently streams to clones.
+  /// Unless the backend has isolated cursors, cursors read from the live
+  /// backend and the master holds back all updates while at least one of
+  /// them remains attached.
+  std::vector<std::unique_ptr<detachable_cursor>> snapshot_cursors;
+
+  /// Commands that arrived while streaming snapshots.
+  std::vector<internal_command::variant_type> pending_commands;
+
+  /// Keys that expired while streaming snapshots.
+  std::vector<data> pending_expiries;
+
+  /// Maximum number of commands and expirations that the master holds back
+  /// before detaching all snapshots.
+  size_t max_pending_updates;
+
+  /// Expiration times of all keys with an expiry.
+  expiry_index expiries;
+
+  /// Length of the time slices for expiring keys.
+  timespan expiry_interval;
+
+  /// Time slice of the pending tick, if any.
+  optional<timestamp> next_tick;
+
+  /// Sequence number of the last update.
+  uint64_t seq;
+
+  /// Maximum number of entries in `command_log`.
+  size_t command_log_size;
+
+  /// Most recent updates for clones that reconnect after losing the master.
+  std::deque<internal_command> command_log;
+
+  /// Maximum number of updates per transaction or 0 for letting the backend
+  /// commit each update on its own.
+  size_t group_commit_size;
+
+  /// Maximum time between opening and committing a transaction.
+  timespan group_commit_interval;
+
+  /// Whether the master has opened a transaction.
+  bool group_commit_open;
+
+  /// Number of updates in the current transaction.
+  size_t group_commit_pending;
+
+  /// Time when the master opened the current transaction.
+  std::chrono::steady_clock::time_point group_commit_start;
+
   caf::actor core;
 
   std::unordered_map<caf::actor_addr, caf::actor> clones;
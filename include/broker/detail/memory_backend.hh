@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 
 #include "broker/backend_options.hh"
@@ -9,9 +10,14 @@
 namespace broker {
 namespace detail {
 
-/// An in-memory key-value storage backend.
+/// An in-memory key-value storage backend. Cursors share the map with the
+/// backend until the next modification, which then copies the map. Hence,
+/// cursors always read the state of the backend at their creation.
 class memory_backend : public abstract_backend {
 public:
+  using map_type
+    = std::unordered_map<data, std::pair<data, optional<timestamp>>>;
+
   /// Constructs a memory backend.
   /// @param opts The options controlling the backend behavior.
   memory_backend(backend_options opts = backend_options{});
@@ -43,12 +49,19 @@ public:
 
   expected<broker::snapshot> snapshot() const override;
 
+  expected<snapshot_cursor_ptr> cursor() const override;
+
+  bool cursor_is_isolated() const override;
+
   expected<expirables> expiries() const override;
 
 private:
+  /// Returns the map for modifying it, copying it first if any cursor still
+  /// reads from it.
+  map_type& mutable_store();
+
   backend_options options_;
-  std::unordered_map<data, std::pair<data, optional<timestamp>>> store_;
-  std::unordered_map<data, timestamp> expirations_;
+  std::shared_ptr<map_type> store_;
 };
 
 } // namespace detail
@@ -12,7 +12,9 @@
 #include <caf/openssl/manager.hpp>
 #include <caf/optional.hpp>
 #include <caf/result.hpp>
+#include <caf/sec.hpp>
 
+#include "broker/detail/local_transport.hh"
 #include "broker/logger.hh"
 #include "broker/network_info.hh"
 
@@ -44,8 +46,13 @@ public:
     BROKER_INFO("initiating connection to"
                 << (x.address + ":" + std::to_string(x.port))
                 << (use_ssl ? "(SSL)" : "(no SSL)"));
-    auto hdl = (use_ssl ? self->home_system().openssl_manager().actor_handle()
-                        : self->home_system().middleman().actor_handle());
+    if (use_ssl && is_local_address(x.address)) {
+      // Local transports never use SSL.
+      g(make_error(sec::unsupported_operation,
+                   "local transports require disable_ssl", x.address));
+      return;
+    }
+    auto hdl = middleman_for(x);
     self->request(hdl, infinite,
                   connect_atom::value, x.address, x.port)
     .then(
@@ -111,6 +118,9 @@ public:
   void remove(const network_info& x);
 
 private:
+  /// Returns the middleman actor responsible for connecting to `x`.
+  caf::actor middleman_for(const network_info& x);
+
   // Parent.
   caf::event_based_actor* self;
   bool use_ssl = true;
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <caf/error.hpp>
+#include <caf/fwd.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/ref_counted.hpp>
+
+#include "broker/data.hh"
+#include "broker/detail/compression.hh"
+
+namespace broker {
+namespace detail {
+
+/// Selects the encoding of a ::data value in a payload buffer.
+enum class payload_format : uint8_t {
+  /// Encodes data with the binary serializer of CAF.
+  binary,
+  /// Encodes data with the varint-based codec in `data_codec.hh`.
+  compact,
+};
+
+/// Number of values in ::payload_format.
+constexpr size_t num_payload_formats = 2;
+
+/// Holds the serialized form of a ::data value. All outbound paths to peers
+/// share a single buffer per message, i.e., the core serializes a message
+/// only once regardless of how many peers receive it. Compressed buffers
+/// start with the size of the uncompressed data as 32-bit little-endian
+/// integer.
+class payload_buffer : public caf::ref_counted {
+public:
+  explicit payload_buffer(
+    std::vector<char> bytes, payload_format format = payload_format::binary,
+    compression_method compression = compression_method::none);
+
+  /// Returns the serialized data.
+  const std::vector<char>& bytes() const noexcept {
+    return bytes_;
+  }
+
+  /// Returns the number of bytes in the buffer.
+  size_t size() const noexcept {
+    return bytes_.size();
+  }
+
+  /// Returns the encoding of the serialized data.
+  payload_format format() const noexcept {
+    return format_;
+  }
+
+  /// Returns the number of bytes before compression.
+  size_t raw_size() const noexcept;
+
+  /// Returns the compression of the serialized data.
+  compression_method compression() const noexcept {
+    return compression_;
+  }
+
+private:
+  std::vector<char> bytes_;
+  payload_format format_;
+  compression_method compression_;
+};
+
+/// @relates payload_buffer
+using payload_buffer_ptr = caf::intrusive_ptr<payload_buffer>;
+
+/// Stores one buffer per combination of ::payload_format and
+/// ::compression_method for a single message.
+/// @relates payload_buffer
+using payload_buffer_set
+  = std::array<payload_buffer_ptr,
+               num_payload_formats * num_compression_methods>;
+
+/// Returns the position for buffers with given format and compression in a
+/// ::payload_buffer_set.
+/// @relates payload_buffer
+constexpr size_t payload_index(payload_format format,
+                               compression_method compression) {
+  return static_cast<size_t>(format) * num_compression_methods
+         + static_cast<size_t>(compression);
+}
+
+/// Serializes `x` into a new buffer.
+/// @relates payload_buffer
+payload_buffer_ptr
+make_payload_buffer(const data& x,
+                    payload_format format = payload_format::binary);
+
+/// Deserializes the content of `x` into `result`.
+/// @returns `false` if `x` does not contain a valid ::data value.
+/// @relates payload_buffer
+bool decode_payload(const payload_buffer& x, data& result);
+
+/// Re-encodes the content of `x` uncompressed using `format`.
+/// @returns `nullptr` if `x` does not contain a valid ::data value.
+/// @relates payload_buffer
+payload_buffer_ptr convert_payload(const payload_buffer& x,
+                                   payload_format format);
+
+/// Compresses the content of the uncompressed buffer `x` using `method`.
+/// @returns `nullptr` if `method` is not available or `x` is compressed.
+/// @relates payload_buffer
+payload_buffer_ptr compress_payload(const payload_buffer& x,
+                                    compression_method method);
+
+/// Restores the uncompressed content of `x`.
+/// @returns `nullptr` if `x` is malformed.
+/// @relates payload_buffer
+payload_buffer_ptr decompress_payload(const payload_buffer& x);
+
+/// Writes the format and content of `x` as a length-prefixed blob to `sink`.
+/// @relates payload_buffer
+caf::error write_payload(caf::serializer& sink, const payload_buffer& x);
+
+/// Reads a length-prefixed blob from `source` into a new buffer without
+/// deserializing its content.
+/// @relates payload_buffer
+caf::error read_payload(caf::deserializer& source, payload_buffer_ptr& x);
+
+} // namespace detail
+} // namespace broker
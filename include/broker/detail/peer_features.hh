@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace broker {
+namespace detail {
+
+/// A bitmask of optional extensions to the peer-to-peer protocol. Each side
+/// announces the features it supports in its stream handshake and the sender
+/// of a stream only uses features that both sides support.
+using peer_features = uint32_t;
+
+/// Enumerates all optional extensions to the peer-to-peer protocol.
+enum peer_feature : peer_features {
+  /// Transmits known topics as small integers instead of full strings.
+  topic_dictionary_feature = 0x01,
+  /// Encodes data with the compact codec instead of the CAF serializer.
+  compact_data_feature = 0x02,
+  /// Decompresses payloads with the built-in LZ codec.
+  lz_compression_feature = 0x04,
+  /// Decompresses payloads with zlib.
+  zlib_compression_feature = 0x08,
+  /// Tags messages with their origin and a sequence number for dropping
+  /// duplicates.
+  message_id_feature = 0x10,
+};
+
+/// Describes how an endpoint spreads topics over its core actors: the number
+/// of secondary shards, plus `striped_layout_flag` if the shards run in actor
+/// systems of their own. Unlike features, both sides of a peering must have
+/// the same layout, because each side only routes a topic through the shard
+/// that the topic hashes to.
+using shard_layout = uint32_t;
+
+/// Marks the layout of endpoints with peer stripes.
+constexpr shard_layout striped_layout_flag = 0x80000000;
+
+} // namespace detail
+} // namespace broker
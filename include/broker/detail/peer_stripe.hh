@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <caf/actor.hpp>
+#include <caf/actor_system.hpp>
+
+#include "broker/configuration.hh"
+#include "broker/endpoint.hh"
+#include "broker/expected.hh"
+
+namespace broker {
+namespace detail {
+
+/// Hosts one secondary core shard of an endpoint with `broker.peer-stripes`
+/// greater than 1. CAF multiplexes all traffic between two actor systems
+/// over a single connection. Hence, each stripe runs its own actor system
+/// with its own middleman in order to get a connection of its own.
+class peer_stripe {
+public:
+  /// Creates a new actor system that inherits the Broker, OpenSSL and
+  /// scheduler settings of `parent` and spawns a core shard in it. The
+  /// scheduler of a stripe never runs more than two worker threads. The core
+  /// shard reports its errors to `primary`.
+  peer_stripe(const configuration& parent, endpoint::clock* clock,
+              caf::actor primary);
+
+  /// Returns the core shard of this stripe.
+  const caf::actor& core() const noexcept {
+    return core_;
+  }
+
+  /// Publishes the core shard of this stripe at `address` on a port that
+  /// the OS picks.
+  /// @returns the port of the published core.
+  expected<uint16_t> listen(const std::string& address);
+
+private:
+  configuration config_;
+  caf::actor_system system_;
+  caf::actor core_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <caf/intrusive_ptr.hpp>
+
+#include "broker/config.hh"
+#include "broker/message.hh"
+
+#ifdef BROKER_LOCK_FREE_QUEUES
+#include "broker/detail/lock_free_publisher_queue.hh"
+#else
+#include "broker/detail/shared_publisher_queue.hh"
+#endif
+
+namespace broker {
+namespace detail {
+
+/// Selects the queue implementation for publishers at build time.
+#ifdef BROKER_LOCK_FREE_QUEUES
+template <class ValueType = data_message>
+using publisher_queue = lock_free_publisher_queue<ValueType>;
+#else
+template <class ValueType = data_message>
+using publisher_queue = shared_publisher_queue<ValueType>;
+#endif
+
+template <class ValueType = data_message>
+using publisher_queue_ptr = caf::intrusive_ptr<publisher_queue<ValueType>>;
+
+template <class ValueType = data_message>
+publisher_queue_ptr<ValueType> make_publisher_queue(size_t buffer_size) {
+#ifdef BROKER_LOCK_FREE_QUEUES
+  return make_lock_free_publisher_queue<ValueType>(buffer_size);
+#else
+  return make_shared_publisher_queue<ValueType>(buffer_size);
+#endif
+}
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace broker {
+namespace detail {
+
+/// A bounded, lock-free FIFO queue for any number of producers and consumers.
+/// Each slot carries a sequence number that tells producers and consumers
+/// whether the slot is ready for them. Hence, threads only contend on the
+/// head and tail indexes and never block each other.
+template <class T>
+class ring_buffer {
+public:
+  using value_type = T;
+
+  /// Constructs a ring buffer for at least `min_capacity` elements. The actual
+  /// capacity is the next power of two.
+  explicit ring_buffer(size_t min_capacity)
+    : mask_(round_up(min_capacity) - 1) {
+    slots_.reset(new slot[mask_ + 1]);
+    for (size_t i = 0; i <= mask_; ++i)
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+  }
+
+  ring_buffer(const ring_buffer&) = delete;
+
+  ring_buffer& operator=(const ring_buffer&) = delete;
+
+  ~ring_buffer() {
+    auto last = tail_.load();
+    for (auto pos = head_.load(); pos != last; ++pos)
+      slots_[pos & mask_].ptr()->~value_type();
+  }
+
+  /// Tries to append `x`.
+  /// @returns `false` if the buffer is full, in which case `x` remains
+  ///          unchanged.
+  bool try_push(value_type& x) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& s = slots_[pos & mask_];
+      auto seq = s.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          new (s.ptr()) value_type(std::move(x));
+          s.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// Tries to remove the oldest element and passes it to `f`.
+  /// @returns `false` if the buffer is empty.
+  template <class F>
+  bool try_pop(F&& f) {
+    auto pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& s = slots_[pos & mask_];
+      auto seq = s.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<ptrdiff_t>(seq)
+                  - static_cast<ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          f(std::move(*s.ptr()));
+          s.ptr()->~value_type();
+          s.seq.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// Returns the maximum number of elements in the buffer.
+  size_t capacity() const noexcept {
+    return mask_ + 1;
+  }
+
+private:
+  static size_t round_up(size_t x) {
+    size_t result = 2;
+    while (result < x)
+      result <<= 1;
+    return result;
+  }
+
+  struct slot {
+    std::atomic<size_t> seq;
+    typename std::aligned_storage<sizeof(value_type),
+                                  alignof(value_type)>::type storage;
+
+    value_type* ptr() {
+      return reinterpret_cast<value_type*>(&storage);
+    }
+  };
+
+  /// Separates frequently written members to avoid false sharing.
+  static constexpr size_t cache_line_size = 64;
+
+  const size_t mask_;
+
+  std::unique_ptr<slot[]> slots_;
+
+  alignas(cache_line_size) std::atomic<size_t> head_;
+
+  alignas(cache_line_size) std::atomic<size_t> tail_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -24,6 +24,20 @@ public:
   ///                             to start estimating the nubmer of keys as
   ///                             opposed to linear enumeration.
   ///                             (default = 10,000)
+  ///   - `block-cache-size`: a `count` with the capacity of the block cache in
+  ///                         bytes. (default = RocksDB default)
+  ///   - `bloom-filter-bits`: a `count` with the bits per key for bloom
+  ///                          filters in table files. (default = no filters)
+  ///   - `compression`: a `std::string` with the compression method for table
+  ///                    files: `none`, `snappy`, `zlib`, `lz4` or `zstd`.
+  ///                    (default = `snappy`)
+  ///   - `write-buffer-size`: a `count` with the size of the memtable in
+  ///                          bytes. (default = RocksDB default)
+  ///
+  /// The backend applies `add` and `subtract` through a merge operator, i.e.,
+  /// without decoding the current value. Hence, neither reports type clashes.
+  /// Values of the wrong type leave the stored value unchanged instead.
+  /// `subtract` still reports `no_such_key` for missing keys.
   rocksdb_backend(backend_options opts = backend_options{});
 
   ~rocksdb_backend();
@@ -54,6 +68,10 @@ public:
 
   expected<broker::snapshot> snapshot() const override;
 
+  expected<snapshot_cursor_ptr> cursor() const override;
+
+  bool cursor_is_isolated() const override;
+
   expected<expirables> expiries() const override;
 
 private:
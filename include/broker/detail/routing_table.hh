@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <caf/stream_slot.hpp>
+
+#include "broker/detail/radix_tree.hh"
+#include "broker/detail/topic_table.hh"
+#include "broker/filter_type.hh"
+#include "broker/topic.hh"
+
+namespace broker {
+namespace detail {
+
+/// An inverted index that maps topic prefixes to the outbound paths that
+/// subscribed to them. Looking up the paths for a topic walks a radix tree
+/// once instead of evaluating the filter of each path, i.e., the costs grow
+/// with the length of the topic rather than with the number of subscribers.
+/// The table also memoizes the result for recently routed topics by their
+/// interned ID, i.e., routing a known topic does no string work at all.
+class routing_table {
+public:
+  // -- member types -----------------------------------------------------------
+
+  /// A sorted list of stream slots without duplicates.
+  using slot_list = std::vector<caf::stream_slot>;
+
+  // -- constants --------------------------------------------------------------
+
+  /// Maximum number of memoized topics before dropping the cache.
+  static constexpr size_t max_cached_topics = 4096;
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Sets the filter for `slot`, replacing any previous filter.
+  void set(caf::stream_slot slot, const filter_type& filter);
+
+  /// Removes `slot` from the table.
+  void erase(caf::stream_slot slot);
+
+  /// Removes all entries.
+  void clear();
+
+  // -- lookup -----------------------------------------------------------------
+
+  /// Returns all slots that have at least one prefix of `t` in their filter.
+  /// @warning The result is invalidated by the next call to any member
+  ///          function of this table.
+  const slot_list& match(const topic& t);
+
+  /// Returns whether `slot` subscribed to `t`.
+  bool matches(caf::stream_slot slot, const topic& t);
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the number of slots in this table.
+  size_t size() const noexcept {
+    return filters_.size();
+  }
+
+  /// Returns whether this table has no slots.
+  bool empty() const noexcept {
+    return filters_.empty();
+  }
+
+private:
+  void add_prefix(const std::string& prefix, caf::stream_slot slot);
+
+  void remove_prefix(const std::string& prefix, caf::stream_slot slot);
+
+  /// Maps each prefix to the slots that subscribed to it.
+  radix_tree<slot_list> prefixes_;
+
+  /// Slots that subscribed to the empty topic, i.e., to everything.
+  slot_list wildcards_;
+
+  /// Stores the current filter of each slot.
+  std::unordered_map<caf::stream_slot, filter_type> filters_;
+
+  /// Memoized results of `match`.
+  std::unordered_map<topic_id, slot_list> cache_;
+
+  /// Scratch space for computing results.
+  slot_list buf_;
+};
+
+} // namespace detail
+} // namespace broker
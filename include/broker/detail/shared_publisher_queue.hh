@@ -102,6 +102,22 @@ public:
     return xs_old_size == 0;
   }
 
+  /// Like `produce`, but never blocks. Hence, this function can exceed the
+  /// capacity of the queue arbitrarily. Only the consumer may call this
+  /// function, because it would otherwise wait for itself.
+  /// @returns true if the caller must wake up the consumer.
+  template <class Iterator>
+  bool append(const topic& t, Iterator first, Iterator last) {
+    guard_type guard{this->mtx_};
+    auto& xs = this->xs_;
+    auto xs_old_size = xs.size();
+    for (; first != last; ++first)
+      xs.emplace_back(t, std::move(*first));
+    if (xs.size() >= capacity_ && xs_old_size < capacity_)
+      this->fx_.extinguish();
+    return xs_old_size == 0;
+  }
+
   size_t capacity() const {
     return capacity_;
   }
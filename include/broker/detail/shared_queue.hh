@@ -74,6 +74,11 @@ public:
     return fx_.await_one(abs_timeout);
   }
 
+  /// Busy-waits for up to `window` until the flare becomes ready.
+  bool spin_on_flare(timespan window) {
+    return fx_.spin_one(window);
+  }
+
 protected:
   shared_queue() : pending_(0) {
     // nop
@@ -57,22 +57,28 @@ public:
   }
 
   std::vector<value_type> consume_all() {
-    guard_type guard{this->mtx_};
-
     std::vector<value_type> rval;
+    consume_all(rval);
+    return rval;
+  }
+
+  // Appends all items to `buf`. Returns the number of consumed elements.
+  size_t consume_all(std::vector<value_type>& buf) {
+    guard_type guard{this->mtx_};
 
     if (this->xs_.empty())
-      return rval;
+      return 0;
 
-    rval.reserve(this->xs_.size());
+    auto n = this->xs_.size();
+    buf.reserve(buf.size() + n);
 
     for (auto& x : this->xs_)
-      rval.emplace_back(std::move(x));
+      buf.emplace_back(std::move(x));
 
     this->xs_.clear();
     this->fx_.extinguish_one();
 
-    return rval;
+    return n;
   }
 
   // Inserts the range `[i, e)` into the queue.
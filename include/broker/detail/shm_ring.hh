@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace broker {
+namespace detail {
+
+/// A single-producer, single-consumer byte ring in memory that two processes
+/// share. The ring never blocks. Instead, either side can announce that it
+/// is about to sleep, in which case the other side must wake it up through
+/// some external channel after making progress.
+///
+/// The other process can write to the header at any time. Hence, the ring
+/// copies the capacity once when attaching and checks head and tail on
+/// every access. It never reads or writes outside of its memory, even if
+/// the other process corrupts the header.
+class shm_ring {
+public:
+  /// Signals that the header is corrupt, i.e., that the other process
+  /// violated the protocol.
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  /// Shared state at the beginning of the ring memory. Head and tail are
+  /// monotonic byte counters.
+  struct header {
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> reader_waiting;
+    std::atomic<uint32_t> writer_waiting;
+    uint64_t capacity;
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "shared memory requires lock-free 64-bit atomics");
+
+  /// Returns how many bytes a ring with `capacity` bytes occupies.
+  static constexpr size_t memory_size(size_t capacity) {
+    return sizeof(header) + capacity;
+  }
+
+  /// Constructs a new ring in `mem`, which must provide at least
+  /// `memory_size(capacity)` bytes.
+  /// @pre `capacity` is a power of two
+  static shm_ring init(void* mem, size_t capacity);
+
+  /// Attaches to a ring that some process created via `init` in a memory
+  /// region of `size` bytes.
+  /// @returns an invalid ring if the header does not describe a ring that
+  ///          fits into `size` bytes.
+  static shm_ring attach(void* mem, size_t size);
+
+  /// Constructs an invalid ring.
+  shm_ring();
+
+  /// Moves up to `len` bytes from the ring to `buf`. Only the reader may call
+  /// this member function.
+  /// @returns the number of moved bytes or `npos` if the header is corrupt.
+  size_t read(void* buf, size_t len);
+
+  /// Moves up to `len` bytes from `buf` to the ring. Only the writer may call
+  /// this member function.
+  /// @returns the number of moved bytes or `npos` if the header is corrupt.
+  size_t write(const void* buf, size_t len);
+
+  /// Returns the number of bytes that wait for the reader or `npos` if the
+  /// header is corrupt.
+  size_t size() const noexcept;
+
+  /// Returns the maximum number of bytes in the ring.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /// Returns the number of bytes the writer can add before the ring is full.
+  size_t space() const noexcept {
+    auto n = size();
+    return n == npos ? 0 : capacity() - n;
+  }
+
+  /// Announces that the reader goes to sleep.
+  /// @returns `true` if the ring is still empty, `false` if the reader must
+  ///          continue reading.
+  bool await_data();
+
+  /// Announces that the writer goes to sleep.
+  /// @returns `true` if the ring is still full, `false` if the writer must
+  ///          continue writing.
+  bool await_space();
+
+  /// Checks whether the reader announced going to sleep and resets the flag.
+  /// The writer calls this after `write` and wakes up the reader if it
+  /// returns `true`.
+  bool wake_reader();
+
+  /// Checks whether the writer announced going to sleep and resets the flag.
+  /// The reader calls this after `read` and wakes up the writer if it
+  /// returns `true`.
+  bool wake_writer();
+
+  /// Checks whether the writer already consumed the announcement of the
+  /// reader, i.e., whether a wakeup is pending for the reader.
+  bool reader_wakeup_pending() const noexcept {
+    return hdr_->reader_waiting.load() == 0;
+  }
+
+  explicit operator bool() const noexcept {
+    return hdr_ != nullptr;
+  }
+
+private:
+  shm_ring(void* mem, size_t capacity);
+
+  char* data() const noexcept {
+    return reinterpret_cast<char*>(hdr_ + 1);
+  }
+
+  /// Returns `tail - head` or `npos` if the result exceeds the capacity.
+  size_t distance(uint64_t head, uint64_t tail) const noexcept {
+    auto n = tail - head;
+    return n <= capacity_ ? static_cast<size_t>(n) : npos;
+  }
+
+  header* hdr_;
+
+  /// Copy of `hdr_->capacity` from the time of attaching.
+  size_t capacity_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -15,6 +15,13 @@ public:
   /// Required parameters:
   ///   - `path`: a `std::string` representing the location of the database on
   ///             the filesystem.
+  /// Optional parameters:
+  ///   - `journal_mode`: a `std::string` that sets the SQLite journal mode,
+  ///                     i.e., `delete` (default), `truncate`, `persist`,
+  ///                     `memory`, `wal` or `off`.
+  ///   - `synchronous`: a `std::string` that sets how often SQLite waits for
+  ///                    data to reach the disk, i.e., `off`, `normal`, `full`
+  ///                    (default) or `extra`.
   sqlite_backend(backend_options opts = backend_options{});
 
   ~sqlite_backend();
@@ -34,6 +41,9 @@ public:
 
   expected<bool> expire(const data& key, timestamp current_time) override;
 
+  expected<std::vector<data>> bulk_expire(const std::vector<data>& keys,
+                                          timestamp current_time) override;
+
   expected<data> get(const data& key) const override;
 
   expected<bool> exists(const data& key) const override;
@@ -44,8 +54,16 @@ public:
 
   expected<broker::snapshot> snapshot() const override;
 
+  expected<snapshot_cursor_ptr> cursor() const override;
+
+  bool cursor_is_isolated() const override;
+
   expected<expirables> expiries() const override;
 
+  expected<void> begin_transaction() override;
+
+  expected<void> commit_transaction() override;
+
 private:
   struct impl;
   std::unique_ptr<impl> impl_;
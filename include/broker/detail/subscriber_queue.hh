@@ -0,0 +1,42 @@
+#pragma once
+
+#include <caf/intrusive_ptr.hpp>
+
+#include "broker/config.hh"
+#include "broker/message.hh"
+
+#ifdef BROKER_LOCK_FREE_QUEUES
+#include "broker/detail/lock_free_subscriber_queue.hh"
+#else
+#include "broker/detail/shared_subscriber_queue.hh"
+#endif
+
+namespace broker {
+namespace detail {
+
+/// Selects the queue implementation for subscribers at build time.
+#ifdef BROKER_LOCK_FREE_QUEUES
+template <class ValueType = data_message>
+using subscriber_queue = lock_free_subscriber_queue<ValueType>;
+#else
+template <class ValueType = data_message>
+using subscriber_queue = shared_subscriber_queue<ValueType>;
+#endif
+
+template <class ValueType = data_message>
+using subscriber_queue_ptr = caf::intrusive_ptr<subscriber_queue<ValueType>>;
+
+/// Creates a subscriber queue. Only the lock-free implementation uses
+/// `capacity_hint` for sizing its ring buffer.
+template <class ValueType = data_message>
+subscriber_queue_ptr<ValueType> make_subscriber_queue(size_t capacity_hint) {
+#ifdef BROKER_LOCK_FREE_QUEUES
+  return make_lock_free_subscriber_queue<ValueType>(capacity_hint);
+#else
+  CAF_IGNORE_UNUSED(capacity_hint);
+  return make_shared_subscriber_queue<ValueType>();
+#endif
+}
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "broker/detail/topic_table.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+namespace broker {
+namespace detail {
+
+/// Assigns small integers to the topics of messages on an outbound peer path.
+/// The first message with a given topic defines the entry by carrying the
+/// full topic string, all subsequent messages only carry the integer. See
+/// `node_message::topic_ref` for the encoding.
+class topic_encoder {
+public:
+  /// Maximum number of entries per path. Topics that do not fit into the
+  /// dictionary anymore go over the wire as strings.
+  static constexpr uint32_t max_size = 0x7FFFFFFF;
+
+  /// Sets the `topic_ref` field of `x`.
+  void encode(node_message& x);
+
+  /// Returns the number of entries in the dictionary.
+  size_t size() const noexcept {
+    return ids_.size();
+  }
+
+private:
+  /// Maps interned topics to dictionary entries.
+  std::unordered_map<topic_id, uint32_t> ids_;
+};
+
+/// Restores topics on an inbound peer path from the dictionary that the
+/// remote ::topic_encoder builds up.
+class topic_decoder {
+public:
+  /// Restores the topic of `x` if necessary and resets its `topic_ref`.
+  /// @returns `false` if `x` refers to an unknown entry, `true` otherwise.
+  bool decode(node_message& x);
+
+  /// Returns the number of entries in the dictionary.
+  size_t size() const noexcept {
+    return topics_.size();
+  }
+
+private:
+  /// Stores entry `n` at index `n - 1`.
+  std::vector<topic> topics_;
+};
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace broker {
+namespace detail {
+
+/// Compact, process-wide identifier for a topic.
+using topic_id = uint32_t;
+
+/// Precomputed properties of an interned topic.
+enum topic_flags : uint8_t {
+  /// The topic ends with `topics::master_suffix`.
+  master_topic_flag = 0x01,
+  /// The topic ends with `topics::clone_suffix`.
+  clone_topic_flag = 0x02,
+};
+
+/// Computes the ::topic_flags for `str`.
+uint8_t make_topic_flags(const std::string& str);
+
+/// A topic string with its ID, cached hash value and flags.
+struct interned_topic {
+  topic_id id;
+  size_t hash;
+  uint8_t flags;
+  std::string str;
+};
+
+/// A process-wide table for interning topics. Entries live until the process
+/// terminates, i.e., pointers to interned topics never become invalid.
+class topic_table {
+public:
+  /// Maximum number of entries. Interning fails once the table reaches this
+  /// size to protect against applications that generate topics dynamically.
+  static constexpr size_t max_size = 1 << 20;
+
+  /// Returns the interned representation of `str` or `nullptr` if the table
+  /// is full.
+  const interned_topic* intern(const std::string& str);
+
+  /// Returns the number of interned topics.
+  size_t size() const;
+
+  /// Returns the process-wide table.
+  static topic_table& instance();
+
+private:
+  topic_table() = default;
+
+  mutable std::shared_mutex mtx_;
+
+  /// Stores all entries. A deque never moves elements when growing.
+  std::deque<interned_topic> entries_;
+
+  /// Maps topic strings to entries. Keys point into `entries_`.
+  std::unordered_map<std::string_view, const interned_topic*> index_;
+};
+
+} // namespace detail
+} // namespace broker
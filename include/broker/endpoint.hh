@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <atomic>
 
@@ -14,6 +15,7 @@
 #include <caf/message.hpp>
 #include <caf/node_id.hpp>
 #include <caf/stream.hpp>
+#include <caf/stream_manager.hpp>
 #include <caf/timespan.hpp>
 #include <caf/timestamp.hpp>
 
@@ -33,6 +35,8 @@
 #include "broker/time.hh"
 #include "broker/topic.hh"
 
+#include "broker/detail/local_dispatcher.hh"
+
 namespace broker {
 
 /// The main publish/subscribe abstraction. Endpoints can *peer* which each
@@ -132,10 +136,21 @@ public:
   /// @param port The port to listen locally. If 0, the endpoint selects the
   ///             next available free port from the OS
   /// @returns The port the endpoint bound to or 0 on failure.
+  /// @note With `broker.peer-stripes` set to N > 1, the endpoint additionally
+  ///       listens at N - 1 ports that the OS picks, one for each stripe.
+  ///       Remote endpoints learn these ports during the handshake.
+  /// @note Passing an address of the form `shm://name` accepts peers on the
+  ///       same host over shared memory instead of TCP (Linux only). In this
+  ///       case, `port` must not be 0 and peers connect via
+  ///       `peer("shm://name", port)`. Only processes of the same user may
+  ///       connect. Shared memory never uses SSL, so the endpoint refuses
+  ///       `shm://` addresses unless the configuration disables SSL.
   uint16_t listen(const std::string& address = {}, uint16_t port = 0);
 
   /// Initiates a peering with a remote endpoint.
-  /// @param address The IP address of the remote endpoint.
+  /// @param address The IP address of the remote endpoint or `shm://name`
+  ///                for an endpoint on the same host that listens on this
+  ///                address (see `listen`).
   /// @param port The TCP port of the remote endpoint.
   /// @param retry If non-zero, seconds after which to retry if connection
   ///        cannot be established, or breaks.
@@ -173,6 +188,29 @@ public:
   ///       indicating sucess or failure.
   void unpeer_nosync(const std::string& address, uint16_t port);
 
+  /// Listens at a Unix domain socket to accept peers on the same host.
+  /// @param path The file system path of the socket. Replaces a stale socket
+  ///             file at `path`, but never any other kind of file.
+  /// @returns True if the endpoint accepts peers at `path`.
+  /// @note The file system permissions of `path` control who may connect.
+  ///       Connections never use SSL. Hence, the endpoint refuses to listen
+  ///       unless the configuration disables SSL.
+  bool listen_unix(const std::string& path);
+
+  /// Initiates a peering with an endpoint on the same host that listens at
+  /// the Unix domain socket `path` (see `listen_unix`).
+  /// @param path The file system path of the socket.
+  /// @param retry If non-zero, seconds after which to retry if connection
+  ///        cannot be established, or breaks.
+  /// @returns True if connection was successfully set up.
+  bool peer_unix(const std::string& path,
+                 timeout::seconds retry = timeout::seconds(10));
+
+  /// Shuts down a peering that `peer_unix` established.
+  /// @param path The file system path of the socket.
+  /// @returns True if connection was successfully torn down.
+  bool unpeer_unix(const std::string& path);
+
   /// Retrieves a list of all known peers.
   /// @returns A pointer to the list
   std::vector<peer_info> peers() const;
@@ -206,6 +244,10 @@ public:
 
   publisher make_publisher(topic ts);
 
+  /// Creates a publisher that groups messages into batches before sending
+  /// them to the core. See ::batching_options.
+  publisher make_publisher(topic ts, batching_options opts);
+
   /// Starts a background worker from the given set of functions that publishes
   /// a series of messages. The worker will run in the background, but `init`
   /// is guaranteed to be called before the function returns.
@@ -267,13 +309,7 @@ public:
     std::mutex mx;
     std::condition_variable cv;
     auto res = make_actor([=,&mx,&cv](caf::event_based_actor* self) {
-      self->send(self * core(), atom::join::value, std::move(topics));
-      self->become(
-        [=](const stream_type& in) {
-          self->make_sink(in, init, f, cleanup);
-          self->unbecome();
-        }
-      );
+      join_all(self, std::move(topics), init, f, cleanup);
       std::unique_lock<std::mutex> guard{mx};
       cv.notify_one();
     });
@@ -288,13 +324,7 @@ public:
   caf::actor subscribe_nosync(std::vector<topic> topics, Init init,
                               HandleMessage f, Cleanup cleanup) {
     return make_actor([=](caf::event_based_actor* self) {
-      self->send(self * core(), atom::join::value, std::move(topics));
-      self->become(
-        [=](const stream_type& in) {
-          self->make_sink(in, init, f, cleanup);
-          self->unbecome();
-        }
-      );
+      join_all(self, std::move(topics), init, f, cleanup);
     });
   }
 
@@ -380,25 +410,71 @@ public:
     return core_;
   }
 
+  /// Returns all core actors of this endpoint. The first element is always
+  /// the primary core actor returned by `core()`. Unless setting
+  /// `broker.core-shards` or `broker.peer-stripes`, this list only contains
+  /// the primary core actor.
+  const std::vector<caf::actor>& cores() const {
+    return cores_;
+  }
+
+  /// Returns the core actor responsible for routing messages on topic `t`.
+  const caf::actor& core_for(const topic& t) const;
+
   const configuration& config() const {
     return config_;
   }
 
+  /// Returns the dispatcher for delivering messages from local publishers to
+  /// local subscribers directly or `nullptr` unless setting
+  /// `broker.local-delivery`.
+  const detail::local_dispatcher_ptr& local_dispatcher() const {
+    return local_dispatcher_;
+  }
+
 protected:
   caf::actor subscriber_;
 
 private:
   caf::actor make_actor(actor_init_fun f);
 
+  /// Accepts peers at a `shm://` or `unix://` address.
+  expected<uint16_t> listen_locally(const std::string& address,
+                                    uint16_t port);
+
+  /// Subscribes `self` to `topics` on all cores and merges the incoming
+  /// streams into a single sink.
+  template <class Init, class HandleMessage, class Cleanup>
+  void join_all(caf::event_based_actor* self, std::vector<topic> topics,
+                Init init, HandleMessage f, Cleanup cleanup) {
+    for (auto& hdl : cores_)
+      self->send(self * hdl, atom::join::value, topics);
+    auto mgr = std::make_shared<caf::stream_manager_ptr>();
+    auto pending = std::make_shared<size_t>(cores_.size());
+    self->become(
+      [=](const stream_type& in) {
+        if (*mgr == nullptr)
+          *mgr = self->make_sink(in, init, f, cleanup).ptr();
+        else
+          (*mgr)->add_unchecked_inbound_path(in);
+        if (--*pending == 0)
+          self->unbecome();
+      }
+    );
+  }
+
   configuration config_;
   union {
     mutable caf::actor_system system_;
   };
   caf::actor core_;
+  std::vector<caf::actor> cores_;
   bool await_stores_on_shutdown_;
   std::vector<caf::actor> children_;
   bool destroyed_;
   clock* clock_;
+  detail::local_dispatcher_ptr local_dispatcher_;
+  std::vector<std::unique_ptr<detail::peer_stripe>> stripes_;
 };
 
 } // namespace broker
@@ -20,6 +20,7 @@ struct endpoint_info;
 struct network_info;
 struct peer_info;
 
+struct batching_options;
 class publisher;
 class subscriber;
 class topic;
@@ -69,6 +70,7 @@ namespace detail {
 
 class flare_actor;
 class mailbox;
+class peer_stripe;
 
 } // namespace detail
 
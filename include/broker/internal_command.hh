@@ -76,15 +76,20 @@ typename Inspector::result_type inspect(Inspector& f, subtract_command& x) {
   return f(caf::meta::type_name("subtract"), x.key, x.value, x.expiry);
 }
 
-/// Causes the master to reply with a snapshot of its state.
+/// Causes the master to reply with a snapshot of its state or, if possible,
+/// with all updates that the clone has missed since `last_seq`.
 struct snapshot_command {
   caf::actor remote_core;
   caf::actor remote_clone;
+  /// Sequence number of the last update that the clone has applied or 0 for
+  /// requesting a full snapshot.
+  uint64_t last_seq = 0;
 };
 
 template <class Inspector>
 typename Inspector::result_type inspect(Inspector& f, snapshot_command& x) {
-  return f(caf::meta::type_name("snapshot"), x.remote_core, x.remote_clone);
+  return f(caf::meta::type_name("snapshot"), x.remote_core, x.remote_clone,
+           x.last_seq);
 }
 
 /// Since snapshots are sent to clones on a different channel, this allows
@@ -141,6 +146,9 @@ public:
 
   variant_type content;
 
+  /// Sequence number that the master assigned to this update or 0.
+  uint64_t seq = 0;
+
   internal_command(variant_type value);
 
   internal_command() = default;
@@ -157,7 +165,7 @@ internal_command make_internal_command(Ts&&... xs) {
 
 template <class Inspector>
 typename Inspector::result_type inspect(Inspector& f, internal_command& x) {
-  return f(caf::meta::type_name("internal_command"), x.content);
+  return f(caf::meta::type_name("internal_command"), x.content, x.seq);
 }
 
 namespace detail {
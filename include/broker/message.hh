@@ -1,11 +1,15 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
 #include <caf/cow_tuple.hpp>
+#include <caf/fwd.hpp>
+#include <caf/sec.hpp>
 #include <caf/variant.hpp>
 
 #include "broker/data.hh"
+#include "broker/detail/payload_buffer.hh"
 #include "broker/internal_command.hh"
 #include "broker/topic.hh"
 
@@ -28,6 +32,30 @@ struct node_message {
 
   /// Time-to-life counter.
   uint16_t ttl;
+
+  /// Refers to an entry in the topic dictionary of a peer path. A value of 0
+  /// means that the message carries its topic as string without using the
+  /// dictionary. Otherwise, the upper 31 bits denote the entry and the lowest
+  /// bit is set if the message carries the topic string to define the entry.
+  uint32_t topic_ref = 0;
+
+  /// Identifies the core that published this message or 0 if the message
+  /// carries no ID. Together with `seq`, allows receivers to drop messages
+  /// that arrive more than once over different paths.
+  uint64_t origin = 0;
+
+  /// Sequence number of this message at `origin`.
+  uint64_t seq = 0;
+
+  /// Serialized form of the data in `content` or `nullptr`. Peer paths share
+  /// this buffer to serialize the data only once. Never modify the content of
+  /// a message that carries a payload buffer.
+  detail::payload_buffer_ptr payload;
+
+  /// Set if `content` holds a placeholder instead of the data in `payload`.
+  /// Messages from peers skip deserializing their data until a local
+  /// subscriber needs it. See ::materialize.
+  bool lazy = false;
 };
 
 /// Returns whether `x` contains a ::node_message.
@@ -50,10 +78,24 @@ inline bool is_command_message(const node_message& x) {
   return is_command_message(x.content);
 }
 
-/// @relates node_message
-template <class Inspector>
-typename Inspector::result_type inspect(Inspector& f, node_message& x) {
-  return f(x.content, x.ttl);
+/// Returns whether `x` omits its topic string on the wire, because it refers
+/// to a known entry in the topic dictionary of a peer path.
+inline bool omits_topic(const node_message& x) {
+  return x.topic_ref != 0 && (x.topic_ref & 1) == 0;
+}
+
+/// Deserializes the data of `x` from its payload buffer unless `x` already
+/// holds the data.
+/// @returns `false` if the payload is malformed, `true` otherwise.
+inline bool materialize(node_message& x) {
+  if (!x.lazy)
+    return true;
+  data d;
+  if (!detail::decode_payload(*x.payload, d))
+    return false;
+  get<1>(caf::get<data_message>(x.content).unshared()) = std::move(d);
+  x.lazy = false;
+  return true;
 }
 
 /// Generates a broker ::data_message.
@@ -157,4 +199,95 @@ inline internal_command::variant_type&& move_command(command_message& x) {
   return std::move(get<1>(x.unshared()).content);
 }
 
+/// Flags in the tag that precedes each ::node_message on the wire.
+enum node_message_tag : uint8_t {
+  /// Set if the message carries a command instead of data.
+  command_message_tag = 0x01,
+  /// Set if the message carries its origin and sequence number.
+  message_id_tag = 0x02,
+};
+
+/// @relates node_message
+template <class Inspector>
+typename Inspector::result_type inspect(Inspector& f, node_message& x) {
+  // Tags the type of the content on the wire.
+  uint8_t tag = 0;
+  if constexpr (Inspector::reads_state) {
+    // Serializers never modify the content, so casting away const is safe
+    // and avoids a deep copy of the (shared) tuple via `unshared()`.
+    auto& t = const_cast<topic&>(get_topic(x));
+    if constexpr (std::is_base_of<caf::serializer, Inspector>::value) {
+      if (!is_data_message(x))
+        tag |= command_message_tag;
+      if (x.origin != 0)
+        tag |= message_id_tag;
+      if (auto err = f(tag, x.ttl, x.topic_ref))
+        return err;
+      if (x.origin != 0)
+        if (auto err = f(x.origin, x.seq))
+          return err;
+      if (!omits_topic(x))
+        if (auto err = f(t))
+          return err;
+      if (is_data_message(x)) {
+        // Data goes over the wire as length-prefixed blob, which allows us to
+        // write a previously serialized payload with a single memcpy.
+        auto ptr = x.payload ? x.payload
+                             : detail::make_payload_buffer(
+                               get_data(caf::get<data_message>(x.content)));
+        if (!ptr)
+          return caf::sec::unsupported_operation;
+        return detail::write_payload(f, *ptr);
+      }
+      auto& c = const_cast<internal_command&>(
+        get<1>(caf::get<command_message>(x.content)));
+      return f(c);
+    } else {
+      if (is_data_message(x)) {
+        auto& d = const_cast<data&>(
+          get_data(caf::get<data_message>(x.content)));
+        if (omits_topic(x))
+          return f(tag, x.ttl, x.topic_ref, x.origin, x.seq, d);
+        return f(tag, x.ttl, x.topic_ref, x.origin, x.seq, t, d);
+      }
+      tag = command_message_tag;
+      auto& c = const_cast<internal_command&>(
+        get<1>(caf::get<command_message>(x.content)));
+      if (omits_topic(x))
+        return f(tag, x.ttl, x.topic_ref, x.origin, x.seq, c);
+      return f(tag, x.ttl, x.topic_ref, x.origin, x.seq, t, c);
+    }
+  } else {
+    topic t;
+    if (auto err = f(tag, x.ttl, x.topic_ref))
+      return err;
+    if ((tag & message_id_tag) != 0) {
+      if (auto err = f(x.origin, x.seq))
+        return err;
+    } else {
+      x.origin = 0;
+      x.seq = 0;
+    }
+    if (!omits_topic(x))
+      if (auto err = f(t))
+        return err;
+    if ((tag & command_message_tag) == 0) {
+      // Keep the serialized data as-is, because relays only forward it to
+      // other peers. The core calls `materialize` for local subscribers.
+      if (auto err = detail::read_payload(f, x.payload))
+        return err;
+      x.content = make_data_message(std::move(t), data{});
+      x.lazy = true;
+    } else {
+      internal_command c;
+      if (auto err = f(c))
+        return err;
+      x.content = make_command_message(std::move(t), std::move(c));
+      x.payload = nullptr;
+      x.lazy = false;
+    }
+    return {};
+  }
+}
+
 } // namespace broker
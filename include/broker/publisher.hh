@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <cstddef>
+#include <memory>
 #include <vector>
 
 #include <caf/actor.hpp>
@@ -9,11 +10,31 @@
 #include "broker/atoms.hh"
 #include "broker/fwd.hh"
 #include "broker/message.hh"
+#include "broker/time.hh"
 
-#include "broker/detail/shared_publisher_queue.hh"
+#include "broker/detail/local_dispatcher.hh"
+#include "broker/detail/publisher_queue.hh"
 
 namespace broker {
 
+/// Configures how a publisher groups messages into batches. A publisher
+/// flushes its current batch when it reaches `max_size` messages or when its
+/// first message has waited for `max_delay`, whichever comes first. Larger
+/// batches and longer delays increase throughput at the cost of latency.
+struct batching_options {
+  /// Maximum number of messages per batch.
+  size_t max_size = 100;
+
+  /// Maximum time a message waits in the batch before the publisher sends it.
+  timespan max_delay = std::chrono::milliseconds(10);
+
+  /// Sends each batch as a single `zeek::Batch` message if `true`, otherwise
+  /// hands all messages of a batch to the core at once but individually.
+  /// Only enable this for Zeek messages, since subscribers receive the
+  /// wrapper instead of the published data.
+  bool zeek_batch = false;
+};
+
 /// Provides asynchronous publishing of data with demand management.
 class publisher {
 public:
@@ -27,6 +48,10 @@ public:
 
   using guard_type = std::unique_lock<std::mutex>;
 
+  /// Messages that wait for the next flush. Shared with the worker, which
+  /// enforces the maximum delay.
+  struct batch_state;
+
   // --- constructors and destructors ------------------------------------------
 
   publisher(publisher&&) = default;
@@ -85,14 +110,30 @@ public:
   /// Sends `xs` to all subscribers.
   void publish(std::vector<data> xs);
 
+  /// Sends all messages of the current batch immediately. Has no effect if
+  /// this publisher does not group messages into batches.
+  void flush();
+
 private:
   // -- force users to use `endpoint::make_publsiher` -------------------------
   publisher(endpoint& ep, topic t);
 
+  publisher(endpoint& ep, topic t, batching_options opts);
+
+  /// Moves `xs` to the queue, waking up the worker as needed.
+  void produce(std::vector<data> xs);
+
+  /// Hands `x` to all matching subscribers of the same endpoint directly.
+  /// Has no effect unless setting `broker.local-delivery`.
+  void deliver_locally(const data& x);
+
   bool drop_on_destruction_;
-  detail::shared_publisher_queue_ptr<> queue_;
+  std::shared_ptr<batch_state> batch_;
+  detail::publisher_queue_ptr<> queue_;
   caf::actor worker_;
   topic topic_;
+  detail::local_dispatcher_ptr local_;
+  detail::local_dispatcher::route_ptr local_route_;
 };
 
 } // namespace broker
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <utility>
 
 #include "broker/data.hh"
 
@@ -9,4 +10,8 @@ namespace broker {
 /// A snapshot of a data store's contents.
 using snapshot = std::unordered_map<data, data>;
 
+/// A single key-value pair of a snapshot. Masters stream snapshots to their
+/// clones as sequence of entries.
+using snapshot_entry = std::pair<data, data>;
+
 } // namespace broker
@@ -11,7 +11,7 @@
 #include "broker/subscriber_base.hh"
 #include "broker/bad_variant_access.hh"
 
-#include "broker/detail/shared_subscriber_queue.hh"
+#include "broker/detail/subscriber_queue.hh"
 
 namespace broker {
 
@@ -11,7 +11,8 @@
 #include "broker/subscriber_base.hh"
 #include "broker/topic.hh"
 
-#include "broker/detail/shared_subscriber_queue.hh"
+#include "broker/detail/local_dispatcher.hh"
+#include "broker/detail/subscriber_queue.hh"
 
 namespace broker {
 
@@ -54,9 +55,13 @@ private:
   // -- force users to use `endpoint::make_status_subscriber` -------------------
   subscriber(endpoint& ep, std::vector<topic> ts, size_t max_qsize);
 
+  /// Propagates `filter_` to the local dispatcher (if any).
+  void update_local_filter();
+
   caf::actor worker_;
   std::vector<topic> filter_;
   std::reference_wrapper<endpoint> ep_;
+  detail::local_dispatcher_ptr local_;
 };
 
 } // namespace broker
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <vector>
 
 #include <caf/actor.hpp>
@@ -9,9 +11,10 @@
 
 #include "broker/data.hh"
 #include "broker/detail/assert.hh"
-#include "broker/detail/shared_subscriber_queue.hh"
+#include "broker/detail/subscriber_queue.hh"
 #include "broker/fwd.hh"
 #include "broker/logger.hh"
+#include "broker/time.hh"
 #include "broker/topic.hh"
 
 namespace broker {
@@ -32,15 +35,17 @@ public:
 
   using value_type = ValueType;
 
-  using queue_type = detail::shared_subscriber_queue<value_type>;
+  using queue_type = detail::subscriber_queue<value_type>;
 
-  using queue_ptr = detail::shared_subscriber_queue_ptr<value_type>;
+  using queue_ptr = detail::subscriber_queue_ptr<value_type>;
 
   // --- constructors and destructors ------------------------------------------
 
   subscriber_base(long max_qsize)
-    : queue_(detail::make_shared_subscriber_queue<value_type>()),
-      max_qsize_(max_qsize) {
+    : queue_(detail::make_subscriber_queue<value_type>(
+        static_cast<size_t>(max_qsize))),
+      max_qsize_(max_qsize),
+      busy_poll_(0) {
     // nop
   }
 
@@ -98,26 +103,8 @@ public:
   /// `num` elements.
   std::vector<value_type> get(size_t num, caf::timestamp timeout) {
     std::vector<value_type> result;
-    if (num == 0)
-      return result;
-    if (timeout <= std::chrono::system_clock::now())
-      return result;
-    result.reserve(num);
-    for (;;) {
-      if (!queue_->wait_on_flare_abs(timeout))
-        return result;
-      size_t prev_size = 0;
-      auto remaining = num - result.size();
-      auto got = queue_->consume(remaining, &prev_size, [&](value_type&& x) {
-        BROKER_DEBUG("received" << x);
-        result.emplace_back(std::move(x));
-      });
-      if (prev_size >= static_cast<size_t>(max_qsize_)
-          && prev_size - got < static_cast<size_t>(max_qsize_))
-        became_not_full();
-      if (result.size() == num)
-        return result;
-    }
+    get(result, num, timeout);
+    return result;
   }
 
   /// Pulls `num` values out of the stream. Blocks the current thread until
@@ -126,37 +113,74 @@ public:
   /// `num` elements.
   std::vector<value_type> get(size_t num,
                               duration relative_timeout = infinite) {
+    std::vector<value_type> result;
+    get(result, num, relative_timeout);
+    return result;
+  }
+
+  /// Pulls `num` values out of the stream into `buf`, replacing its previous
+  /// content. Blocks the current thread until `num` elements are available or
+  /// a timeout occurs. Reusing the same buffer avoids heap allocations once
+  /// its capacity reaches `num`.
+  /// @returns the number of values in `buf`, which is less than `num` only
+  ///          on timeout.
+  size_t get(std::vector<value_type>& buf, size_t num,
+             caf::timestamp timeout) {
+    buf.clear();
+    if (num == 0)
+      return 0;
+    if (timeout <= std::chrono::system_clock::now())
+      return 0;
+    buf.reserve(num);
+    for (;;) {
+      if (!await_data(timeout))
+        return buf.size();
+      if (consume(buf, num) == num)
+        return num;
+    }
+  }
+
+  /// Pulls `num` values out of the stream into `buf`, replacing its previous
+  /// content. Blocks the current thread until `num` elements are available or
+  /// a timeout occurs. Reusing the same buffer avoids heap allocations once
+  /// its capacity reaches `num`.
+  /// @returns the number of values in `buf`, which is less than `num` only
+  ///          on timeout.
+  size_t get(std::vector<value_type>& buf, size_t num,
+             duration relative_timeout = infinite) {
     if (relative_timeout.valid()) {
       timestamp timeout = std::chrono::system_clock::now();
       timeout += relative_timeout;
-      return get(num, timeout);
+      return get(buf, num, timeout);
     }
-    std::vector<value_type> result;
+    buf.clear();
     if (num == 0)
-      return result;
-    result.reserve(num);
+      return 0;
+    buf.reserve(num);
     for (;;) {
-      queue_->wait_on_flare();
-      size_t prev_size = 0;
-      auto remaining = num - result.size();
-      auto got = queue_->consume(remaining, &prev_size, [&](value_type&& x) {
-        BROKER_DEBUG("received" << x);
-        result.emplace_back(std::move(x));
-      });
-      if (prev_size >= static_cast<size_t>(max_qsize_)
-          && prev_size - got < static_cast<size_t>(max_qsize_))
-        became_not_full();
-      if (result.size() == num)
-        return result;
+      await_data();
+      if (consume(buf, num) == num)
+        return num;
     }
   }
 
   /// Returns all currently available values without blocking.
   std::vector<value_type> poll() {
-    auto rval = queue_->consume_all();
-    if (rval.size() >= static_cast<size_t>(max_qsize_))
+    std::vector<value_type> result;
+    poll(result);
+    return result;
+  }
+
+  /// Moves all currently available values into `buf` without blocking,
+  /// replacing its previous content. Reusing the same buffer avoids heap
+  /// allocations once its capacity suffices for a typical batch.
+  /// @returns the number of values in `buf`.
+  size_t poll(std::vector<value_type>& buf) {
+    buf.clear();
+    auto n = queue_->consume_all(buf);
+    if (n >= static_cast<size_t>(max_qsize_))
       became_not_full();
-    return rval;
+    return n;
   }
 
   // --- accessors -------------------------------------------------------------
@@ -173,6 +197,21 @@ public:
     return queue_->fd();
   }
 
+  /// Returns how long blocking `get` calls spin before waiting on `fd()`.
+  timespan busy_poll() const {
+    return busy_poll_;
+  }
+
+  // --- mutators --------------------------------------------------------------
+
+  /// Configures blocking `get` calls to busy-wait for new values for up to
+  /// `window` before blocking on `fd()`. Spinning avoids the wake-up latency
+  /// of `poll` at the cost of burning CPU cycles while waiting. A window of
+  /// zero (the default) disables spinning.
+  void set_busy_poll(timespan window) {
+    busy_poll_ = window;
+  }
+
 protected:
   /// This hook allows subclasses to perform some action if the queue changed
   /// state from full to not-full. This allows subscribers to make sure new
@@ -183,6 +222,39 @@ protected:
 
   queue_ptr queue_;
   long max_qsize_;
+
+private:
+  /// Moves values from the queue to `buf` until it holds `num` values.
+  /// @returns the new size of `buf`.
+  size_t consume(std::vector<value_type>& buf, size_t num) {
+    size_t prev_size = 0;
+    auto got = queue_->consume(num - buf.size(), &prev_size,
+                               [&](value_type&& x) {
+                                 BROKER_DEBUG("received" << x);
+                                 buf.emplace_back(std::move(x));
+                               });
+    if (prev_size >= static_cast<size_t>(max_qsize_)
+        && prev_size - got < static_cast<size_t>(max_qsize_))
+      became_not_full();
+    return buf.size();
+  }
+
+  void await_data() {
+    if (busy_poll_.count() > 0 && queue_->spin_on_flare(busy_poll_))
+      return;
+    queue_->wait_on_flare();
+  }
+
+  bool await_data(caf::timestamp timeout) {
+    if (busy_poll_.count() > 0) {
+      auto remaining = timeout - std::chrono::system_clock::now();
+      if (queue_->spin_on_flare(std::min(busy_poll_, timespan{remaining})))
+        return true;
+    }
+    return queue_->wait_on_flare_abs(timeout);
+  }
+
+  timespan busy_poll_;
 };
 
 } // namespace broker
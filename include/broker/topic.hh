@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -9,6 +11,11 @@
 #include "broker/detail/operators.hh"
 
 namespace broker {
+namespace detail {
+
+struct interned_topic;
+
+} // namespace detail
 
 /// A hierachical topic used as pub/sub communication pattern.
 class topic : detail::totally_ordered<topic> {
@@ -32,6 +39,14 @@ public:
   /// Default-constructs an empty topic.
   topic() = default;
 
+  topic(const topic& other);
+
+  topic(topic&& other) noexcept;
+
+  topic& operator=(const topic& other);
+
+  topic& operator=(topic&& other) noexcept;
+
   /// Constructs a topic from a type that is convertible to a string.
   /// @param x A value convertible to a string.
   template <
@@ -40,7 +55,7 @@ public:
       std::is_convertible<T, std::string>::value
     >::type
   >
-  topic(T&& x) : str_(std::forward<T>(x)) {
+  topic(T&& x) : str_(std::forward<T>(x)), interned_(nullptr) {
     clean();
   }
 
@@ -55,15 +70,38 @@ public:
   /// Returns whether this topic is a prefix match for `t`.
   bool prefix_of(const topic& t) const;
 
+  /// Returns the entry for this topic in the process-wide topic table or
+  /// `nullptr` if the table is full. Interns the topic on first access and
+  /// caches the result, i.e., subsequent calls do no string work.
+  const detail::interned_topic* interned() const;
+
+  /// Returns a hash value for this topic.
+  size_t hash() const;
+
+  /// Returns whether this topic addresses a data store master.
+  bool is_master_topic() const;
+
+  /// Returns whether this topic addresses a data store clone.
+  bool is_clone_topic() const;
+
+  friend bool operator==(const topic& lhs, const topic& rhs);
+
   template <class Inspector>
   friend typename Inspector::result_type inspect(Inspector& f, topic& t) {
+    if (Inspector::writes_state)
+      t.interned_ = nullptr;
     return f(t.str_);
   }
 
 private:
   void clean();
 
+  uint8_t flags() const;
+
   std::string str_;
+
+  /// Caches the result of `interned()`.
+  mutable std::atomic<const detail::interned_topic*> interned_{nullptr};
 };
 
 /// @relates topic
@@ -100,7 +138,7 @@ namespace std {
 template <>
 struct hash<broker::topic> {
   size_t operator()(const broker::topic& t) const {
-    return std::hash<std::string>{}(t.string());
+    return t.hash();
   }
 };
 
@@ -13,7 +13,7 @@ constexpr type minor = 2;
 constexpr type patch = 0;
 constexpr auto suffix = "-126";
 
-constexpr type protocol = 2;
+constexpr type protocol = 5;
 
 /// Determines whether two Broker protocol versions are compatible.
 /// @param v The version of the other broker.
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "broker/data.hh"
 
 namespace broker {
@@ -17,7 +19,8 @@ public:
     LogWrite = 3,
     IdentifierUpdate = 4,
     Batch = 5,
-    MAX = Batch,
+    LogWriteBatch = 6,
+    MAX = LogWriteBatch,
   };
 
   Type type() const {
@@ -313,6 +316,119 @@ public:
   }
 };
 
+/// Many Zeek log writes for the same stream, writer and path. Instead of one
+/// nested vector per record, the batch stores the records column by column.
+/// Columns with values of a single type pack them into one string, which
+/// saves a heap allocation per field. String and enum columns store each
+/// distinct value only once in a per-batch dictionary. Columns with mixed
+/// types fall back to a vector of values.
+class LogWriteBatch : public Message {
+public:
+  /// Encodings for a single column.
+  enum ColumnType {
+    Generic = 0,
+    Count = 1,
+    Integer = 2,
+    Real = 3,
+    Timestamp = 4,
+    Timespan = 5,
+    Boolean = 6,
+    Address = 7,
+    Port = 8,
+    String = 9,
+    Enum = 10,
+    MAX_COLUMN_TYPE = Enum,
+  };
+
+  /// @param records The serialized data of each log write. All records must
+  ///                be vectors of the same size. Otherwise, the batch is
+  ///                malformed and `decode` fails.
+  LogWriteBatch(enum_value stream_id, enum_value writer_id, data path,
+                const vector& records)
+    : Message(Message::Type::LogWriteBatch,
+              {std::move(stream_id), std::move(writer_id), std::move(path),
+               count(records.size()), encode(records)}) {
+  }
+
+  LogWriteBatch(data msg) : Message(std::move(msg)) {
+  }
+
+  const enum_value& stream_id() const {
+    return caf::get<enum_value>(caf::get<vector>(as_vector()[2])[0]);
+  }
+
+  enum_value& stream_id() {
+    return caf::get<enum_value>(caf::get<vector>(as_vector()[2])[0]);
+  }
+
+  const enum_value& writer_id() const {
+    return caf::get<enum_value>(caf::get<vector>(as_vector()[2])[1]);
+  }
+
+  enum_value& writer_id() {
+    return caf::get<enum_value>(caf::get<vector>(as_vector()[2])[1]);
+  }
+
+  const data& path() const {
+    return caf::get<vector>(as_vector()[2])[2];
+  }
+
+  data& path() {
+    return caf::get<vector>(as_vector()[2])[2];
+  }
+
+  /// Returns the number of records in this batch.
+  count size() const {
+    return caf::get<count>(caf::get<vector>(as_vector()[2])[3]);
+  }
+
+  const vector& columns() const {
+    return caf::get<vector>(caf::get<vector>(as_vector()[2])[4]);
+  }
+
+  bool valid() const {
+    if ( as_vector().size() < 3 )
+      return false;
+
+    auto vp = caf::get_if<vector>(&(as_vector()[2]));
+
+    if ( ! vp )
+      return false;
+
+    auto& v = *vp;
+
+    if ( v.size() < 5 )
+      return false;
+
+    if ( ! caf::get_if<enum_value>(&v[0]) )
+      return false;
+
+    if ( ! caf::get_if<enum_value>(&v[1]) )
+      return false;
+
+    if ( ! caf::get_if<count>(&v[3]) )
+      return false;
+
+    if ( ! caf::get_if<vector>(&v[4]) )
+      return false;
+
+    return true;
+  }
+
+  /// Restores the serialized data of each log write in this batch.
+  /// @returns `false` if the batch is malformed, `true` otherwise.
+  bool decode(vector& records) const;
+
+  /// Converts the batch back into individual log writes.
+  /// @returns an empty list if the batch is malformed.
+  std::vector<LogWrite> unbatch() const;
+
+  /// Stores `records` column by column.
+  /// @returns an empty list if `records` is empty or if not all records are
+  ///          vectors of the same size.
+  static vector encode(const vector& records);
+};
+
 class IdentifierUpdate : public Message {
 public:
   IdentifierUpdate(std::string id_name, data id_value)
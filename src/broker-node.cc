@@ -189,9 +189,11 @@ public:
                    "number of pings (default: 100, 'ping' mode only)")
       .add<uri_list>("peers,p",
                      "list of peers we connect to on startup in "
-                     "<tcp://$host:$port> notation")
+                     "<tcp://$host:$port> or <unix:///$path> notation")
       .add<uint16_t>("local-port,l",
-                     "local port for publishing this endpoint at");
+                     "local port for publishing this endpoint at")
+      .add<string>("local-socket",
+                   "Unix domain socket for publishing this endpoint at");
   }
 };
 
@@ -261,6 +263,14 @@ broker::data make_stop_msg() {
   return "stop";
 }
 
+// -- peer URIs ----------------------------------------------------------------
+
+/// Returns the absolute file system path of a <unix:///$path> URI.
+string unix_path(const uri& x) {
+  auto path = x.path();
+  return "/" + string{path.begin(), path.end()};
+}
+
 // -- mode implementations -----------------------------------------------------
 
 void relay_mode(broker::endpoint& ep, topic_list topics) {
@@ -514,6 +524,11 @@ int main(int argc, char** argv) {
     verbose::println("listen for peers on port ", *local_port);
     ep.listen({}, *local_port);
   }
+  if (auto local_socket = get_if<string>(&ep, "local-socket")) {
+    verbose::println("listen for peers at ", *local_socket);
+    if (!ep.listen_unix(*local_socket))
+      err::println("unable to listen at ", *local_socket);
+  }
   // Select function f based on the mode.
   mode_fun f = nullptr;
   switch (static_cast<uint64_t>(*mode)) {
@@ -537,8 +552,13 @@ int main(int argc, char** argv) {
   auto peers = get_or(ep, "peers", uri_list{});
   for (auto& peer : peers) {
     auto& auth = peer.authority();
-    if (peer.scheme() != "tcp") {
-      err::println("unrecognized scheme (expected tcp) in: <", peer, '>');
+    if (peer.scheme() == "unix") {
+      auto path = unix_path(peer);
+      verbose::println("connect to ", path, " ...");
+      ep.peer_unix(path);
+    } else if (peer.scheme() != "tcp") {
+      err::println("unrecognized scheme (expected tcp or unix) in: <", peer,
+                   '>');
     } else if (auth.empty()) {
       err::println("no authority component in: <", peer, '>');
     } else {
@@ -552,7 +572,11 @@ int main(int argc, char** argv) {
   // Disconnect from peers.
   for (auto& peer : peers) {
     auto& auth = peer.authority();
-    if (peer.scheme() == "tcp" && !auth.empty()) {
+    if (peer.scheme() == "unix") {
+      auto path = unix_path(peer);
+      verbose::println("diconnect from ", path, " ...");
+      ep.unpeer_unix(path);
+    } else if (peer.scheme() == "tcp" && !auth.empty()) {
       auto host = to_string(auth.host);
       auto port = auth.port;
       verbose::println("diconnect from ", host, " on port ", port, " ...");
@@ -43,7 +43,34 @@ configuration::configuration(broker_options opts) : options_(std::move(opts)) {
     .add<std::string>("recording-directory",
                       "path for storing recorded meta information")
     .add<size_t>("output-generator-file-cap",
-                 "maximum number of entries when recording published messages");
+                 "maximum number of entries when recording published messages")
+    .add<bool>("topic-dictionary",
+               "send known topics to peers as integers instead of strings")
+    .add<bool>("compact-data",
+               "send data to peers in the compact varint-based encoding")
+    .add<std::string>("compression",
+                      "compress data to peers: none (default), lz or zlib")
+    .add<size_t>("compression-threshold",
+                 "send payloads smaller than this many bytes uncompressed")
+    .add<size_t>("core-shards",
+                 "number of core actors that share the routing load")
+    .add<bool>("local-delivery",
+               "deliver from publishers to local subscribers directly")
+    .add<size_t>("peer-stripes",
+                 "number of TCP connections per peering (one per core shard)")
+    .add<bool>("deduplicate",
+               "tag messages with IDs and drop duplicates from meshed peers")
+    .add<size_t>("command-log-size",
+                 "number of updates that masters keep for resyncing clones")
+    .add<size_t>("group-commit-size",
+                 "maximum number of store updates per transaction (0 = off)")
+    .add<timespan>("group-commit-interval",
+                   "maximum time before masters commit a transaction")
+    .add<timespan>("expiry-interval",
+                   "time slice for expiring keys in master stores")
+    .add<size_t>("snapshot-pending-updates",
+                 "maximum number of updates that masters hold back while "
+                 "streaming snapshots");
   // Override CAF default file names.
   set("logger.file-name", "broker_[PID]_[TIMESTAMP].log");
   set("logger.file-verbosity", caf::atom("quiet"));
@@ -94,6 +121,32 @@ caf::settings configuration::dump_content() const {
     put_missing(grp, "recording-directory", *path);
   if (auto cap = get_if<size_t>(&content, "broker.output-generator-file-cap"))
     put_missing(grp, "output-generator-file-cap", *cap);
+  if (auto flag = get_if<bool>(&content, "broker.topic-dictionary"))
+    put_missing(grp, "topic-dictionary", *flag);
+  if (auto flag = get_if<bool>(&content, "broker.compact-data"))
+    put_missing(grp, "compact-data", *flag);
+  if (auto method = get_if<std::string>(&content, "broker.compression"))
+    put_missing(grp, "compression", *method);
+  if (auto n = get_if<size_t>(&content, "broker.compression-threshold"))
+    put_missing(grp, "compression-threshold", *n);
+  if (auto n = get_if<size_t>(&content, "broker.core-shards"))
+    put_missing(grp, "core-shards", *n);
+  if (auto flag = get_if<bool>(&content, "broker.local-delivery"))
+    put_missing(grp, "local-delivery", *flag);
+  if (auto n = get_if<size_t>(&content, "broker.peer-stripes"))
+    put_missing(grp, "peer-stripes", *n);
+  if (auto flag = get_if<bool>(&content, "broker.deduplicate"))
+    put_missing(grp, "deduplicate", *flag);
+  if (auto n = get_if<size_t>(&content, "broker.command-log-size"))
+    put_missing(grp, "command-log-size", *n);
+  if (auto n = get_if<size_t>(&content, "broker.group-commit-size"))
+    put_missing(grp, "group-commit-size", *n);
+  if (auto t = get_if<timespan>(&content, "broker.group-commit-interval"))
+    put_missing(grp, "group-commit-interval", *t);
+  if (auto t = get_if<timespan>(&content, "broker.expiry-interval"))
+    put_missing(grp, "expiry-interval", *t);
+  if (auto n = get_if<size_t>(&content, "broker.snapshot-pending-updates"))
+    put_missing(grp, "snapshot-pending-updates", *n);
   return result;
 }
 
@@ -115,6 +168,7 @@ void configuration::add_message_types(caf::actor_system_config& cfg) {
   ADD_MSG_TYPE(broker::optional<broker::timestamp>);
   ADD_MSG_TYPE(broker::optional<broker::timespan>);
   ADD_MSG_TYPE(broker::snapshot);
+  ADD_MSG_TYPE(broker::snapshot_entry);
   ADD_MSG_TYPE(broker::internal_command);
   ADD_MSG_TYPE(broker::command_message);
   ADD_MSG_TYPE(broker::data_message);
@@ -122,6 +176,8 @@ void configuration::add_message_types(caf::actor_system_config& cfg) {
   ADD_MSG_TYPE(broker::node_message::value_type);
   ADD_MSG_TYPE(broker::set_command);
   ADD_MSG_TYPE(broker::store::stream_type::value_type);
+  ADD_MSG_TYPE(std::vector<uint16_t>);
+  ADD_MSG_TYPE(std::vector<broker::internal_command>);
 }
 
 #undef ADD_MSG_TYPE
@@ -1,5 +1,7 @@
 #include "broker/core_actor.hh"
 
+#include <memory>
+
 #include <caf/actor.hpp>
 #include <caf/actor_cast.hpp>
 #include <caf/allowed_unsafe_message_type.hpp>
@@ -63,7 +65,8 @@ result<void> init_peering(caf::stateful_actor<core_state>* self,
   // Create necessary state and send message to remote core.
   st.pending_peers.emplace(remote_core,
                            core_state::pending_peer_state{0, rp});
-  self->send(self * remote_core, atom::peer::value, st.filter, self);
+  self->send(self * remote_core, atom::peer::value, st.filter, self,
+             st.shard_layout());
   self->monitor(remote_core);
   return rp;
 }
@@ -120,7 +123,7 @@ void core_state::init(filter_type initial_filter, broker_options opts,
   clock = ep_clock;
   auto meta_dir = get_or(self->config(), "broker.recording-directory",
                          defaults::recording_directory);
-  if (!meta_dir.empty() && detail::is_directory(meta_dir)) {
+  if (!secondary && !meta_dir.empty() && detail::is_directory(meta_dir)) {
     auto file_name = meta_dir + "/topics.txt";
     topics_file.open(file_name);
     if (topics_file.is_open()) {
@@ -238,6 +241,15 @@ void core_state::sync_with_status_subscribers(caf::actor new_peer) {
   }
 }
 
+void core_state::report_error(caf::error err) {
+  if (secondary) {
+    if (primary)
+      self->send(primary, atom::local::value, std::move(err));
+    return;
+  }
+  self->send(errors_, atom::local::value, std::move(err));
+}
+
 void core_state::emit_peer_added_status(caf::actor hdl, const char* msg) {
   auto emit = [=](network_info x) {
     BROKER_INFO("status" << sc::peer_added << x);
@@ -255,6 +267,135 @@ void core_state::emit_peer_added_status(caf::actor hdl, const char* msg) {
     emit({});
 }
 
+void core_state::peer_shards(caf::actor peer_hdl, caf::response_promise rp) {
+  BROKER_TRACE(BROKER_ARG(peer_hdl));
+  if (striped) {
+    peer_stripes(std::move(peer_hdl), std::move(rp));
+    return;
+  }
+  self->request(peer_hdl, caf::infinite, atom::get::value, atom::shard::value)
+  .then(
+    [=](std::vector<caf::actor>& remote_shards) mutable {
+      if (remote_shards.size() != shards.size()) {
+        abort_shard_peering(peer_hdl, rp,
+                            make_error(ec::peer_incompatible,
+                                       "mismatching number of core shards"));
+        return;
+      }
+      connect_shards(peer_hdl, std::move(remote_shards), std::move(rp));
+    },
+    [=](caf::error& err) mutable {
+      abort_shard_peering(peer_hdl, rp, std::move(err));
+    });
+}
+
+void core_state::peer_stripes(caf::actor peer_hdl, caf::response_promise rp) {
+  BROKER_TRACE(BROKER_ARG(peer_hdl));
+  // Stripes connect to the same host as the primary core, which requires
+  // that we have initiated the peering via network address.
+  auto addr = cache.find(peer_hdl);
+  if (!addr) {
+    abort_shard_peering(peer_hdl, rp,
+                        make_error(ec::peer_incompatible,
+                                   "peer stripes require a network address"));
+    return;
+  }
+  self->request(peer_hdl, caf::infinite, atom::get::value, atom::shard::value,
+                atom::network::value)
+  .then(
+    [=](const std::vector<uint16_t>& ports) mutable {
+      if (ports.size() != shards.size()) {
+        abort_shard_peering(peer_hdl, rp,
+                            make_error(ec::peer_incompatible,
+                                       "mismatching number of peer stripes"));
+        return;
+      }
+      std::vector<network_info> targets;
+      for (auto port : ports)
+        targets.emplace_back(addr->address, port, addr->retry);
+      connect_shards(peer_hdl, std::move(targets), std::move(rp));
+    },
+    [=](caf::error& err) mutable {
+      abort_shard_peering(peer_hdl, rp, std::move(err));
+    });
+}
+
+template <class T>
+void core_state::connect_shards(caf::actor peer_hdl, std::vector<T> targets,
+                                caf::response_promise rp) {
+  // Remember the remote shards for unpeering as they respond.
+  shard_peers[peer_hdl].assign(shards.size(), caf::actor{});
+  auto pending = std::make_shared<size_t>(shards.size());
+  for (size_t i = 0; i < shards.size(); ++i)
+    self->request(shards[i], caf::infinite, atom::peer::value,
+                  std::move(targets[i]))
+    .then(
+      [=](const caf::actor& remote_shard) mutable {
+        auto j = shard_peers.find(peer_hdl);
+        if (j != shard_peers.end())
+          j->second[i] = remote_shard;
+        if (*pending > 0 && --*pending == 0 && rp.pending())
+          rp.deliver(peer_hdl);
+      },
+      [=](caf::error& err) mutable {
+        if (*pending > 0) {
+          *pending = 0;
+          abort_shard_peering(peer_hdl, rp, std::move(err));
+        }
+      });
+}
+
+void core_state::abort_shard_peering(const caf::actor& peer_hdl,
+                                     caf::response_promise& rp,
+                                     caf::error err) {
+  BROKER_ERROR("cannot peer shards:" << err);
+  emit_error<ec::peer_incompatible>(peer_hdl, "cannot peer core shards");
+  policy().remove_peer(peer_hdl, caf::none, false, true);
+  if (rp.pending())
+    rp.deliver(std::move(err));
+}
+
+void core_state::unpeer_shards(const caf::actor& peer_hdl) {
+  auto i = shard_peers.find(peer_hdl);
+  if (i == shard_peers.end())
+    return;
+  for (size_t j = 0; j < shards.size() && j < i->second.size(); ++j)
+    if (i->second[j])
+      self->send(shards[j], atom::unpeer::value, i->second[j]);
+  shard_peers.erase(i);
+}
+
+detail::shard_layout core_state::shard_layout() const {
+  auto result = static_cast<detail::shard_layout>(shards.size());
+  if (striped)
+    result |= detail::striped_layout_flag;
+  return result;
+}
+
+bool core_state::check_shard_layout(const caf::actor& peer_hdl,
+                                    detail::shard_layout peer_layout) {
+  if (peer_layout == shard_layout())
+    return true;
+  auto err = make_error(ec::peer_incompatible,
+                        "mismatching core shards or peer stripes");
+  self->send(peer_hdl, atom::peer::value, atom::shard::value, err);
+  reject_peer(peer_hdl, std::move(err));
+  return false;
+}
+
+void core_state::reject_peer(const caf::actor& peer_hdl, caf::error err) {
+  BROKER_ERROR("rejected peering:" << err);
+  emit_error<ec::peer_incompatible>(peer_hdl,
+                                    "mismatching core shards or peer stripes");
+  auto i = pending_peers.find(peer_hdl);
+  if (i != pending_peers.end()) {
+    if (i->second.rp.pending())
+      i->second.rp.deliver(err);
+    pending_peers.erase(i);
+  }
+  policy().remove_peer(peer_hdl, caf::none, true, false);
+}
+
 caf::behavior core_actor(caf::stateful_actor<core_state>* self,
                          filter_type initial_filter, broker_options options,
                          endpoint::clock* clock) {
@@ -320,9 +461,10 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
     // --- A (this node) performs steps #1 and #3; B performs #2 and #4 --------
     // Step #1: - A demands B shall establish a stream back to A
     //          - A has subscribers to the topics `ts`
-    [=](atom::peer, filter_type& peer_ts,
-        caf::actor& peer_hdl) -> detail::core_policy::step1_handshake {
-      BROKER_TRACE(BROKER_ARG(peer_ts) << BROKER_ARG(peer_hdl));
+    [=](atom::peer, filter_type& peer_ts, caf::actor& peer_hdl,
+        detail::shard_layout layout) -> detail::core_policy::step1_handshake {
+      BROKER_TRACE(BROKER_ARG(peer_ts) << BROKER_ARG(peer_hdl)
+                   << BROKER_ARG(layout));
       auto& st = self->state;
       // Reject anonymous peering requests.
       if (peer_hdl == nullptr) {
@@ -336,12 +478,16 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
       }
       BROKER_DEBUG("received handshake step #1" << BROKER_ARG(peer_hdl)
                     << BROKER_ARG(actor{self}));
+      // Both sides must route each topic through the same shard.
+      if (!st.check_shard_layout(peer_hdl, layout))
+        return {};
       // Start CAF stream.
       return st.policy().start_peering<true>(peer_hdl, std::move(peer_ts));
     },
     // Step #2: B establishes a stream to A and sends its own filter
     [=](const stream<node_message>& in, filter_type& filter,
-        caf::actor& peer_hdl) {
+        caf::actor& peer_hdl, detail::peer_features features,
+        detail::shard_layout layout) {
       BROKER_TRACE(BROKER_ARG(in) << BROKER_ARG(filter) << peer_hdl);
       auto& st = self->state;
       BROKER_DEBUG("received handshake step #2 from" << peer_hdl
@@ -351,22 +497,32 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
         BROKER_WARNING("Received unexpected or repeated step #2 handshake.");
         return;
       }
+      if (!st.check_shard_layout(peer_hdl, layout))
+        return;
       if ( ! st.status_subscribers.empty() )
         st.policy().block_peer(peer_hdl);
       st.policy().ack_peering(in, peer_hdl);
       st.policy().start_peering<false>(peer_hdl, std::move(filter));
+      st.policy().negotiate(peer_hdl, features);
       // Emit peer added event.
       st.emit_peer_added_status(peer_hdl, "received handshake from remote core");
       // Send handle to the actor that initiated a peering (if available).
+      // Sharded endpoints respond only after connecting all shards.
+      caf::response_promise rp;
       auto i = st.pending_peers.find(peer_hdl);
       if (i != st.pending_peers.end()) {
-        i->second.rp.deliver(peer_hdl);
+        rp = std::move(i->second.rp);
         st.pending_peers.erase(i);
       }
+      if (!st.shards.empty())
+        st.peer_shards(peer_hdl, std::move(rp));
+      else if (rp.pending())
+        rp.deliver(peer_hdl);
     },
     // Step #3: - A establishes a stream to B
     //          - B has a stream to A and vice versa now
-    [=](const stream<node_message>& in, ok_atom, caf::actor& peer_hdl) {
+    [=](const stream<node_message>& in, ok_atom, caf::actor& peer_hdl,
+        detail::peer_features features, detail::shard_layout layout) {
       BROKER_TRACE(BROKER_ARG(in) << BROKER_ARG(peer_hdl));
       auto& st = self->state;
       if (!st.policy().has_outbound_path_to(peer_hdl)) {
@@ -377,10 +533,20 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
         BROKER_DEBUG("Drop repeated step #3 handshake.");
         return;
       }
+      if (!st.check_shard_layout(peer_hdl, layout))
+        return;
       if ( ! st.status_subscribers.empty() )
         st.policy().block_peer(peer_hdl);
       st.emit_peer_added_status(peer_hdl, "handshake successful");
       st.policy().ack_peering(in, peer_hdl);
+      st.policy().negotiate(peer_hdl, features);
+    },
+    // Sent by peers that reject our handshake.
+    [=](atom::peer, atom::shard, caf::error& err) {
+      auto peer_hdl = caf::actor_cast<caf::actor>(self->current_sender());
+      if (peer_hdl == nullptr)
+        return;
+      self->state.reject_peer(peer_hdl, std::move(err));
     },
     // --- asynchronous communication to peers ---------------------------------
     [=](atom::update, filter_type f) {
@@ -406,13 +572,13 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
     [=](atom::join, atom::update, stream_slot slot, filter_type& filter) {
       auto& st = self->state;
       st.add_to_filter(filter);
-      st.policy().workers().set_filter(slot, std::move(filter));
+      st.policy().set_worker_filter(slot, std::move(filter));
     },
     [=](atom::join, atom::update, stream_slot slot, filter_type& filter,
         caf::actor& who_asked) {
       auto& st = self->state;
       st.add_to_filter(filter);
-      st.policy().workers().set_filter(slot, std::move(filter));
+      st.policy().set_worker_filter(slot, std::move(filter));
       self->send(who_asked, true);
     },
     [=](atom::join, atom::store, filter_type& filter) {
@@ -512,7 +678,7 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
       st.add_to_filter(filter);
       // Move the slot to the stores downstream manager and set filter.
       st.governor->out().assign<detail::core_policy::store_trait::manager>(slot);
-      st.policy().stores().set_filter(slot, std::move(filter));
+      st.policy().set_store_filter(slot, std::move(filter));
       // Done.
       return ms;
     },
@@ -555,7 +721,7 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
       st.add_to_filter(filter);
       // Move the slot to the stores downstream manager and set filter.
       st.governor->out().assign<detail::core_policy::store_trait::manager>(slot);
-      st.policy().stores().set_filter(slot, std::move(filter));
+      st.policy().set_store_filter(slot, std::move(filter));
       return clone;
       /* FIXME:
       auto spawn_clone = [=](const caf::actor& master) -> caf::actor {
@@ -616,11 +782,12 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
       */
     },
     [=](atom::store, atom::master, atom::snapshot, const std::string& name,
-        caf::actor& clone) {
+        caf::actor& clone, uint64_t last_seq) {
       // Instruct master to generate a snapshot.
       self->state.policy().push(make_command_message(
         name / topics::master_suffix,
-        make_internal_command<snapshot_command>(self, std::move(clone))));
+        make_internal_command<snapshot_command>(self, std::move(clone),
+                                                last_seq)));
     },
     [=](atom::store, atom::master, atom::get,
         const std::string& name) -> result<actor> {
@@ -691,17 +858,47 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
         result.erase(e, result.end());
       return result;
     },
+    [=](atom::get, atom::stats) {
+      return self->state.policy().stats();
+    },
+    [=](atom::get, atom::stats, atom::peer) {
+      return self->state.policy().compression_stats_by_peer();
+    },
     // --- destructive state manipulations -------------------------------------
     [=](atom::unpeer, network_info addr) {
       auto& st = self->state;
       auto x = self->state.cache.find(addr);
       if (!x || !st.policy().remove_peer(*x, caf::none, false, true))
         st.emit_error<ec::peer_invalid>(addr, "no such peer when unpeering");
+      else
+        st.unpeer_shards(*x);
     },
     [=](atom::unpeer, actor x) {
       auto& st = self->state;
       if (!x || !st.policy().remove_peer(x, caf::none, false, true))
         st.emit_error<ec::peer_invalid>(x, "no such peer when unpeering");
+      else
+        st.unpeer_shards(x);
+    },
+    // --- sharding ------------------------------------------------------------
+    [=](atom::shard, std::vector<caf::actor>& shards, bool striped) {
+      self->state.shards = std::move(shards);
+      self->state.striped = striped;
+    },
+    [=](atom::shard, atom::network, std::vector<uint16_t>& ports) {
+      self->state.stripe_ports = std::move(ports);
+    },
+    [=](atom::get, atom::shard) -> result<std::vector<caf::actor>> {
+      auto& st = self->state;
+      // Stripes live in other actor systems. Hence, their handles are not
+      // reachable through the connection of this core.
+      if (st.striped)
+        return make_error(ec::peer_incompatible,
+                          "endpoint requires peer stripes");
+      return st.shards;
+    },
+    [=](atom::get, atom::shard, atom::network) {
+      return self->state.stripe_ports;
     },
     [=](atom::no_events) {
       auto& st = self->state;
@@ -751,7 +948,25 @@ caf::behavior core_actor(caf::stateful_actor<core_state>* self,
     },
     [=](atom::add, atom::status, caf::actor& ss) {
       self->state.status_subscribers.emplace(std::move(ss));
+    },
+    [=](atom::local, caf::error& err) {
+      // Errors from our secondary shards.
+      self->state.report_error(std::move(err));
     }};
 }
 
+caf::behavior core_shard_actor(caf::stateful_actor<core_state>* self,
+                               broker_options opts, endpoint::clock* clock,
+                               caf::actor primary) {
+  auto& st = self->state;
+  st.secondary = true;
+  st.primary = std::move(primary);
+  auto result = core_actor(self, filter_type{}, std::move(opts), clock);
+  // Only the primary core emits to the groups of the endpoint. Stripes run in
+  // separate actor systems, i.e., their local groups have no subscribers.
+  st.errors_ = caf::group{};
+  st.statuses_ = caf::group{};
+  return result;
+}
+
 } // namespace broker
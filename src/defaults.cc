@@ -1,5 +1,6 @@
 #include "broker/defaults.hh"
 
+#include <chrono>
 #include <limits>
 
 namespace broker {
@@ -9,5 +10,31 @@ const caf::string_view recording_directory = "";
 
 const size_t output_generator_file_cap = std::numeric_limits<size_t>::max();
 
+const bool topic_dictionary = true;
+
+const bool compact_data = true;
+
+const caf::string_view compression = "none";
+
+const size_t compression_threshold = 1024;
+
+const size_t core_shards = 1;
+
+const bool local_delivery = false;
+
+const size_t peer_stripes = 1;
+
+const bool deduplicate = false;
+
+const size_t command_log_size = 10000;
+
+const size_t group_commit_size = 0;
+
+const timespan group_commit_interval = std::chrono::milliseconds(10);
+
+const timespan expiry_interval = std::chrono::milliseconds(100);
+
+const size_t snapshot_pending_updates = 10000;
+
 } // namespace defaults
 } // namespace broker
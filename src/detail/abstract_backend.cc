@@ -1,9 +1,33 @@
+#include "broker/logger.hh"
+
 #include "broker/detail/appliers.hh"
 #include "broker/detail/abstract_backend.hh"
 
 namespace broker {
 namespace detail {
 
+namespace {
+
+class materialized_cursor : public snapshot_cursor {
+public:
+  materialized_cursor(broker::snapshot ss)
+    : ss_(std::move(ss)), pos_(ss_.begin()) {
+    // nop
+  }
+
+  expected<bool> next(std::vector<snapshot_entry>& xs, size_t n) override {
+    for (; n > 0 && pos_ != ss_.end(); --n, ++pos_)
+      xs.emplace_back(pos_->first, pos_->second);
+    return pos_ != ss_.end();
+  }
+
+private:
+  broker::snapshot ss_;
+  broker::snapshot::const_iterator pos_;
+};
+
+} // namespace <anonymous>
+
 expected<void> abstract_backend::add(const data& key, const data& value,
                                      data::type init_type,
                                      optional<timestamp> expiry) {
@@ -31,6 +55,21 @@ expected<void> abstract_backend::subtract(const data& key, const data& value,
   return put(key, *v, expiry);
 }
 
+expected<std::vector<data>>
+abstract_backend::bulk_expire(const std::vector<data>& keys, timestamp ts) {
+  std::vector<data> result;
+  for (auto& key : keys) {
+    auto res = expire(key, ts);
+    if (!res) {
+      if (res.error() != ec::no_such_key)
+        BROKER_ERROR("failed to expire key:" << to_string(res.error()));
+    } else if (*res) {
+      result.emplace_back(key);
+    }
+  }
+  return result;
+}
+
 expected<data> abstract_backend::get(const data& key, const data& value) const {
   auto k = get(key);
   if (!k)
@@ -38,5 +77,24 @@ expected<data> abstract_backend::get(const data& key, const data& value) const {
   return caf::visit(retriever{value}, *k);
 }
 
+expected<void> abstract_backend::begin_transaction() {
+  return {};
+}
+
+expected<void> abstract_backend::commit_transaction() {
+  return {};
+}
+
+expected<snapshot_cursor_ptr> abstract_backend::cursor() const {
+  auto ss = snapshot();
+  if (!ss)
+    return ss.error();
+  return {std::make_unique<materialized_cursor>(std::move(*ss))};
+}
+
+bool abstract_backend::cursor_is_isolated() const {
+  return true;
+}
+
 } // namespace detail
 } // namespace broker
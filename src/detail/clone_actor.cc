@@ -15,6 +15,7 @@
 #include "broker/convert.hh"
 #include "broker/data.hh"
 #include "broker/error.hh"
+#include "broker/snapshot.hh"
 #include "broker/store.hh"
 #include "broker/topic.hh"
 
@@ -35,7 +36,7 @@ static double now(endpoint::clock* clock)
 clone_state::clone_state() : self(nullptr), name(), master_topic(), core(),
   master(), store(), is_stale(), stale_time(), unmutable_time(),
   mutation_buffer(), pending_remote_updates(), awaiting_snapshot(),
-  awaiting_snapshot_sync(), clock() {
+  awaiting_snapshot_sync(), last_seq(0), clock() {
   // nop
 }
 
@@ -68,6 +69,12 @@ void clone_state::command(internal_command& cmd) {
   command(cmd.content);
 }
 
+void clone_state::apply(internal_command& cmd) {
+  command(cmd.content);
+  if (cmd.seq != 0)
+    last_seq = cmd.seq;
+}
+
 void clone_state::operator()(none) {
   BROKER_WARNING("received empty command");
 }
@@ -130,6 +137,16 @@ void clone_state::operator()(clear_command&) {
   store.clear();
 }
 
+void clone_state::snapshot_complete() {
+  awaiting_snapshot = false;
+  if (awaiting_snapshot_sync)
+    return;
+  for (auto& update : pending_remote_updates)
+    apply(update);
+  pending_remote_updates.clear();
+  pending_remote_updates.shrink_to_fit();
+}
+
 data clone_state::keys() const {
   set result;
   for (auto& kvp : store)
@@ -212,16 +229,18 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
       self->state.mutation_buffer.emplace_back(std::move(x));
     },
     [=](set_command& x) {
+      // Masters of older Broker versions send the whole snapshot at once.
       self->state.store = std::move(x.state);
-      self->state.awaiting_snapshot = false;
-
-      if ( ! self->state.awaiting_snapshot_sync ) {
-        for ( auto& update : self->state.pending_remote_updates )
-          self->state.command(update);
-
-        self->state.pending_remote_updates.clear();
-        self->state.pending_remote_updates.shrink_to_fit();
-      }
+      self->state.last_seq = 0;
+      self->state.snapshot_complete();
+    },
+    [=](atom::update, std::vector<internal_command>& xs) {
+      // The master sends the updates that we have missed instead of a
+      // snapshot if we reconnect to it quickly enough.
+      BROKER_INFO("RESYNC with" << xs.size() << "updates");
+      for (auto& x : xs)
+        self->state.apply(x);
+      self->state.snapshot_complete();
     },
     [=](atom::sync_point, caf::actor& who) {
       self->send(who, atom::sync_point::value);
@@ -255,8 +274,13 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
       self->state.mutation_buffer.clear();
       self->state.mutation_buffer.shrink_to_fit();
 
+      // Only present our sequence number to the master that assigned it.
+      auto last_seq = self->state.master.address() == self->state.last_master
+                      ? self->state.last_seq
+                      : 0;
+      self->state.last_master = self->state.master.address();
       self->send(self->state.core, atom::store::value, atom::master::value,
-                 atom::snapshot::value, self->state.name, self);
+                 atom::snapshot::value, self->state.name, self, last_seq);
     },
     [=](atom::master, caf::error err) {
       if ( self->state.master )
@@ -375,6 +399,37 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
     [=](atom::get, atom::name) {
       return self->state.name;
     },
+    // --- stream handshake with master ----------------------------------------
+    [=](const caf::stream<snapshot_entry>& in, uint64_t seq) {
+      BROKER_INFO("receive snapshot from master");
+      self->make_sink(
+        // input stream
+        in,
+        // initialize state
+        [=](caf::unit_t&) {
+          // Apply each chunk right away instead of collecting the snapshot.
+          // Until the stream completes, the store no longer corresponds to
+          // any sequence number.
+          self->state.store.clear();
+          self->state.last_seq = 0;
+        },
+        // processing step
+        [=](caf::unit_t&, snapshot_entry x) {
+          self->state.store.insert_or_assign(std::move(x.first),
+                                             std::move(x.second));
+        },
+        // cleanup
+        [=](caf::unit_t&, const caf::error& err) {
+          if (err) {
+            // Losing the master triggers a new snapshot.
+            BROKER_WARNING("snapshot stream failed:" << to_string(err));
+            return;
+          }
+          self->state.last_seq = seq;
+          self->state.snapshot_complete();
+        }
+      );
+    },
     // --- stream handshake with core ------------------------------------------
     [=](const store::stream_type& in) {
       self->make_sink(
@@ -388,8 +443,10 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
         [=](caf::unit_t&, store::stream_type::value_type y) {
           // TODO: our operator() overloads require mutable references, but
           //       only a fraction actually benefit from it.
-          auto cmd = move_command(y);
-          if (caf::holds_alternative<snapshot_sync_command>(cmd)) {
+          auto seq = get<1>(y).seq;
+          internal_command cmd{move_command(y)};
+          cmd.seq = seq;
+          if (caf::holds_alternative<snapshot_sync_command>(cmd.content)) {
             self->state.command(cmd);
             return;
           }
@@ -402,7 +459,7 @@ caf::behavior clone_actor(caf::stateful_actor<clone_state>* self,
             return;
           }
 
-          self->state.command(cmd);
+          self->state.apply(cmd);
         }
       );
     }
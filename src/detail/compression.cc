@@ -0,0 +1,261 @@
+#include "broker/detail/compression.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "broker/config.hh"
+
+#ifdef BROKER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+// The LZ codec uses the block format of LZ4. Each sequence starts with a token
+// byte that stores the number of literals in its upper and the match length
+// (minus `min_match`) in its lower four bits. A nibble value of 15 means that
+// additional bytes follow, each adding up to 255. The literals follow the
+// token, then a two-byte little-endian offset and finally any additional
+// bytes for the match length. The last sequence consists of literals only.
+
+constexpr size_t min_match = 4;
+
+constexpr size_t max_offset = 65535;
+
+constexpr size_t hash_bits = 12;
+
+// The last bytes of the input always remain literals, which allows the
+// compressor to read four bytes at a time without bounds checks.
+constexpr size_t last_literals = 5;
+
+// Neither codec expands its input by more than this factor, which allows us
+// to reject bogus sizes before allocating memory for the output.
+constexpr size_t max_ratio = 1032;
+
+uint32_t read32(const char* ptr) {
+  uint32_t result;
+  memcpy(&result, ptr, sizeof(result));
+  return result;
+}
+
+size_t hash(uint32_t x) {
+  return (x * 2654435761u) >> (32 - hash_bits);
+}
+
+void put_length(size_t n, std::vector<char>& out) {
+  for (; n >= 255; n -= 255)
+    out.push_back(static_cast<char>(255));
+  out.push_back(static_cast<char>(n));
+}
+
+void put_sequence(const char* literals, size_t num_literals,
+                  size_t offset, size_t match_length,
+                  std::vector<char>& out) {
+  auto lit_nibble = std::min(num_literals, size_t{15});
+  auto match_nibble = size_t{0};
+  if (offset != 0)
+    match_nibble = std::min(match_length - min_match, size_t{15});
+  out.push_back(static_cast<char>((lit_nibble << 4) | match_nibble));
+  if (lit_nibble == 15)
+    put_length(num_literals - 15, out);
+  out.insert(out.end(), literals, literals + num_literals);
+  if (offset == 0)
+    return;
+  out.push_back(static_cast<char>(offset & 0xFF));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (match_nibble == 15)
+    put_length(match_length - min_match - 15, out);
+}
+
+void lz_compress(const char* first, size_t size, std::vector<char>& out) {
+  auto anchor = first;
+  auto last = first + size;
+  if (size > min_match + last_literals) {
+    std::vector<uint32_t> table(size_t{1} << hash_bits, 0);
+    auto limit = last - last_literals - min_match;
+    auto pos = first;
+    while (pos <= limit) {
+      auto value = read32(pos);
+      auto& slot = table[hash(value)];
+      auto candidate = first + slot;
+      slot = static_cast<uint32_t>(pos - first);
+      if (candidate >= pos || static_cast<size_t>(pos - candidate) > max_offset
+          || read32(candidate) != value) {
+        ++pos;
+        continue;
+      }
+      auto match_end = pos + min_match;
+      auto ref = candidate + min_match;
+      while (match_end < last - last_literals && *match_end == *ref) {
+        ++match_end;
+        ++ref;
+      }
+      put_sequence(anchor, static_cast<size_t>(pos - anchor),
+                   static_cast<size_t>(pos - candidate),
+                   static_cast<size_t>(match_end - pos), out);
+      pos = anchor = match_end;
+    }
+  }
+  put_sequence(anchor, static_cast<size_t>(last - anchor), 0, 0, out);
+}
+
+bool get_length(const char*& pos, const char* last, size_t& n) {
+  for (;;) {
+    if (pos == last)
+      return false;
+    auto byte = static_cast<uint8_t>(*pos++);
+    n += byte;
+    if (byte != 255)
+      return true;
+  }
+}
+
+bool lz_decompress(const char* first, size_t size, size_t raw_size,
+                   std::vector<char>& out) {
+  auto pos = first;
+  auto last = first + size;
+  auto base = out.size();
+  auto limit = base + raw_size;
+  out.reserve(limit);
+  while (pos != last) {
+    auto token = static_cast<uint8_t>(*pos++);
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !get_length(pos, last, num_literals))
+      return false;
+    if (num_literals > static_cast<size_t>(last - pos)
+        || num_literals > limit - out.size())
+      return false;
+    out.insert(out.end(), pos, pos + num_literals);
+    pos += num_literals;
+    if (pos == last)
+      break;
+    if (last - pos < 2)
+      return false;
+    auto offset = static_cast<size_t>(static_cast<uint8_t>(pos[0]))
+                  | static_cast<size_t>(static_cast<uint8_t>(pos[1])) << 8;
+    pos += 2;
+    size_t match_length = token & 0x0F;
+    if (match_length == 15 && !get_length(pos, last, match_length))
+      return false;
+    match_length += min_match;
+    if (offset == 0 || offset > out.size() - base
+        || match_length > limit - out.size())
+      return false;
+    // Matches may overlap with their own output, so copy byte by byte.
+    auto src = out.size() - offset;
+    for (size_t i = 0; i < match_length; ++i)
+      out.push_back(out[src + i]);
+  }
+  return out.size() == limit;
+}
+
+} // namespace
+
+bool compression_available(compression_method x) {
+  switch (x) {
+    case compression_method::none:
+    case compression_method::lz:
+      return true;
+    case compression_method::zlib:
+#ifdef BROKER_HAVE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+bool compress(compression_method method, const char* first, size_t size,
+              std::vector<char>& out) {
+  switch (method) {
+    case compression_method::none:
+      out.insert(out.end(), first, first + size);
+      return true;
+    case compression_method::lz:
+      lz_compress(first, size, out);
+      return true;
+#ifdef BROKER_HAVE_ZLIB
+    case compression_method::zlib: {
+      auto base = out.size();
+      auto bound = compressBound(static_cast<uLong>(size));
+      out.resize(base + bound);
+      auto dst = reinterpret_cast<Bytef*>(out.data() + base);
+      auto src = reinterpret_cast<const Bytef*>(first);
+      if (compress2(dst, &bound, src, static_cast<uLong>(size),
+                    Z_BEST_SPEED) != Z_OK) {
+        out.resize(base);
+        return false;
+      }
+      out.resize(base + bound);
+      return true;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+
+bool decompress(compression_method method, const char* first, size_t size,
+                size_t raw_size, std::vector<char>& out) {
+  if (raw_size / max_ratio > size)
+    return false;
+  switch (method) {
+    case compression_method::none:
+      if (size != raw_size)
+        return false;
+      out.insert(out.end(), first, first + size);
+      return true;
+    case compression_method::lz:
+      return lz_decompress(first, size, raw_size, out);
+#ifdef BROKER_HAVE_ZLIB
+    case compression_method::zlib: {
+      auto base = out.size();
+      out.resize(base + raw_size);
+      auto dst = reinterpret_cast<Bytef*>(out.data() + base);
+      auto src = reinterpret_cast<const Bytef*>(first);
+      auto dst_size = static_cast<uLongf>(raw_size);
+      if (uncompress(dst, &dst_size, src, static_cast<uLong>(size)) != Z_OK
+          || dst_size != raw_size) {
+        out.resize(base);
+        return false;
+      }
+      return true;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+
+bool convert(const std::string& str, compression_method& x) {
+  if (str == "none")
+    x = compression_method::none;
+  else if (str == "lz")
+    x = compression_method::lz;
+  else if (str == "zlib")
+    x = compression_method::zlib;
+  else
+    return false;
+  return true;
+}
+
+const char* to_string(compression_method x) {
+  switch (x) {
+    case compression_method::none:
+      return "none";
+    case compression_method::lz:
+      return "lz";
+    case compression_method::zlib:
+      return "zlib";
+    default:
+      return "???";
+  }
+}
+
+} // namespace detail
+} // namespace broker
@@ -1,6 +1,9 @@
 #include "broker/detail/core_policy.hh"
 
 #include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <random>
 
 #include <caf/detail/stream_distribution_tree.hpp>
 #include <caf/none.hpp>
@@ -19,11 +22,40 @@ namespace detail {
 
 core_policy::core_policy(caf::detail::stream_distribution_tree<core_policy>* p,
                          core_state* state, filter_type filter)
-  : parent_(p), state_(state), remaining_records_(0) {
+  : parent_(p),
+    state_(state),
+    features_(lz_compression_feature),
+    compression_(compression_method::none),
+    compression_threshold_(0),
+    origin_(0),
+    next_seq_(0),
+    remaining_records_(0) {
   // TODO: use filter
   BROKER_ASSERT(parent_ != nullptr);
   BROKER_ASSERT(state_ != nullptr);
   auto& cfg = state->self->system().config();
+  if (get_or(cfg, "broker.topic-dictionary", defaults::topic_dictionary))
+    features_ |= topic_dictionary_feature;
+  if (get_or(cfg, "broker.compact-data", defaults::compact_data))
+    features_ |= compact_data_feature;
+  if (compression_available(compression_method::zlib))
+    features_ |= zlib_compression_feature;
+  if (get_or(cfg, "broker.deduplicate", defaults::deduplicate)) {
+    features_ |= message_id_feature;
+    // Origins only need to differ between cores that may exchange messages.
+    std::random_device rd;
+    std::mt19937_64 gen{(uint64_t{rd()} << 32) | rd()};
+    while (origin_ == 0)
+      origin_ = gen();
+  }
+  auto method = get_or(cfg, "broker.compression",
+                       defaults::compression);
+  if (!convert(method, compression_) || !compression_available(compression_)) {
+    BROKER_WARNING("unsupported compression method:" << method);
+    compression_ = compression_method::none;
+  }
+  compression_threshold_ = get_or(cfg, "broker.compression-threshold",
+                                  defaults::compression_threshold);
   auto meta_dir = get_or(cfg, "broker.recording-directory",
                          defaults::recording_directory);
   if (!meta_dir.empty() && detail::is_directory(meta_dir)) {
@@ -90,13 +122,7 @@ void core_policy::unblock_peer(caf::actor peer) {
   blocked_msgs.erase(it);
 }
 
-static bool ends_with(const std::string& s, const std::string& ending) {
-  if (ending.size() > s.size())
-    return false;
-  return std::equal(ending.rbegin(), ending.rend(), s.rbegin());
-}
-
-void core_policy::handle_batch(stream_slot, const strong_actor_ptr& peer,
+void core_policy::handle_batch(stream_slot slot, const strong_actor_ptr& peer,
                                message& xs) {
   BROKER_TRACE(BROKER_ARG(xs));
 
@@ -112,40 +138,7 @@ void core_policy::handle_batch(stream_slot, const strong_actor_ptr& peer,
       return;
     }
 
-    auto num_workers = workers().num_paths();
-    auto num_stores = stores().num_paths();
-    BROKER_DEBUG("forward batch from peers;" << BROKER_ARG(num_workers)
-                  << BROKER_ARG(num_stores));
-    // Only received from other peers. Extract content for to local workers
-    // or stores and then forward to other peers.
-    for (auto& msg : xs.get_mutable_as<peer_trait::batch>(0)) {
-      const topic* t;
-      // Dispatch to local workers or stores messages.
-      if (is_data_message(msg)) {
-        auto& dm = get<data_message>(msg.content);
-        t = &get_topic(dm);
-        if (num_workers > 0)
-          workers().push(dm);
-      } else {
-        auto& cm = get<command_message>(msg.content);
-        t = &get_topic(cm);
-        if (num_stores > 0)
-          stores().push(cm);
-      }
-      // Check if forwarding is on.
-      if (!state_->options.forward)
-        continue;
-      // Somewhat hacky, but don't forward data store clone messages.
-      if (ends_with(t->string(), topics::clone_suffix.string()))
-        continue;
-      // Either decrease TTL if message has one already, or add one.
-      if (--msg.ttl == 0) {
-        BROKER_WARNING("dropped a message with expired TTL");
-        continue;
-      }
-      // Forward to other peers.
-      peers().push(std::move(msg));
-    }
+    handle_peer_batch(slot, xs.get_mutable_as<peer_trait::batch>(0));
     return;
   }
   using variant_batch = std::vector<node_message::value_type>;
@@ -156,6 +149,118 @@ void core_policy::handle_batch(stream_slot, const strong_actor_ptr& peer,
   BROKER_ERROR("unexpected batch:" << deep_to_string(xs));
 }
 
+void core_policy::handle_peer_batch(stream_slot slot, peer_trait::batch& xs) {
+  auto num_workers = workers().num_paths();
+  auto num_stores = stores().num_paths();
+  BROKER_DEBUG("forward batch from peers;" << BROKER_ARG(num_workers)
+                << BROKER_ARG(num_stores));
+  // Restore all topics up front, because runs compare topics of neighbors.
+  // This also drops messages with unknown topic references and messages
+  // that already reached us over a different path.
+  auto drop = [&](node_message& x) {
+    return !decode(slot, x) || is_duplicate(x);
+  };
+  xs.erase(std::remove_if(xs.begin(), xs.end(), drop), xs.end());
+  // Without local subscribers and forwarding, all messages stop here.
+  auto forward = state_->options.forward;
+  if (xs.empty() || (!forward && num_workers == 0 && num_stores == 0))
+    return;
+  // Routes may change between two batches, so we only cache them per batch.
+  batch_routes_.clear();
+  auto first = xs.begin();
+  while (first != xs.end()) {
+    auto& t = get_topic(*first);
+    auto is_data = is_data_message(*first);
+    auto last = std::find_if(first + 1, xs.end(), [&](const node_message& x) {
+      return is_data_message(x) != is_data || get_topic(x) != t;
+    });
+    auto& r = batch_route_for(t, forward);
+    if (!is_data) {
+      if (num_stores > 0)
+        for (auto i = first; i != last; ++i)
+          route(stores(), store_routes_, get<command_message>(i->content));
+    } else if (!r.workers.empty()) {
+      deliver_run(r, first, last);
+    }
+    if (r.forward)
+      forward_run(r, first, last);
+    first = last;
+  }
+}
+
+auto core_policy::batch_route_for(const topic& t, bool forward)
+  -> batch_route& {
+  auto i = batch_routes_.find(t);
+  if (i != batch_routes_.end())
+    return i->second;
+  auto& r = batch_routes_[t];
+  // Data from peers remains serialized unless at least one local worker
+  // subscribed to it.
+  if (workers().num_paths() > 0)
+    for_each_target(workers(), worker_routes_, t,
+                    [&](stream_slot, const outbound_path&,
+                        worker_trait::batch& buf) {
+                      r.workers.emplace_back(&buf);
+                    });
+  // Somewhat hacky, but don't forward data store clone messages.
+  r.forward = forward && !t.is_clone_topic();
+  if (r.forward)
+    for_each_target(peers(), peer_routes_, t,
+                    [&](stream_slot slot, const outbound_path& path,
+                        peer_trait::batch& buf) {
+                      r.peers.emplace_back(peer_target{slot, &path, &buf});
+                    });
+  return r;
+}
+
+void core_policy::deliver_run(const batch_route& r,
+                              peer_trait::batch::iterator first,
+                              peer_trait::batch::iterator last) {
+  for (auto i = first; i != last; ++i) {
+    if (i->lazy) {
+      if (!materialize(*i)) {
+        BROKER_ERROR("dropped a message with malformed payload");
+        // Keep forward_run from passing the message on.
+        i->ttl = 0;
+        continue;
+      }
+      ++stats_.decoded_messages;
+    }
+    auto& x = get<data_message>(i->content);
+    for (auto buf : r.workers)
+      buf->emplace_back(x);
+  }
+}
+
+void core_policy::forward_run(const batch_route& r,
+                              peer_trait::batch::iterator first,
+                              peer_trait::batch::iterator last) {
+  // Decrease the TTL of each message. A TTL of 0 marks dropped messages.
+  for (auto i = first; i != last; ++i)
+    if (i->ttl > 0 && --i->ttl == 0)
+      BROKER_WARNING("dropped a message with expired TTL");
+  if (r.peers.empty())
+    return;
+  // Push the whole run to one peer at a time. Each message still serializes
+  // its payload at most once per encoding.
+  auto n = static_cast<size_t>(std::distance(first, last));
+  batch_payloads_.assign(n, payload_buffer_set{});
+  for (auto& dst : r.peers) {
+    auto& buf = *dst.buf;
+    for (size_t j = 0; j < n; ++j) {
+      auto& x = first[j];
+      if (x.ttl == 0)
+        continue;
+      buf.emplace_back(x);
+      if (!share_payload(dst.slot, *dst.path, buf.back(), batch_payloads_[j])) {
+        buf.pop_back();
+        continue;
+      }
+      encode(dst.slot, buf.back());
+    }
+  }
+}
+
 void core_policy::after_handle_batch(stream_slot, const strong_actor_ptr&) {
   BROKER_TRACE("");
   // Make sure the content of the buffer is pushed to the outbound paths while
@@ -193,12 +298,15 @@ void core_policy::push_to_substreams(std::vector<message> xs) {
   for (auto& x : xs) {
     if (x.match_elements<topic, data>()) {
       x.force_unshare();
-      workers().push(std::move(x.get_mutable_as<topic>(0)),
-                     std::move(x.get_mutable_as<data>(1)));
+      route(workers(), worker_routes_,
+            make_data_message(std::move(x.get_mutable_as<topic>(0)),
+                              std::move(x.get_mutable_as<data>(1))));
     } else if (x.match_elements<topic, internal_command>()) {
       x.force_unshare();
-      stores().push(std::move(x.get_mutable_as<topic>(0)),
-                    std::move(x.get_mutable_as<internal_command>(1)));
+      route(stores(), store_routes_,
+            make_command_message(
+              std::move(x.get_mutable_as<topic>(0)),
+              std::move(x.get_mutable_as<internal_command>(1))));
     }
   }
   workers().emit_batches();
@@ -292,6 +400,29 @@ void core_policy::ack_peering(const stream<node_message>& in,
   add_ipath(slot, peer_hdl);
 }
 
+void core_policy::negotiate(const caf::actor& peer_hdl,
+                            peer_features features) {
+  BROKER_TRACE(BROKER_ARG(peer_hdl) << BROKER_ARG(features));
+  auto i = peer_to_opath_.find(peer_hdl);
+  if (i == peer_to_opath_.end()) {
+    BROKER_DEBUG("cannot negotiate features with unknown peer");
+    return;
+  }
+  auto common = features & features_;
+  if ((common & topic_dictionary_feature) != 0)
+    topic_encoders_.emplace(i->second, topic_encoder{});
+  peer_encoding encoding;
+  if ((common & compact_data_feature) != 0)
+    encoding.format = payload_format::compact;
+  if ((compression_ == compression_method::lz
+       && (common & lz_compression_feature) != 0)
+      || (compression_ == compression_method::zlib
+          && (common & zlib_compression_feature) != 0))
+    encoding.compression = compression_;
+  encoding.message_ids = (common & message_id_feature) != 0;
+  peer_encodings_[i->second] = encoding;
+}
+
 bool core_policy::has_outbound_path_to(const caf::actor& peer_hdl) {
   return peer_to_opath_.count(peer_hdl) != 0;
 }
@@ -311,6 +442,9 @@ bool core_policy::remove_peer(const actor& hdl, error reason, bool silent,
       BROKER_DEBUG("remove outbound path to peer:" << hdl);
       ++performed_erases;
       out().remove_path(i->second, reason, silent);
+      peer_routes_.erase(i->second);
+      topic_encoders_.erase(i->second);
+      peer_encodings_.erase(i->second);
       opath_to_peer_.erase(i->second);
       peer_to_opath_.erase(i);
     }
@@ -322,6 +456,7 @@ bool core_policy::remove_peer(const actor& hdl, error reason, bool silent,
       BROKER_DEBUG("remove inbound path to peer:" << hdl);
       ++performed_erases;
       parent_->remove_input_path(i->second, reason, silent);
+      topic_decoders_.erase(i->second);
       ipath_to_peer_.erase(i->second);
       peer_to_ipath_.erase(i);
     }
@@ -354,6 +489,7 @@ bool core_policy::update_peer(const actor& hdl, filter_type filter) {
     BROKER_DEBUG("cannot update filter on unknown peer");
     return false;
   }
+  peer_routes_.set(i->second, filter);
   peers().filter(i->second).second = std::move(filter);
   return true;
 }
@@ -366,7 +502,7 @@ auto core_policy::add_worker(filter_type filter)
   auto slot = parent_->add_unchecked_outbound_path<worker_trait::element>();
   if (slot != invalid_stream_slot) {
     out().assign<worker_trait::manager>(slot);
-    workers().set_filter(slot, std::move(filter));
+    set_worker_filter(slot, std::move(filter));
   }
   return slot;
 }
@@ -377,18 +513,30 @@ auto core_policy::add_store(filter_type filter)
   auto slot = parent_->add_unchecked_outbound_path<store_trait::element>();
   if (slot != invalid_stream_slot) {
     out().assign<store_trait::manager>(slot);
-    stores().set_filter(slot, std::move(filter));
+    set_store_filter(slot, std::move(filter));
   }
   return slot;
 }
 
+void core_policy::set_worker_filter(stream_slot slot, filter_type filter) {
+  BROKER_TRACE(BROKER_ARG(slot) << BROKER_ARG(filter));
+  worker_routes_.set(slot, filter);
+  workers().set_filter(slot, std::move(filter));
+}
+
+void core_policy::set_store_filter(stream_slot slot, filter_type filter) {
+  BROKER_TRACE(BROKER_ARG(slot) << BROKER_ARG(filter));
+  store_routes_.set(slot, filter);
+  stores().set_filter(slot, std::move(filter));
+}
+
 // -- selectively pushing data into the streams ------------------------------
 
 /// Pushes data to workers without forwarding it to peers.
 void core_policy::local_push(data_message x) {
   BROKER_TRACE(BROKER_ARG(x) << BROKER_ARG2("num_paths", workers().num_paths()));
   if (workers().num_paths() > 0) {
-    workers().push(std::move(x));
+    route(workers(), worker_routes_, x);
     workers().emit_batches();
   }
 }
@@ -397,7 +545,7 @@ void core_policy::local_push(data_message x) {
 void core_policy::local_push(command_message x) {
   BROKER_TRACE(BROKER_ARG(x) << BROKER_ARG2("num_paths", stores().num_paths()));
   if (stores().num_paths() > 0) {
-    stores().push(std::move(x));
+    route(stores(), store_routes_, x);
     stores().emit_batches();
   }
 }
@@ -407,21 +555,21 @@ void core_policy::remote_push(node_message msg) {
   BROKER_TRACE(BROKER_ARG(msg));
   if (recorder_ != nullptr)
     try_record(msg);
-  peers().push(std::move(msg));
+  route(peers(), peer_routes_, msg);
   peers().emit_batches();
 }
 
 /// Pushes data to peers and workers.
 void core_policy::push(data_message msg) {
   BROKER_TRACE(BROKER_ARG(msg));
-  remote_push(make_node_message(std::move(msg), state_->options.ttl));
+  remote_push(make_own_message(std::move(msg), state_->options.ttl));
   //local_push(std::move(x), std::move(y));
 }
 
 /// Pushes data to peers and stores.
 void core_policy::push(command_message msg) {
   BROKER_TRACE(BROKER_ARG(msg));
-  remote_push(make_node_message(std::move(msg), state_->options.ttl));
+  remote_push(make_own_message(std::move(msg), state_->options.ttl));
   //local_push(std::move(x), std::move(y));
 }
 
@@ -480,10 +628,111 @@ std::vector<caf::actor> core_policy::get_peer_handles() {
   return peers;
 }
 
+bool core_policy::share_payload(stream_slot slot, const outbound_path& path,
+                                node_message& x, payload_buffer_set& cache) {
+  if (!is_data_message(x) || path.hdl == nullptr
+      || path.hdl->node() == self()->node())
+    return true;
+  auto& enc = peer_encodings_[slot];
+  auto matches = [](const payload_buffer_ptr& ptr, payload_format format,
+                    compression_method compression) {
+    return ptr != nullptr && ptr->format() == format
+           && ptr->compression() == compression;
+  };
+  auto& ptr = cache[payload_index(enc.format, enc.compression)];
+  if (ptr == nullptr && matches(x.payload, enc.format, enc.compression))
+    ptr = x.payload;
+  if (ptr != nullptr) {
+    stats_.shared_bytes += ptr->size();
+  } else {
+    auto none = compression_method::none;
+    auto& plain = cache[payload_index(enc.format, none)];
+    if (plain == nullptr && matches(x.payload, enc.format, none)) {
+      plain = x.payload;
+    } else if (plain == nullptr) {
+      // Relayed messages may arrive in a different encoding than this peer
+      // expects.
+      if (x.payload != nullptr)
+        plain = convert_payload(*x.payload, enc.format);
+      else
+        plain = make_payload_buffer(
+          get_data(caf::get<data_message>(x.content)), enc.format);
+      if (plain == nullptr) {
+        BROKER_ERROR("unable to encode a message for a peer");
+        return false;
+      }
+      ++stats_.encoded_messages;
+      stats_.encoded_bytes += plain->size();
+    }
+    ptr = plain;
+    if (enc.compression != none && plain->size() >= compression_threshold_) {
+      auto t0 = std::chrono::steady_clock::now();
+      auto compressed = compress_payload(*plain, enc.compression);
+      auto t1 = std::chrono::steady_clock::now();
+      enc.stats.cpu_time += std::chrono::duration_cast<timespan>(t1 - t0);
+      // Fall back to the raw bytes if compression does not pay off.
+      if (compressed != nullptr && compressed->size() < plain->size())
+        ptr = std::move(compressed);
+    }
+  }
+  if (enc.compression != compression_method::none) {
+    if (ptr->compression() != compression_method::none) {
+      ++enc.stats.compressed_messages;
+      enc.stats.raw_bytes += ptr->raw_size();
+      enc.stats.compressed_bytes += ptr->size();
+    } else {
+      ++enc.stats.skipped_messages;
+    }
+  }
+  x.payload = ptr;
+  return true;
+}
+
+std::vector<std::pair<caf::node_id, compression_stats>>
+core_policy::compression_stats_by_peer() const {
+  std::vector<std::pair<caf::node_id, compression_stats>> result;
+  for (auto& kvp : peer_encodings_) {
+    auto i = opath_to_peer_.find(kvp.first);
+    if (i != opath_to_peer_.end())
+      result.emplace_back(i->second.node(), kvp.second.stats);
+  }
+  return result;
+}
+
+void core_policy::encode(stream_slot slot, node_message& x) {
+  auto i = topic_encoders_.find(slot);
+  if (i != topic_encoders_.end())
+    i->second.encode(x);
+  else
+    x.topic_ref = 0;
+  if (x.origin != 0) {
+    auto j = peer_encodings_.find(slot);
+    if (j == peer_encodings_.end() || !j->second.message_ids) {
+      x.origin = 0;
+      x.seq = 0;
+    }
+  }
+}
+
+bool core_policy::decode(stream_slot slot, node_message& x) {
+  if (x.topic_ref == 0)
+    return true;
+  return topic_decoders_[slot].decode(x);
+}
+
 core_policy::ttl core_policy::initial_ttl() const {
   return static_cast<ttl>(state_->options.ttl);
 }
 
+bool core_policy::is_duplicate(const node_message& x) {
+  if (x.origin == 0 || (features_ & message_id_feature) == 0)
+    return false;
+  if (x.origin != origin_ && dedup_.insert(x.origin, x.seq))
+    return false;
+  ++stats_.suppressed_duplicates;
+  return true;
+}
+
 void core_policy::add_ipath(stream_slot slot, const actor& peer_hdl) {
   BROKER_TRACE(BROKER_ARG(slot) << BROKER_ARG(peer_hdl));
   if (slot == invalid_stream_slot) {
@@ -517,13 +766,15 @@ void core_policy::add_opath(stream_slot slot, const actor& peer_hdl) {
 }
 
 auto core_policy::add(std::true_type, const actor& hdl) -> step1_handshake {
-  auto xs = std::make_tuple(state_->filter, actor_cast<actor>(self()));
+  auto xs = std::make_tuple(state_->filter, actor_cast<actor>(self()),
+                            features_, state_->shard_layout());
   return parent_->add_unchecked_outbound_path<node_message>(hdl, std::move(xs));
 }
 
 auto core_policy::add(std::false_type, const actor& hdl) -> step2_handshake {
   atom_value ok = ok_atom::value;
-  auto xs = std::make_tuple(ok, actor_cast<actor>(self()));
+  auto xs = std::make_tuple(ok, actor_cast<actor>(self()), features_,
+                            state_->shard_layout());
   return parent_->add_unchecked_outbound_path<node_message>(hdl, std::move(xs));
 }
 
@@ -0,0 +1,370 @@
+#include "broker/detail/data_codec.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "broker/detail/compact_coding.hh"
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+/// Type IDs in the lower four bits of a header byte.
+enum wire_type : uint8_t {
+  none_type,
+  boolean_type,
+  count_type,
+  integer_type,
+  real_type,
+  string_type,
+  address_type,
+  subnet_type,
+  port_type,
+  timestamp_type,
+  timespan_type,
+  enum_value_type,
+  set_type,
+  table_type,
+  vector_type,
+};
+
+/// Marks a header byte that has a varint after it.
+constexpr uint8_t extended = 0x0F;
+
+/// Limits recursion when decoding nested containers.
+constexpr size_t max_nesting_depth = 128;
+
+template <class Buffer>
+class compact_writer {
+public:
+  explicit compact_writer(Buffer& buf) : buf_(buf) {
+    // nop
+  }
+
+  void operator()(const none&) {
+    put(none_type);
+  }
+
+  void operator()(boolean x) {
+    put_header(boolean_type, x ? 1 : 0);
+  }
+
+  void operator()(count x) {
+    put_header(count_type, x);
+  }
+
+  void operator()(integer x) {
+    put_header(integer_type, zig_zag(x));
+  }
+
+  void operator()(real x) {
+    put(real_type);
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    for (int i = 0; i < 8; ++i)
+      put(static_cast<uint8_t>(bits >> (i * 8)));
+  }
+
+  void operator()(const std::string& x) {
+    put_header(string_type, x.size());
+    buf_.insert(buf_.end(), x.begin(), x.end());
+  }
+
+  void operator()(const address& x) {
+    auto& bytes = x.bytes();
+    if (x.is_v4()) {
+      put_header(address_type, 0);
+      buf_.insert(buf_.end(), bytes.begin() + 12, bytes.end());
+    } else {
+      put_header(address_type, 1);
+      buf_.insert(buf_.end(), bytes.begin(), bytes.end());
+    }
+  }
+
+  void operator()(const subnet& x) {
+    auto& net = x.network();
+    auto& bytes = net.bytes();
+    if (net.is_v4()) {
+      put_header(subnet_type, 0);
+      buf_.insert(buf_.end(), bytes.begin() + 12, bytes.end());
+    } else {
+      put_header(subnet_type, 1);
+      buf_.insert(buf_.end(), bytes.begin(), bytes.end());
+    }
+    put(x.length());
+  }
+
+  void operator()(const port& x) {
+    put_header(port_type, static_cast<uint8_t>(x.type()));
+    put(static_cast<uint8_t>(x.number() >> 8));
+    put(static_cast<uint8_t>(x.number()));
+  }
+
+  void operator()(timestamp x) {
+    put_header(timestamp_type, zig_zag(x.time_since_epoch().count()));
+  }
+
+  void operator()(timespan x) {
+    put_header(timespan_type, zig_zag(x.count()));
+  }
+
+  void operator()(const enum_value& x) {
+    put_header(enum_value_type, x.name.size());
+    buf_.insert(buf_.end(), x.name.begin(), x.name.end());
+  }
+
+  void operator()(const set& xs) {
+    put_header(set_type, xs.size());
+    for (auto& x : xs)
+      (*this)(x);
+  }
+
+  void operator()(const table& xs) {
+    put_header(table_type, xs.size());
+    for (auto& kvp : xs) {
+      (*this)(kvp.first);
+      (*this)(kvp.second);
+    }
+  }
+
+  void operator()(const vector& xs) {
+    put_header(vector_type, xs.size());
+    for (auto& x : xs)
+      (*this)(x);
+  }
+
+  void operator()(const data& x) {
+    caf::visit(*this, x);
+  }
+
+private:
+  void put(uint8_t x) {
+    buf_.push_back(static_cast<char>(x));
+  }
+
+  void put_header(uint8_t type, uint64_t value) {
+    if (value < extended) {
+      put(static_cast<uint8_t>(type | (value << 4)));
+      return;
+    }
+    put(static_cast<uint8_t>(type | (extended << 4)));
+    put_varint(buf_, value - extended);
+  }
+
+  Buffer& buf_;
+};
+
+class compact_reader {
+public:
+  compact_reader(const char* first, const char* last)
+    : pos_(first), last_(last) {
+    // nop
+  }
+
+  const char* position() const noexcept {
+    return pos_;
+  }
+
+  bool read(data& x, size_t depth = 0) {
+    uint8_t header;
+    if (!get(header))
+      return false;
+    auto type = static_cast<uint8_t>(header & 0x0F);
+    uint64_t value = header >> 4;
+    if (value == extended) {
+      uint64_t remainder;
+      if (!get_varint(remainder))
+        return false;
+      value += remainder;
+    }
+    switch (type) {
+      case none_type:
+        x = nil;
+        return value == 0;
+      case boolean_type:
+        if (value > 1)
+          return false;
+        x = value == 1;
+        return true;
+      case count_type:
+        x = count{value};
+        return true;
+      case integer_type:
+        x = integer{unzig_zag(value)};
+        return true;
+      case real_type: {
+        if (value != 0 || remaining() < 8)
+          return false;
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+          bits |= static_cast<uint64_t>(static_cast<uint8_t>(pos_[i]))
+                  << (i * 8);
+        pos_ += 8;
+        real result;
+        memcpy(&result, &bits, sizeof(result));
+        x = result;
+        return true;
+      }
+      case string_type: {
+        std::string str;
+        if (!get_string(value, str))
+          return false;
+        x = std::move(str);
+        return true;
+      }
+      case address_type: {
+        address addr;
+        if (!get_address(value, addr))
+          return false;
+        x = addr;
+        return true;
+      }
+      case subnet_type: {
+        address addr;
+        uint8_t length;
+        if (!get_address(value, addr) || !get(length))
+          return false;
+        x = subnet{addr, length};
+        return true;
+      }
+      case port_type: {
+        uint8_t hi;
+        uint8_t lo;
+        if (value > static_cast<uint8_t>(port::protocol::icmp) || !get(hi)
+            || !get(lo))
+          return false;
+        auto num = static_cast<port::number_type>((hi << 8) | lo);
+        x = port{num, static_cast<port::protocol>(value)};
+        return true;
+      }
+      case timestamp_type:
+        x = timestamp{timespan{unzig_zag(value)}};
+        return true;
+      case timespan_type:
+        x = timespan{unzig_zag(value)};
+        return true;
+      case enum_value_type: {
+        std::string str;
+        if (!get_string(value, str))
+          return false;
+        x = enum_value{std::move(str)};
+        return true;
+      }
+      case set_type: {
+        if (depth >= max_nesting_depth)
+          return false;
+        set xs;
+        for (uint64_t i = 0; i < value; ++i) {
+          data tmp;
+          if (!read(tmp, depth + 1))
+            return false;
+          xs.emplace_hint(xs.end(), std::move(tmp));
+        }
+        x = std::move(xs);
+        return true;
+      }
+      case table_type: {
+        if (depth >= max_nesting_depth)
+          return false;
+        table xs;
+        for (uint64_t i = 0; i < value; ++i) {
+          data key;
+          data val;
+          if (!read(key, depth + 1) || !read(val, depth + 1))
+            return false;
+          xs.emplace_hint(xs.end(), std::move(key), std::move(val));
+        }
+        x = std::move(xs);
+        return true;
+      }
+      case vector_type: {
+        if (depth >= max_nesting_depth)
+          return false;
+        vector xs;
+        // Each element needs at least one byte.
+        xs.reserve(std::min(value, static_cast<uint64_t>(remaining())));
+        for (uint64_t i = 0; i < value; ++i) {
+          xs.emplace_back();
+          if (!read(xs.back(), depth + 1))
+            return false;
+        }
+        x = std::move(xs);
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+private:
+  size_t remaining() const noexcept {
+    return static_cast<size_t>(last_ - pos_);
+  }
+
+  bool get(uint8_t& x) {
+    if (pos_ == last_)
+      return false;
+    x = static_cast<uint8_t>(*pos_++);
+    return true;
+  }
+
+  bool get_varint(uint64_t& x) {
+    auto pos = detail::get_varint(pos_, last_, x);
+    if (pos == nullptr)
+      return false;
+    pos_ = pos;
+    return true;
+  }
+
+  bool get_string(uint64_t size, std::string& x) {
+    if (size > remaining())
+      return false;
+    x.assign(pos_, static_cast<size_t>(size));
+    pos_ += size;
+    return true;
+  }
+
+  bool get_address(uint64_t family, address& x) {
+    auto& bytes = x.bytes();
+    if (family == 0) {
+      if (remaining() < 4)
+        return false;
+      std::copy(std::begin(v4_mapped_prefix), std::end(v4_mapped_prefix),
+                bytes.begin());
+      std::copy(pos_, pos_ + 4, bytes.begin() + 12);
+      pos_ += 4;
+      return true;
+    }
+    if (family != 1 || remaining() < 16)
+      return false;
+    std::copy(pos_, pos_ + 16, bytes.begin());
+    pos_ += 16;
+    return true;
+  }
+
+  const char* pos_;
+  const char* last_;
+};
+
+} // namespace
+
+void compact_encode(const data& x, std::vector<char>& buf) {
+  compact_writer<std::vector<char>> writer{buf};
+  writer(x);
+}
+
+void compact_encode(const data& x, std::string& buf) {
+  compact_writer<std::string> writer{buf};
+  writer(x);
+}
+
+const char* compact_decode(const char* first, const char* last, data& x) {
+  compact_reader reader{first, last};
+  if (!reader.read(x))
+    return nullptr;
+  return reader.position();
+}
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,59 @@
+#include "broker/detail/dedup_table.hh"
+
+#include <algorithm>
+
+namespace broker {
+namespace detail {
+
+dedup_table::dedup_table(size_t max_origins)
+  : max_origins_(std::max(max_origins, size_t{1})) {
+  // nop
+}
+
+bool dedup_table::insert(uint64_t origin, uint64_t seq) {
+  ++ticks_;
+  auto i = windows_.find(origin);
+  if (i == windows_.end()) {
+    if (windows_.size() >= max_origins_)
+      evict();
+    auto& w = windows_[origin];
+    w.last = seq;
+    w.last_active = ticks_;
+    w.bits.fill(0);
+    w.set(seq);
+    return true;
+  }
+  auto& w = i->second;
+  w.last_active = ticks_;
+  if (seq > w.last) {
+    // Slide the window forward and forget everything that falls out of it.
+    if (seq - w.last >= window_size)
+      w.bits.fill(0);
+    else
+      for (auto x = w.last + 1; x != seq; ++x)
+        w.reset(x);
+    w.last = seq;
+    w.set(seq);
+    return true;
+  }
+  // Messages that fell out of the window may or may not be duplicates. We
+  // rather deliver a duplicate than drop a message.
+  if (w.last - seq >= window_size)
+    return true;
+  if (w.test(seq))
+    return false;
+  w.set(seq);
+  return true;
+}
+
+void dedup_table::evict() {
+  auto older = [](const auto& x, const auto& y) {
+    return x.second.last_active < y.second.last_active;
+  };
+  auto i = std::min_element(windows_.begin(), windows_.end(), older);
+  if (i != windows_.end())
+    windows_.erase(i);
+}
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,50 @@
+#include "broker/detail/expiry_index.hh"
+
+namespace broker {
+namespace detail {
+
+void expiry_index::add(const data& key, timestamp expiry) {
+  auto i = deadlines_.find(key);
+  if (i != deadlines_.end()) {
+    if (i->second == expiry)
+      return;
+    queue_.erase(std::make_pair(i->second, key));
+    i->second = expiry;
+  } else {
+    deadlines_.emplace(key, expiry);
+  }
+  queue_.emplace(expiry, key);
+}
+
+void expiry_index::erase(const data& key) {
+  auto i = deadlines_.find(key);
+  if (i == deadlines_.end())
+    return;
+  queue_.erase(std::make_pair(i->second, key));
+  deadlines_.erase(i);
+}
+
+void expiry_index::clear() {
+  queue_.clear();
+  deadlines_.clear();
+}
+
+std::vector<data> expiry_index::take_due(timestamp now) {
+  std::vector<data> result;
+  auto i = queue_.begin();
+  for (; i != queue_.end() && i->first <= now; ++i) {
+    deadlines_.erase(i->second);
+    result.emplace_back(i->second);
+  }
+  queue_.erase(queue_.begin(), i);
+  return result;
+}
+
+optional<timestamp> expiry_index::next() const {
+  if (queue_.empty())
+    return nil;
+  return queue_.begin()->first;
+}
+
+} // namespace detail
+} // namespace broker
@@ -5,21 +5,39 @@
 #include <poll.h>
 #include <unistd.h>
 
-#include <exception>
 #include <algorithm>
+#include <cstdint>
+#include <exception>
 
+#include "broker/config.hh"
 #include "broker/logger.hh"
 
+#ifdef BROKER_LINUX
+#include <sys/eventfd.h>
+#endif
+
 namespace broker {
 namespace detail {
 
+#ifndef BROKER_LINUX
+
 namespace {
 
 constexpr size_t stack_buffer_size = 256;
 
 } // namespace <anonymous>
 
-flare::flare() {
+#endif // BROKER_LINUX
+
+flare::flare() : count_(0), signaled_(false) {
+#ifdef BROKER_LINUX
+  fds_[0] = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fds_[0] == -1) {
+    BROKER_ERROR("failed to create flare eventfd");
+    std::terminate();
+  }
+  fds_[1] = fds_[0];
+#else
   if (::pipe(fds_) == -1) {
     BROKER_ERROR("failed to create flare pipe");
     std::terminate();
@@ -44,14 +62,15 @@ flare::flare() {
     std::terminate();
   }
 
-  // Do not set the write handle to nonblock, because we want the producer to
-  // slow down in case the consumer cannot keep up emptying the pipe.
-  //::fcntl(fds_[1], F_SETFL, ::fcntl(fds_[1], F_GETFL) | O_NONBLOCK);
+  // The pipe holds at most one byte, because we only write to it when
+  // the count becomes non-zero. Hence, the write handle never blocks.
+#endif
 }
 
 flare::~flare() {
   close(fds_[0]);
-  close(fds_[1]);
+  if (fds_[1] != fds_[0])
+    close(fds_[1]);
 }
 
 int flare::fd() const {
@@ -59,39 +78,108 @@ int flare::fd() const {
 }
 
 void flare::fire(size_t num) {
-  char tmp[stack_buffer_size];
-  size_t remaining = num;
-  while (remaining > 0) {
-    auto n = ::write(fds_[1], tmp,
-                     static_cast<int>(std::min(remaining, stack_buffer_size)));
-    if (n <= 0) {
-      BROKER_ERROR("unable to write flare pipe!");
-      std::terminate();
-    }
-    remaining -= static_cast<size_t>(n);
-  }
+  if (num == 0)
+    return;
+  // Only the transition from zero to non-zero requires a system call.
+  if (count_.fetch_add(num) == 0)
+    sync();
 }
 
 size_t flare::extinguish() {
+  auto result = count_.exchange(0);
+  if (result > 0)
+    sync();
+  return result;
+}
+
+bool flare::extinguish_one() {
+  return extinguish_some(1) == 1;
+}
+
+size_t flare::extinguish_some(size_t num) {
+  auto old_count = count_.load();
+  size_t n;
+  do {
+    n = std::min(num, old_count);
+    if (n == 0)
+      return 0;
+  } while (!count_.compare_exchange_weak(old_count, old_count - n));
+  if (old_count == n)
+    sync();
+  return n;
+}
+
+void flare::sync() {
+  // Concurrent fire/extinguish calls may race for the file descriptor. We
+  // serialize them here and always apply the latest count, which makes sure
+  // the last caller leaves the file descriptor in the correct state.
+  std::unique_lock<std::mutex> guard{mtx_};
+  auto ready = count_.load() > 0;
+  if (ready == signaled_)
+    return;
+  if (ready)
+    signal();
+  else
+    clear();
+  signaled_ = ready;
+}
+
+void flare::signal() {
+#ifdef BROKER_LINUX
+  uint64_t one = 1;
+  for (;;) {
+    auto n = ::write(fds_[1], &one, sizeof(one));
+    if (n == sizeof(one))
+      return;
+    if (n < 0 && errno == EINTR)
+      continue;
+    BROKER_ERROR("unable to write flare eventfd!");
+    std::terminate();
+  }
+#else
+  char tmp = 0;
+  for (;;) {
+    auto n = ::write(fds_[1], &tmp, 1);
+    if (n == 1)
+      return;
+    if (n < 0 && errno == EINTR)
+      continue;
+    BROKER_ERROR("unable to write flare pipe!");
+    std::terminate();
+  }
+#endif
+}
+
+void flare::clear() {
+#ifdef BROKER_LINUX
+  // Reading an eventfd resets its counter.
+  uint64_t tmp = 0;
+  for (;;) {
+    auto n = ::read(fds_[0], &tmp, sizeof(tmp));
+    if (n == sizeof(tmp) || (n < 0 && errno == EAGAIN))
+      return;
+  }
+#else
   char tmp[stack_buffer_size];
-  size_t result = 0;
   for (;;) {
     auto n = ::read(fds_[0], tmp, stack_buffer_size);
-    if (n > 0)
-      result += static_cast<size_t>(n);
-    else if (n == -1 && errno == EAGAIN)
-      return result; // Pipe is now drained.
+    if (n == -1 && errno == EAGAIN)
+      return; // Pipe is now drained.
   }
+#endif
 }
 
-bool flare::extinguish_one() {
-  char tmp = 0;
+bool flare::spin_one(timespan window) const {
+  // Reading the clock is more expensive than checking the count. Hence, we
+  // only check the deadline every couple of iterations.
+  constexpr size_t iterations_per_clock_check = 64;
+  auto deadline = std::chrono::steady_clock::now() + window;
   for (;;) {
-    auto n = ::read(fds_[0], &tmp, 1);
-    if (n == 1)
-      return true; // Read one byte.
-    if (n < 0 && errno == EAGAIN)
-      return false; // No data available to read.
+    for (size_t i = 0; i < iterations_per_clock_check; ++i)
+      if (active())
+        return true;
+    if (std::chrono::steady_clock::now() >= deadline)
+      return active();
   }
 }
 
@@ -0,0 +1,61 @@
+#include "broker/detail/local_dispatcher.hh"
+
+#include <algorithm>
+
+#include "broker/detail/prefix_matcher.hh"
+
+namespace broker {
+namespace detail {
+
+local_dispatcher::local_dispatcher() : version_(1) {
+  // nop
+}
+
+void local_dispatcher::subscribe(queue_ptr q, filter_type filter) {
+  std::unique_lock<std::mutex> guard{mtx_};
+  auto pred = [&](const subscription& x) { return x.first == q; };
+  auto e = subscriptions_.end();
+  auto i = std::find_if(subscriptions_.begin(), e, pred);
+  if (i != e)
+    i->second = std::move(filter);
+  else
+    subscriptions_.emplace_back(std::move(q), std::move(filter));
+  ++version_;
+}
+
+void local_dispatcher::unsubscribe(const queue_ptr& q) {
+  std::unique_lock<std::mutex> guard{mtx_};
+  auto pred = [&](const subscription& x) { return x.first == q; };
+  auto e = subscriptions_.end();
+  auto i = std::remove_if(subscriptions_.begin(), e, pred);
+  if (i != e) {
+    subscriptions_.erase(i, e);
+    ++version_;
+  }
+}
+
+auto local_dispatcher::lookup(const topic& t, route_ptr cached) const
+  -> route_ptr {
+  if (cached != nullptr && cached->version == version_.load())
+    return cached;
+  auto result = std::make_shared<route>();
+  std::unique_lock<std::mutex> guard{mtx_};
+  result->version = version_.load();
+  prefix_matcher matches;
+  for (auto& sub : subscriptions_)
+    if (matches(sub.second, t))
+      result->queues.emplace_back(sub.first);
+  return result;
+}
+
+void local_dispatcher::deliver(const route& r, const data_message& x) {
+  for (auto& q : r.queues)
+    q->produce(x);
+}
+
+void local_dispatcher::deliver(const data_message& x) const {
+  deliver(*lookup(get_topic(x), nullptr), x);
+}
+
+} // namespace detail
+} // namespace broker
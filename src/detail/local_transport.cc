@@ -0,0 +1,915 @@
+#include "broker/logger.hh" // Must come before any CAF include.
+#include "broker/detail/local_transport.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <caf/actor_registry.hpp>
+#include <caf/actor_system.hpp>
+#include <caf/atom.hpp>
+#include <caf/exit_reason.hpp>
+#include <caf/io/basp_broker.hpp>
+#include <caf/io/middleman.hpp>
+#include <caf/io/middleman_actor_impl.hpp>
+#include <caf/io/network/default_multiplexer.hpp>
+#include <caf/io/network/doorman_impl.hpp>
+#include <caf/io/network/event_handler.hpp>
+#include <caf/io/network/native_socket.hpp>
+#include <caf/io/network/operation.hpp>
+#include <caf/io/network/scribe_impl.hpp>
+#include <caf/io/network/stream_manager.hpp>
+#include <caf/io/receive_policy.hpp>
+#include <caf/io/scribe.hpp>
+#include <caf/make_counted.hpp>
+#include <caf/send.hpp>
+#include <caf/sec.hpp>
+
+#include "broker/config.hh"
+#include "broker/detail/shm_ring.hh"
+
+#include <errno.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef BROKER_LINUX
+#include <sys/mman.h>
+#endif
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+using caf::io::network::default_multiplexer;
+using caf::io::network::native_socket;
+using caf::io::network::operation;
+
+/// Key of the local middleman in the actor registry.
+constexpr caf::atom_value local_middleman_key = caf::atom("BrokerLoc");
+
+/// Guards spawning and terminating the local middleman.
+std::mutex local_middleman_mtx;
+
+// -- Unix domain sockets ------------------------------------------------------
+
+/// Computes the address of the socket file for `address`.
+bool unix_sockaddr(const std::string& address, sockaddr_un& addr,
+                   socklen_t& len) {
+  auto path = address.substr(sizeof(unix_scheme) - 1);
+  if (path.empty() || path.size() + 1 > sizeof(addr.sun_path))
+    return false;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, path.data(), path.size());
+  len = static_cast<socklen_t>(sizeof(addr));
+  return true;
+}
+
+/// Unix domain sockets only differ from TCP sockets in how they report
+/// their address.
+class unix_scribe : public caf::io::network::scribe_impl {
+public:
+  unix_scribe(default_multiplexer& mpx, native_socket sockfd,
+              std::string addr)
+    : scribe_impl(mpx, sockfd), addr_(std::move(addr)) {
+    // nop
+  }
+
+  std::string addr() const override {
+    return addr_;
+  }
+
+  uint16_t port() const override {
+    return 0;
+  }
+
+private:
+  std::string addr_;
+};
+
+class unix_doorman : public caf::io::network::doorman_impl {
+public:
+  unix_doorman(default_multiplexer& mpx, native_socket sockfd,
+               std::string addr)
+    : doorman_impl(mpx, sockfd), addr_(std::move(addr)) {
+    // nop
+  }
+
+  ~unix_doorman() override {
+    unlink(addr_.c_str() + sizeof(unix_scheme) - 1);
+  }
+
+  bool new_connection() override {
+    if (detached())
+      return false;
+    auto& dm = acceptor_.backend();
+    auto sockfd = acceptor_.accepted_socket();
+    caf::io::network::nonblocking(sockfd, true);
+    auto scrb = caf::make_counted<unix_scribe>(dm, sockfd, addr_);
+    auto hdl = scrb->hdl();
+    parent()->add_scribe(std::move(scrb));
+    return doorman::new_connection(&dm, hdl);
+  }
+
+  std::string addr() const override {
+    return addr_;
+  }
+
+  uint16_t port() const override {
+    return 0;
+  }
+
+private:
+  std::string addr_;
+};
+
+caf::expected<caf::io::scribe_ptr> connect_unix(default_multiplexer& mpx,
+                                                const std::string& host) {
+  sockaddr_un addr;
+  socklen_t len;
+  if (!unix_sockaddr(host, addr, len))
+    return caf::make_error(caf::sec::invalid_argument, host);
+  auto sockfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sockfd == -1)
+    return caf::make_error(caf::sec::cannot_connect_to_node, host);
+  if (::connect(sockfd, reinterpret_cast<sockaddr*>(&addr), len) != 0) {
+    ::close(sockfd);
+    return caf::make_error(caf::sec::cannot_connect_to_node, host);
+  }
+  caf::io::network::child_process_inherit(sockfd, false);
+  caf::io::network::nonblocking(sockfd, true);
+  caf::io::scribe_ptr result = caf::make_counted<unix_scribe>(mpx, sockfd,
+                                                              host);
+  return result;
+}
+
+caf::expected<caf::io::doorman_ptr> open_unix(default_multiplexer& mpx,
+                                              const std::string& host) {
+  sockaddr_un addr;
+  socklen_t len;
+  if (!unix_sockaddr(host, addr, len))
+    return caf::make_error(caf::sec::invalid_argument, host);
+  // Remove stale socket files from previous runs, but nothing else.
+  struct stat st;
+  if (lstat(addr.sun_path, &st) == 0 && S_ISSOCK(st.st_mode))
+    unlink(addr.sun_path);
+  auto sockfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sockfd == -1)
+    return caf::make_error(caf::sec::cannot_open_port, host);
+  if (::bind(sockfd, reinterpret_cast<sockaddr*>(&addr), len) != 0
+      || ::listen(sockfd, SOMAXCONN) != 0) {
+    ::close(sockfd);
+    return caf::make_error(caf::sec::cannot_open_port, host);
+  }
+  caf::io::network::child_process_inherit(sockfd, false);
+  caf::io::network::nonblocking(sockfd, true);
+  caf::io::doorman_ptr result = caf::make_counted<unix_doorman>(mpx, sockfd,
+                                                                host);
+  return result;
+}
+
+// -- shared memory ------------------------------------------------------------
+
+#ifdef BROKER_LINUX
+
+/// Capacity of each ring, i.e., the number of bytes one side can write
+/// before it has to wait for the other side.
+constexpr size_t ring_capacity = 1024 * 1024;
+
+/// Size of the memory for a single ring.
+constexpr size_t ring_size = shm_ring::memory_size(ring_capacity);
+
+/// Size of a segment with one ring per direction.
+constexpr size_t segment_size = 2 * ring_size;
+
+/// Maps a segment into the address space of this process for as long as a
+/// connection exists.
+class shm_segment {
+public:
+  shm_segment() : addr_(nullptr) {
+    // nop
+  }
+
+  /// Maps the segment in `fd` and attaches to its rings unless they are
+  /// still uninitialized.
+  explicit shm_segment(int fd) : addr_(nullptr) {
+    // Accessing pages beyond the end of a shorter file raises SIGBUS.
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(segment_size))
+      return;
+    auto ptr = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+    if (ptr == MAP_FAILED)
+      return;
+    addr_ = ptr;
+    down_ = shm_ring::attach(addr_, ring_size);
+    up_ = shm_ring::attach(reinterpret_cast<char*>(addr_) + ring_size,
+                           ring_size);
+  }
+
+  shm_segment(shm_segment&& other) noexcept
+    : addr_(other.addr_), down_(other.down_), up_(other.up_) {
+    other.addr_ = nullptr;
+    other.down_ = shm_ring{};
+    other.up_ = shm_ring{};
+  }
+
+  shm_segment& operator=(shm_segment&& other) noexcept {
+    std::swap(addr_, other.addr_);
+    std::swap(down_, other.down_);
+    std::swap(up_, other.up_);
+    return *this;
+  }
+
+  ~shm_segment() {
+    if (addr_ != nullptr)
+      munmap(addr_, segment_size);
+  }
+
+  /// Initializes both rings. Only the accepting side calls this.
+  void init() {
+    if (addr_ == nullptr)
+      return;
+    down_ = shm_ring::init(addr_, ring_capacity);
+    up_ = shm_ring::init(reinterpret_cast<char*>(addr_) + ring_size,
+                         ring_capacity);
+  }
+
+  /// Returns the ring that transfers data from the accepting to the
+  /// connecting side.
+  const shm_ring& downstream() const {
+    return down_;
+  }
+
+  /// Returns the ring that transfers data from the connecting to the
+  /// accepting side.
+  const shm_ring& upstream() const {
+    return up_;
+  }
+
+  /// Checks whether the segment is mapped and contains two valid rings.
+  explicit operator bool() const {
+    return down_ && up_;
+  }
+
+private:
+  void* addr_;
+  shm_ring down_;
+  shm_ring up_;
+};
+
+/// Creates and initializes a new segment.
+/// @returns the file descriptor of the segment or -1 on error.
+int make_segment() {
+  auto fd = memfd_create("broker-shm", MFD_CLOEXEC);
+  if (fd == -1)
+    return -1;
+  if (ftruncate(fd, static_cast<off_t>(segment_size)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/// Computes the address of the rendezvous socket in the abstract namespace,
+/// which requires no cleanup when the process goes away.
+bool shm_sockaddr(const std::string& address, uint16_t port, sockaddr_un& addr,
+                  socklen_t& len) {
+  auto name = "broker-shm:" + address.substr(sizeof(shm_scheme) - 1) + ':'
+              + std::to_string(port);
+  if (name.size() + 1 > sizeof(addr.sun_path))
+    return false;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path + 1, name.data(), name.size());
+  len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1
+                               + name.size());
+  return true;
+}
+
+/// Checks whether the process at the other end of `sock` runs as the same
+/// user. Anyone can bind and connect to names in the abstract namespace, so
+/// we have to check ourselves who is on the other side.
+bool same_user(native_socket sock) {
+  ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0
+      || len != sizeof(cred))
+    return false;
+  return cred.uid == getuid();
+}
+
+/// Sends the file descriptor of a segment to the connecting side.
+bool send_segment(native_socket sock, int fd) {
+  char byte = 0;
+  iovec iov{&byte, 1};
+  union {
+    cmsghdr hdr;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } ctrl;
+  memset(&ctrl, 0, sizeof(ctrl));
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof(ctrl.buf);
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  return sendmsg(sock, &msg, MSG_NOSIGNAL) == 1;
+}
+
+/// Receives the file descriptor of a segment from the accepting side.
+/// @returns the file descriptor or -1 on error.
+int receive_segment(native_socket sock) {
+  char byte;
+  iovec iov{&byte, 1};
+  union {
+    cmsghdr hdr;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } ctrl;
+  memset(&ctrl, 0, sizeof(ctrl));
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof(ctrl.buf);
+  if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1)
+    return -1;
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET
+      || cmsg->cmsg_type != SCM_RIGHTS)
+    return -1;
+  int fd;
+  memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  return fd;
+}
+
+/// Implements the byte stream of a scribe on top of two shared rings. The
+/// socket only carries wakeups: writers send a single byte after writing to
+/// a ring with a sleeping reader and readers send a single byte after
+/// reading from a ring with a sleeping writer. A reader only drains the
+/// socket after emptying its ring, which keeps the socket readable for as
+/// long as data waits in the ring without a pending wakeup.
+class shm_stream : public caf::io::network::event_handler {
+public:
+  using manager_ptr = caf::intrusive_ptr<caf::io::network::stream_manager>;
+
+  shm_stream(default_multiplexer& mpx, native_socket sockfd,
+             shm_segment segment, bool accepted)
+    : event_handler(mpx, sockfd),
+      segment_(std::move(segment)),
+      in_(accepted ? segment_.upstream() : segment_.downstream()),
+      out_(accepted ? segment_.downstream() : segment_.upstream()),
+      reading_(false),
+      read_threshold_(1),
+      collected_(0),
+      max_(1024),
+      rd_flag_(caf::io::receive_policy_flag::at_most),
+      ack_writes_(false),
+      writing_(false),
+      write_blocked_(false),
+      shutdown_pending_(false),
+      written_(0) {
+    prepare_next_read();
+  }
+
+  void start(caf::io::network::stream_manager* mgr) {
+    activate(mgr);
+  }
+
+  void activate(caf::io::network::stream_manager* mgr) {
+    reader_.reset(mgr);
+    if (!reading_) {
+      reading_ = true;
+      backend().add(operation::read, fd(), this);
+    }
+  }
+
+  void passivate() {
+    if (reading_) {
+      reading_ = false;
+      backend().del(operation::read, fd(), this);
+    }
+  }
+
+  void configure_read(caf::io::receive_policy::config config) {
+    rd_flag_ = config.first;
+    max_ = config.second;
+    prepare_next_read();
+  }
+
+  void ack_writes(bool x) {
+    ack_writes_ = x;
+  }
+
+  std::vector<char>& wr_buf() {
+    return wr_offline_buf_;
+  }
+
+  std::vector<char>& rd_buf() {
+    return rd_buf_;
+  }
+
+  void flush(const manager_ptr& mgr) {
+    if (wr_offline_buf_.empty() || writing_)
+      return;
+    writer_ = mgr;
+    writing_ = true;
+    wr_buf_.swap(wr_offline_buf_);
+    wr_offline_buf_.clear();
+    written_ = 0;
+    backend().add(operation::write, fd(), this);
+  }
+
+  void handle_event(operation op) override {
+    switch (op) {
+      case operation::read:
+        handle_read();
+        break;
+      case operation::write:
+        handle_write();
+        break;
+      case operation::propagate_error:
+        if (reader_ != nullptr)
+          reader_->io_failure(&backend(), operation::read);
+        if (writer_ != nullptr)
+          writer_->io_failure(&backend(), operation::write);
+        break;
+    }
+  }
+
+  void removed_from_loop(operation op) override {
+    switch (op) {
+      case operation::read:
+        reader_.reset();
+        break;
+      case operation::write:
+        // Blocked writers leave the loop temporarily.
+        if (!writing_)
+          writer_.reset();
+        break;
+      case operation::propagate_error:
+        break;
+    }
+  }
+
+  void graceful_shutdown() override {
+    if (writing_)
+      shutdown_pending_ = true;
+    else
+      ::shutdown(fd(), SHUT_WR);
+  }
+
+private:
+  void handle_read() {
+    // Each wakeup may also signal free space in the outbound ring.
+    if (write_blocked_ && out_.space() > 0) {
+      write_blocked_ = false;
+      backend().add(operation::write, fd(), this);
+    }
+    if (reader_ == nullptr)
+      return;
+    // Avoid starving other connections, but only stop early while the
+    // socket stays readable. Otherwise, the remaining data would never
+    // trigger another read event.
+    auto budget = in_.capacity();
+    for (;;) {
+      auto n = in_.read(rd_buf_.data() + collected_,
+                        rd_buf_.size() - collected_);
+      if (n == shm_ring::npos) {
+        BROKER_ERROR("shared-memory peer corrupted the inbound ring");
+        reader_->io_failure(&backend(), operation::read);
+        passivate();
+        return;
+      }
+      if (n > 0) {
+        if (in_.wake_writer())
+          wake_peer();
+        collected_ += n;
+        if (collected_ >= read_threshold_) {
+          if (!reader_->consume(&backend(), rd_buf_.data(), collected_)) {
+            passivate();
+            return;
+          }
+          prepare_next_read();
+          if (!reading_ || reader_ == nullptr)
+            return;
+        }
+        budget -= std::min(budget, n);
+        if (budget == 0 && in_.reader_wakeup_pending())
+          return;
+        continue;
+      }
+      if (!drain()) {
+        reader_->io_failure(&backend(), operation::read);
+        passivate();
+        return;
+      }
+      if (in_.await_data())
+        return;
+    }
+  }
+
+  void handle_write() {
+    if (writer_ == nullptr || !writing_)
+      return;
+    auto n = out_.write(wr_buf_.data() + written_,
+                        wr_buf_.size() - written_);
+    if (n == shm_ring::npos) {
+      BROKER_ERROR("shared-memory peer corrupted the outbound ring");
+      writer_->io_failure(&backend(), operation::write);
+      writing_ = false;
+      backend().del(operation::write, fd(), this);
+      return;
+    }
+    if (n == 0) {
+      // Wait for the reader to free up space instead of spinning.
+      if (out_.await_space()) {
+        write_blocked_ = true;
+        backend().del(operation::write, fd(), this);
+      }
+      return;
+    }
+    if (out_.wake_reader())
+      wake_peer();
+    written_ += n;
+    auto remaining = wr_buf_.size() - written_;
+    if (ack_writes_)
+      writer_->data_transferred(&backend(), n,
+                                remaining + wr_offline_buf_.size());
+    if (remaining == 0)
+      prepare_next_write();
+  }
+
+  void prepare_next_read() {
+    collected_ = 0;
+    switch (rd_flag_) {
+      case caf::io::receive_policy_flag::exactly:
+        rd_buf_.resize(max_);
+        read_threshold_ = max_;
+        break;
+      case caf::io::receive_policy_flag::at_most:
+        rd_buf_.resize(max_);
+        read_threshold_ = 1;
+        break;
+      case caf::io::receive_policy_flag::at_least:
+        rd_buf_.resize(max_ + std::max<size_t>(100, max_ / 10));
+        read_threshold_ = max_;
+        break;
+    }
+  }
+
+  void prepare_next_write() {
+    written_ = 0;
+    wr_buf_.clear();
+    if (wr_offline_buf_.empty()) {
+      writing_ = false;
+      backend().del(operation::write, fd(), this);
+      if (shutdown_pending_)
+        ::shutdown(fd(), SHUT_WR);
+    } else {
+      wr_buf_.swap(wr_offline_buf_);
+    }
+  }
+
+  /// Wakes up the other side.
+  void wake_peer() {
+    char byte = 0;
+    // A full socket buffer already contains enough wakeups and errors
+    // surface as disconnects on the next read.
+    if (::send(fd(), &byte, 1, MSG_NOSIGNAL | MSG_DONTWAIT) < 0)
+      BROKER_DEBUG("failed to wake up shared-memory peer");
+  }
+
+  /// Consumes all pending wakeups.
+  /// @returns `false` if the other side closed the connection.
+  bool drain() {
+    char buf[64];
+    for (;;) {
+      auto n = ::recv(fd(), buf, sizeof(buf), MSG_DONTWAIT);
+      if (n > 0) {
+        if (static_cast<size_t>(n) < sizeof(buf))
+          return true;
+        continue;
+      }
+      if (n == 0)
+        return false;
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+  }
+
+  shm_segment segment_;
+  shm_ring in_;
+  shm_ring out_;
+
+  // State for reading.
+  manager_ptr reader_;
+  bool reading_;
+  size_t read_threshold_;
+  size_t collected_;
+  size_t max_;
+  caf::io::receive_policy_flag rd_flag_;
+  std::vector<char> rd_buf_;
+
+  // State for writing.
+  manager_ptr writer_;
+  bool ack_writes_;
+  bool writing_;
+  bool write_blocked_;
+  bool shutdown_pending_;
+  size_t written_;
+  std::vector<char> wr_buf_;
+  std::vector<char> wr_offline_buf_;
+};
+
+class shm_scribe : public caf::io::scribe {
+public:
+  shm_scribe(default_multiplexer& mpx, native_socket sockfd,
+             shm_segment segment, bool accepted, std::string addr,
+             uint16_t port)
+    : scribe(caf::io::network::conn_hdl_from_socket(sockfd)),
+      launched_(false),
+      stream_(mpx, sockfd, std::move(segment), accepted),
+      addr_(std::move(addr)),
+      port_(port) {
+    // nop
+  }
+
+  void configure_read(caf::io::receive_policy::config config) override {
+    stream_.configure_read(config);
+    if (!launched_)
+      launch();
+  }
+
+  void ack_writes(bool enable) override {
+    stream_.ack_writes(enable);
+  }
+
+  std::vector<char>& wr_buf() override {
+    return stream_.wr_buf();
+  }
+
+  std::vector<char>& rd_buf() override {
+    return stream_.rd_buf();
+  }
+
+  void graceful_shutdown() override {
+    stream_.graceful_shutdown();
+    detach(&stream_.backend(), false);
+  }
+
+  void flush() override {
+    stream_.flush(this);
+  }
+
+  std::string addr() const override {
+    return addr_;
+  }
+
+  uint16_t port() const override {
+    return port_;
+  }
+
+  void launch() {
+    launched_ = true;
+    stream_.start(this);
+  }
+
+  void add_to_loop() override {
+    stream_.activate(this);
+  }
+
+  void remove_from_loop() override {
+    stream_.passivate();
+  }
+
+private:
+  bool launched_;
+  shm_stream stream_;
+  std::string addr_;
+  uint16_t port_;
+};
+
+/// Accepts connections on the rendezvous socket and hands each new
+/// connection a fresh segment.
+class shm_doorman : public caf::io::network::doorman_impl {
+public:
+  shm_doorman(default_multiplexer& mpx, native_socket sockfd,
+              std::string addr, uint16_t port)
+    : doorman_impl(mpx, sockfd), addr_(std::move(addr)), port_(port) {
+    // nop
+  }
+
+  bool new_connection() override {
+    if (detached())
+      return false;
+    auto& dm = acceptor_.backend();
+    auto sockfd = acceptor_.accepted_socket();
+    if (!same_user(sockfd)) {
+      BROKER_ERROR("rejected shared-memory peer of another user");
+      ::close(sockfd);
+      return false;
+    }
+    auto fd = make_segment();
+    shm_segment segment;
+    if (fd != -1) {
+      segment = shm_segment{fd};
+      segment.init();
+    }
+    if (!segment || !send_segment(sockfd, fd)) {
+      BROKER_ERROR("unable to set up shared memory for new connection");
+      if (fd != -1)
+        ::close(fd);
+      ::close(sockfd);
+      return false;
+    }
+    // The mapping keeps the segment alive.
+    ::close(fd);
+    caf::io::network::nonblocking(sockfd, true);
+    auto scrb = caf::make_counted<shm_scribe>(dm, sockfd, std::move(segment),
+                                              true, addr_, port_);
+    auto hdl = scrb->hdl();
+    parent()->add_scribe(std::move(scrb));
+    return doorman::new_connection(&dm, hdl);
+  }
+
+  std::string addr() const override {
+    return addr_;
+  }
+
+  uint16_t port() const override {
+    return port_;
+  }
+
+private:
+  std::string addr_;
+  uint16_t port_;
+};
+
+#endif // BROKER_LINUX
+
+caf::expected<caf::io::scribe_ptr> connect_shm(default_multiplexer& mpx,
+                                               const std::string& host,
+                                               uint16_t port) {
+#ifdef BROKER_LINUX
+  sockaddr_un addr;
+  socklen_t len;
+  if (!shm_sockaddr(host, port, addr, len))
+    return caf::make_error(caf::sec::invalid_argument, host);
+  auto sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd == -1)
+    return caf::make_error(caf::sec::cannot_connect_to_node, host, port);
+  // The accepting side sends the segment right away. Do not wait forever
+  // for a misbehaving process, though.
+  timeval tout{10, 0};
+  setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tout, sizeof(tout));
+  if (::connect(sockfd, reinterpret_cast<sockaddr*>(&addr), len) != 0) {
+    ::close(sockfd);
+    return caf::make_error(caf::sec::cannot_connect_to_node, host, port);
+  }
+  // Another user may have taken the name before the endpoint we are looking
+  // for.
+  if (!same_user(sockfd)) {
+    ::close(sockfd);
+    return caf::make_error(caf::sec::cannot_connect_to_node, host, port);
+  }
+  auto fd = receive_segment(sockfd);
+  if (fd == -1) {
+    ::close(sockfd);
+    return caf::make_error(caf::sec::cannot_connect_to_node, host, port);
+  }
+  shm_segment segment{fd};
+  ::close(fd);
+  if (!segment) {
+    ::close(sockfd);
+    return caf::make_error(caf::sec::cannot_connect_to_node, host, port);
+  }
+  caf::io::network::nonblocking(sockfd, true);
+  caf::io::scribe_ptr result
+    = caf::make_counted<shm_scribe>(mpx, sockfd, std::move(segment), false,
+                                    host, port);
+  return result;
+#else
+  return caf::make_error(caf::sec::unsupported_operation, host);
+#endif
+}
+
+caf::expected<caf::io::doorman_ptr> open_shm(default_multiplexer& mpx,
+                                             const std::string& host,
+                                             uint16_t port) {
+#ifdef BROKER_LINUX
+  sockaddr_un addr;
+  socklen_t len;
+  if (port == 0 || !shm_sockaddr(host, port, addr, len))
+    return caf::make_error(caf::sec::invalid_argument, host, port);
+  auto sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd == -1)
+    return caf::make_error(caf::sec::cannot_open_port, host, port);
+  if (::bind(sockfd, reinterpret_cast<sockaddr*>(&addr), len) != 0
+      || ::listen(sockfd, SOMAXCONN) != 0) {
+    ::close(sockfd);
+    return caf::make_error(caf::sec::cannot_open_port, host, port);
+  }
+  caf::io::network::nonblocking(sockfd, true);
+  caf::io::doorman_ptr result
+    = caf::make_counted<shm_doorman>(mpx, sockfd, host, port);
+  return result;
+#else
+  return caf::make_error(caf::sec::unsupported_operation, host);
+#endif
+}
+
+// -- middleman ----------------------------------------------------------------
+
+/// Connects to and publishes at `unix://` and `shm://` addresses. Everything
+/// else works exactly like the default middleman actor.
+class local_middleman_actor : public caf::io::middleman_actor_impl {
+public:
+  using super = caf::io::middleman_actor_impl;
+
+  local_middleman_actor(caf::actor_config& cfg, caf::actor default_broker)
+    : super(cfg, std::move(default_broker)) {
+    // nop
+  }
+
+  const char* name() const override {
+    return "local_middleman_actor";
+  }
+
+protected:
+  caf::expected<caf::io::scribe_ptr> connect(const std::string& host,
+                                             uint16_t port) override {
+    if (is_unix_address(host))
+      return connect_unix(multiplexer(), host);
+    if (is_shm_address(host))
+      return connect_shm(multiplexer(), host, port);
+    return caf::make_error(caf::sec::invalid_argument, host);
+  }
+
+  caf::expected<caf::io::doorman_ptr>
+  open(uint16_t port, const char* in, bool) override {
+    std::string host = in != nullptr ? in : "";
+    if (is_unix_address(host))
+      return open_unix(multiplexer(), host);
+    if (is_shm_address(host))
+      return open_shm(multiplexer(), host, port);
+    return caf::make_error(caf::sec::invalid_argument, host);
+  }
+
+private:
+  default_multiplexer& multiplexer() {
+    return static_cast<default_multiplexer&>(system().middleman().backend());
+  }
+};
+
+} // namespace <anonymous>
+
+bool is_shm_address(const std::string& address) {
+  return address.compare(0, sizeof(shm_scheme) - 1, shm_scheme) == 0;
+}
+
+bool is_unix_address(const std::string& address) {
+  return address.compare(0, sizeof(unix_scheme) - 1, unix_scheme) == 0;
+}
+
+caf::actor local_middleman(caf::actor_system& sys) {
+  std::unique_lock<std::mutex> guard{local_middleman_mtx};
+  auto& reg = sys.registry();
+  if (auto ptr = reg.get(local_middleman_key))
+    return caf::actor_cast<caf::actor>(ptr);
+  // Share the BASP broker with the default middleman. BASP does not care
+  // which transport a connection uses.
+  auto basp = sys.middleman().named_broker<caf::io::basp_broker>(
+    caf::atom("BASP"));
+  auto hdl = caf::actor_cast<caf::actor>(
+    sys.spawn<local_middleman_actor, caf::detached + caf::hidden>(
+      std::move(basp)));
+  reg.put(local_middleman_key, caf::actor_cast<caf::strong_actor_ptr>(hdl));
+  return hdl;
+}
+
+void shutdown_local_middleman(caf::actor_system& sys) {
+  std::unique_lock<std::mutex> guard{local_middleman_mtx};
+  auto& reg = sys.registry();
+  if (auto ptr = reg.get(local_middleman_key)) {
+    caf::anon_send_exit(caf::actor_cast<caf::actor>(ptr),
+                        caf::exit_reason::user_shutdown);
+    reg.erase(local_middleman_key);
+  }
+}
+
+} // namespace detail
+} // namespace broker
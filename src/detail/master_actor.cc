@@ -1,5 +1,10 @@
 #include "broker/logger.hh" // Needs to come before CAF includes.
 
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
 #include <caf/event_based_actor.hpp>
 #include <caf/actor.hpp>
 #include <caf/make_message.hpp>
@@ -13,6 +18,8 @@
 #include "broker/atoms.hh"
 #include "broker/convert.hh"
 #include "broker/data.hh"
+#include "broker/defaults.hh"
+#include "broker/snapshot.hh"
 #include "broker/store.hh"
 #include "broker/time.hh"
 #include "broker/topic.hh"
@@ -29,9 +36,59 @@ static inline optional<timestamp> to_opt_timestamp(timestamp ts,
   return span ? ts + *span : optional<timestamp>();
 }
 
+namespace {
+
+/// State of a stream that sends a snapshot to a clone.
+struct snapshot_stream_state {
+  snapshot_cursor* cursor = nullptr;
+  std::vector<snapshot_entry> buf;
+  bool at_end = false;
+};
+
+} // namespace <anonymous>
+
+detachable_cursor::detachable_cursor(snapshot_cursor_ptr src)
+  : src_(std::move(src)),
+    pos_(0) {
+  // nop
+}
+
+expected<bool> detachable_cursor::next(std::vector<snapshot_entry>& xs,
+                                       size_t n) {
+  if (src_)
+    return src_->next(xs, n);
+  for (; n > 0 && pos_ < buf_.size(); --n)
+    xs.emplace_back(std::move(buf_[pos_++]));
+  return pos_ < buf_.size();
+}
+
+expected<void> detachable_cursor::detach() {
+  if (!src_)
+    return {};
+  for (;;) {
+    auto more = src_->next(buf_, 1024);
+    if (!more)
+      return more.error();
+    if (!*more)
+      break;
+  }
+  src_.reset();
+  return {};
+}
+
 const char* master_state::name = "master_actor";
 
-master_state::master_state() : self(nullptr), clock(nullptr) {
+master_state::master_state()
+  : self(nullptr),
+    seq(0),
+    command_log_size(0),
+    group_commit_size(0),
+    group_commit_interval(0),
+    group_commit_open(false),
+    group_commit_pending(0),
+    max_pending_updates(0),
+    expiry_interval(0),
+    clock(nullptr) {
   // nop
 }
 
@@ -45,17 +102,23 @@ void master_state::init(caf::event_based_actor* ptr, std::string&& nm,
   backend = std::move(bp);
   core = std::move(parent);
   clock = ep_clock;
+  auto& cfg = self->system().config();
+  command_log_size = get_or(cfg, "broker.command-log-size",
+                            defaults::command_log_size);
+  group_commit_size = get_or(cfg, "broker.group-commit-size",
+                             defaults::group_commit_size);
+  group_commit_interval = get_or(cfg, "broker.group-commit-interval",
+                                 defaults::group_commit_interval);
+  expiry_interval = get_or(cfg, "broker.expiry-interval",
+                           defaults::expiry_interval);
+  max_pending_updates = get_or(cfg, "broker.snapshot-pending-updates",
+                               defaults::snapshot_pending_updates);
   auto es = backend->expiries();
   if (!es)
     die("failed to get master expiries while initializing");
-  for (auto& e : *es) {
-    auto& key = e.first;
-    auto& expire_time = e.second;
-    auto n = clock->now();
-    auto dur = expire_time - n;
-    auto msg = caf::make_message(atom::expire::value, std::move(key));
-    clock->send_later(self, dur, std::move(msg));
-  }
+  for (auto& e : *es)
+    expiries.add(e.first, e.second);
+  schedule_tick();
 }
 
 void master_state::broadcast(internal_command&& x) {
@@ -63,21 +126,89 @@ void master_state::broadcast(internal_command&& x) {
              make_command_message(clones_topic, std::move(x)));
 }
 
-void master_state::remind(timespan expiry, const data& key) {
-  auto msg = caf::make_message(atom::expire::value, key);
-  clock->send_later(self, expiry, std::move(msg));
+void master_state::publish_update(internal_command&& x) {
+  x.seq = ++seq;
+  if (command_log_size > 0) {
+    if (command_log.size() >= command_log_size)
+      command_log.pop_front();
+    command_log.emplace_back(x);
+  }
+  // Clones that lost their connection to us ask for the missed updates later.
+  if (!clones.empty())
+    broadcast(std::move(x));
+}
+
+bool master_state::send_missed_updates(const caf::actor& clone,
+                                       uint64_t last_seq) {
+  if (last_seq > seq)
+    return false;
+  std::vector<internal_command> xs;
+  if (last_seq < seq) {
+    // The log always holds a gapless sequence ending at `seq`.
+    if (command_log.empty() || command_log.front().seq > last_seq + 1)
+      return false;
+    auto first = command_log.begin() + (last_seq + 1 - command_log.front().seq);
+    xs.assign(first, command_log.end());
+  }
+  BROKER_INFO("RESYNC clone with" << xs.size() << "updates");
+  self->send(clone, atom::update::value, std::move(xs));
+  return true;
+}
+
+void master_state::remind(timestamp expiry, const data& key) {
+  expiries.add(key, expiry);
+  schedule_tick();
 }
 
-void master_state::expire(data& key) {
-  BROKER_INFO("EXPIRE" << key);
-  auto result = backend->expire(key, clock->now());
-  if (!result)
-    BROKER_ERROR("failed to expire key:" << to_string(result.error()));
-  else if (!*result)
-    BROKER_WARNING("ignoring stale expiration reminder");
-  else {
-    broadcast_cmd_to_clones(erase_command{std::move(key)});
+void master_state::schedule_tick() {
+  auto next = expiries.next();
+  if (!next)
+    return;
+  // Round up to the end of the time slice, so that all keys that expire
+  // within the same slice share one tick.
+  auto t = *next;
+  if (expiry_interval.count() > 0) {
+    auto rem = t.time_since_epoch() % expiry_interval;
+    if (rem.count() > 0)
+      t += expiry_interval - rem;
   }
+  if (next_tick && *next_tick <= t)
+    return;
+  next_tick = t;
+  auto msg = caf::make_message(atom::tick::value, t);
+  clock->send_later(self, t - clock->now(), std::move(msg));
+}
+
+void master_state::tick(timestamp t) {
+  // Rescheduling to an earlier time slice leaves the previous tick behind.
+  if (!next_tick || *next_tick != t)
+    return;
+  next_tick = nil;
+  auto now = clock->now();
+  expire(expiries.take_due(now), now);
+  schedule_tick();
+}
+
+void master_state::expire(std::vector<data> keys, timestamp now) {
+  if (keys.empty())
+    return;
+  if (holds_back_updates()) {
+    pending_expiries.insert(pending_expiries.end(),
+                            std::make_move_iterator(keys.begin()),
+                            std::make_move_iterator(keys.end()));
+    limit_pending_updates();
+    return;
+  }
+  BROKER_INFO("EXPIRE" << keys.size() << "keys");
+  begin_update();
+  auto result = backend->bulk_expire(keys, now);
+  if (!result) {
+    BROKER_ERROR("failed to expire keys:" << to_string(result.error()));
+  } else {
+    for (auto& key : *result)
+      broadcast_cmd_to_clones(erase_command{std::move(key)});
+  }
+  end_update();
 }
 
 void master_state::command(internal_command& cmd) {
@@ -85,7 +216,99 @@ void master_state::command(internal_command& cmd) {
 }
 
 void master_state::command(internal_command::variant_type& cmd) {
+  if (!caf::holds_alternative<snapshot_command>(cmd)
+      && holds_back_updates()) {
+    pending_commands.emplace_back(std::move(cmd));
+    limit_pending_updates();
+    return;
+  }
+  begin_update();
   caf::visit(*this, cmd);
+  end_update();
+}
+
+void master_state::begin_update() {
+  if (group_commit_size == 0 || group_commit_open)
+    return;
+  if (auto res = backend->begin_transaction(); !res) {
+    BROKER_WARNING("failed to begin transaction:" << to_string(res.error()));
+    return;
+  }
+  group_commit_open = true;
+  group_commit_start = std::chrono::steady_clock::now();
+  // Commands that are already in our mailbox, e.g., the remainder of the
+  // current batch from the core, join the transaction. The flush arrives
+  // after them.
+  self->send(self, atom::flush::value);
+}
+
+void master_state::end_update() {
+  if (!group_commit_open)
+    return;
+  if (++group_commit_pending >= group_commit_size
+      || std::chrono::steady_clock::now() - group_commit_start
+           >= group_commit_interval)
+    commit_updates();
+}
+
+void master_state::commit_updates() {
+  if (!group_commit_open)
+    return;
+  group_commit_open = false;
+  group_commit_pending = 0;
+  if (auto res = backend->commit_transaction(); !res)
+    BROKER_ERROR("failed to commit transaction:" << to_string(res.error()));
+}
+
+void master_state::finish_snapshot(snapshot_cursor* cursor) {
+  auto i = std::find_if(snapshot_cursors.begin(), snapshot_cursors.end(),
+                        [=](const snapshot_cursor_ptr& ptr) {
+                          return ptr.get() == cursor;
+                        });
+  if (i == snapshot_cursors.end())
+    return;
+  snapshot_cursors.erase(i);
+  if (!holds_back_updates())
+    apply_pending_updates();
+}
+
+bool master_state::holds_back_updates() const {
+  if (backend->cursor_is_isolated())
+    return false;
+  return std::any_of(snapshot_cursors.begin(), snapshot_cursors.end(),
+                     [](const std::unique_ptr<detachable_cursor>& ptr) {
+                       return !ptr->detached();
+                     });
+}
+
+void master_state::limit_pending_updates() {
+  if (pending_commands.size() + pending_expiries.size() < max_pending_updates)
+    return;
+  detach_snapshots();
+}
+
+void master_state::settle_updates() {
+  if (pending_commands.empty() && pending_expiries.empty())
+    return;
+  detach_snapshots();
+}
+
+void master_state::detach_snapshots() {
+  BROKER_INFO("DETACH" << snapshot_cursors.size() << "snapshots");
+  for (auto& ptr : snapshot_cursors)
+    if (!ptr->detach())
+      die("failed to snapshot master");
+  apply_pending_updates();
+}
+
+void master_state::apply_pending_updates() {
+  auto cmds = std::move(pending_commands);
+  pending_commands.clear();
+  auto keys = std::move(pending_expiries);
+  pending_expiries.clear();
+  for (auto& cmd : cmds)
+    command(cmd);
+  expire(std::move(keys), clock->now());
 }
 
 void master_state::operator()(none) {
@@ -100,8 +323,10 @@ void master_state::operator()(put_command& x) {
     BROKER_WARNING("failed to put" << x.key << "->" << x.value);
     return; // TODO: propagate failure? to all clones? as status msg?
   }
-  if (x.expiry)
-    remind(*x.expiry, x.key);
+  if (et)
+    remind(*et, x.key);
+  else
+    expiries.erase(x.key);
   broadcast_cmd_to_clones(std::move(x));
 }
 
@@ -131,8 +356,10 @@ void master_state::operator()(put_unique_command& x) {
     return; // TODO: propagate failure? to all clones? as status msg?
   }
 
-  if (x.expiry)
-    remind(*x.expiry, x.key);
+  if (et)
+    remind(*et, x.key);
+  else
+    expiries.erase(x.key);
 
   // Note that we could just broadcast a regular "put" command here instead
   // since clones shouldn't have to do their own existence check.
@@ -146,6 +373,7 @@ void master_state::operator()(erase_command& x) {
     BROKER_WARNING("failed to erase" << x.key);
     return; // TODO: propagate failure? to all clones? as status msg?
   }
+  expiries.erase(x.key);
   broadcast_cmd_to_clones(std::move(x));
 }
 
@@ -157,8 +385,10 @@ void master_state::operator()(add_command& x) {
     BROKER_WARNING("failed to add" << x.value << "to" << x.key);
     return; // TODO: propagate failure? to all clones? as status msg?
   }
-  if (x.expiry)
-    remind(*x.expiry, x.key);
+  if (et)
+    remind(*et, x.key);
+  else
+    expiries.erase(x.key);
   broadcast_cmd_to_clones(std::move(x));
 }
 
@@ -170,8 +400,10 @@ void master_state::operator()(subtract_command& x) {
     BROKER_WARNING("failed to substract" << x.value << "from" << x.key);
     return; // TODO: propagate failure? to all clones? as status msg?
   }
-  if (x.expiry)
-    remind(*x.expiry, x.key);
+  if (et)
+    remind(*et, x.key);
+  else
+    expiries.erase(x.key);
   broadcast_cmd_to_clones(std::move(x));
 }
 
@@ -181,31 +413,60 @@ void master_state::operator()(snapshot_command& x) {
     BROKER_INFO("snapshot command with invalid address received");
     return;
   }
-  auto ss = backend->snapshot();
-  if (!ss)
-    die("failed to snapshot master");
   self->monitor(x.remote_core);
   clones.emplace(x.remote_core->address(), x.remote_clone);
 
   // The snapshot gets sent over a different channel than updates,
   // so we send a "sync" point over the update channel that target clone
   // can use in order to apply any updates that arrived before it
-  // received the now-outdated snapshot.
-  broadcast_cmd_to_clones(snapshot_sync_command{x.remote_clone});
-
-  // TODO: possible improvements to do here
-  // (1) Use a separate *streaming* channel to send the snapshot.
-  //     A benefit of that would potentially be less latent queries
-  //     that go directly against the master store.
-  // (2) Always keep an updated snapshot in memory on the master to
-  //     avoid numerous expensive retrievals from persistent backends
-  //     in quick succession (e.g. at startup).
-  // (3) As an alternative to (2), give backends an API to stream
-  //     key-value pairs without ever needing the full snapshot in
-  //     memory.  Note that this would require halting the application
-  //     of updates on the master while there are any snapshot streams
-  //     still underway.
-  self->send(x.remote_clone, set_command{std::move(*ss)});
+  // received the now-outdated snapshot. The sync point is no update and
+  // thus carries no sequence number.
+  broadcast(internal_command{snapshot_sync_command{x.remote_clone}});
+
+  // A clone that reconnects after a short disruption only needs the updates
+  // it has missed, as long as the command log still contains them.
+  if (x.last_seq > 0 && send_missed_updates(x.remote_clone, x.last_seq))
+    return;
+  auto cursor = backend->cursor();
+  if (!cursor)
+    die("failed to snapshot master");
+
+  // Stream the snapshot in chunks instead of sending the entire store as a
+  // single message. The clone grants credit for the chunks and the cursor
+  // only reads as many key-value pairs from the backend as the clone can
+  // take. Unless the backend has isolated cursors, the cursor reads from the
+  // live backend and `command` holds back all updates until the stream is
+  // done or until too many updates pile up and the master detaches the
+  // cursor. Either way, updates reach the clone after the sync point, i.e.,
+  // the clone applies them after the snapshot.
+  snapshot_cursors.emplace_back(
+    std::make_unique<detachable_cursor>(std::move(*cursor)));
+  auto ptr = snapshot_cursors.back().get();
+  self->make_source(
+    x.remote_clone,
+    // The clone resumes at this sequence number after the snapshot.
+    std::make_tuple(seq),
+    [ptr](snapshot_stream_state& st) {
+      st.cursor = ptr;
+    },
+    [](snapshot_stream_state& st, caf::downstream<snapshot_entry>& out,
+       size_t num) {
+      auto more = st.cursor->next(st.buf, num);
+      if (!more)
+        die("failed to snapshot master");
+      st.at_end = !*more;
+      for (auto& kvp : st.buf)
+        out.push(std::move(kvp));
+      st.buf.clear();
+    },
+    [](const snapshot_stream_state& st) {
+      return st.at_end;
+    },
+    [this, ptr](snapshot_stream_state&, const caf::error& err) {
+      if (err)
+        BROKER_WARNING("snapshot stream to clone failed:" << to_string(err));
+      finish_snapshot(ptr);
+    });
 }
 
 void master_state::operator()(snapshot_sync_command&) {
@@ -221,6 +482,7 @@ void master_state::operator()(clear_command& x) {
   auto res = backend->clear();
   if (!res)
     die("failed to clear master");
+  expiries.clear();
   broadcast_cmd_to_clones(std::move(x));
 }
 
@@ -249,17 +511,23 @@ caf::behavior master_actor(caf::stateful_actor<master_state>* self,
       self->state.command(x);
     },
     [=](atom::sync_point, caf::actor& who) {
+      self->state.settle_updates();
       self->send(who, atom::sync_point::value);
     },
-    [=](atom::expire, data& key) {
-      self->state.expire(key);
+    [=](atom::tick, timestamp t) {
+      self->state.tick(t);
+    },
+    [=](atom::flush) {
+      self->state.commit_updates();
     },
     [=](atom::get, atom::keys) -> expected<data> {
+      self->state.settle_updates();
       auto x = self->state.backend->keys();
       BROKER_INFO("KEYS ->" << x);
       return x;
     },
     [=](atom::get, atom::keys, request_id id) {
+      self->state.settle_updates();
       auto x = self->state.backend->keys();
       BROKER_INFO("KEYS" << "with id:" << id << "->" << x);
       if (x)
@@ -267,26 +535,31 @@ caf::behavior master_actor(caf::stateful_actor<master_state>* self,
       return caf::make_message(std::move(x.error()), id);
     },
     [=](atom::exists, const data& key) -> expected<data> {
+      self->state.settle_updates();
       auto x = self->state.backend->exists(key);
       BROKER_INFO("EXISTS" << key << "->" << x);
       return {data{std::move(*x)}};
     },
     [=](atom::exists, const data& key, request_id id) {
+      self->state.settle_updates();
       auto x = self->state.backend->exists(key);
       BROKER_INFO("EXISTS" << key << "with id:" << id << "->" << x);
       return caf::make_message(data{std::move(*x)}, id);
     },
     [=](atom::get, const data& key) -> expected<data> {
+      self->state.settle_updates();
       auto x = self->state.backend->get(key);
       BROKER_INFO("GET" << key << "->" << x);
       return x;
     },
     [=](atom::get, const data& key, const data& aspect) -> expected<data> {
+      self->state.settle_updates();
       auto x = self->state.backend->get(key, aspect);
       BROKER_INFO("GET" << key << aspect << "->" << x);
       return x;
     },
     [=](atom::get, const data& key, request_id id) {
+      self->state.settle_updates();
       auto x = self->state.backend->get(key);
       BROKER_INFO("GET" << key << "with id:" << id << "->" << x);
       if (x)
@@ -294,6 +567,7 @@ caf::behavior master_actor(caf::stateful_actor<master_state>* self,
       return caf::make_message(std::move(x.error()), id);
     },
     [=](atom::get, const data& key, const data& value, request_id id) {
+      self->state.settle_updates();
       auto x = self->state.backend->get(key, value);
       BROKER_INFO("GET" << key << "->" << value << "with id:" << id << "->" << x);
       if (x)
@@ -1,5 +1,6 @@
 #include <set>
 #include <cstdint>
+#include <memory>
 #include <utility>
 
 #include "broker/detail/appliers.hh"
@@ -8,27 +9,53 @@
 namespace broker {
 namespace detail {
 
+namespace {
+
+class memory_cursor : public snapshot_cursor {
+public:
+  using map_ptr = std::shared_ptr<const memory_backend::map_type>;
+
+  memory_cursor(map_ptr store)
+    : store_(std::move(store)),
+      pos_(store_->begin()) {
+    // nop
+  }
+
+  expected<bool> next(std::vector<snapshot_entry>& xs, size_t n) override {
+    for (; n > 0 && pos_ != store_->end(); --n, ++pos_)
+      xs.emplace_back(pos_->first, pos_->second.first);
+    return pos_ != store_->end();
+  }
+
+private:
+  map_ptr store_;
+  memory_backend::map_type::const_iterator pos_;
+};
+
+} // namespace <anonymous>
 
 memory_backend::memory_backend(backend_options opts)
-  : options_{std::move(opts)} {
+  : options_{std::move(opts)},
+    store_(std::make_shared<map_type>()) {
   // nop
 }
 
 expected<void>
 memory_backend::put(const data& key, data value, optional<timestamp> expiry) {
-  store_[key] = {std::move(value), std::move(expiry)};
+  mutable_store()[key] = {std::move(value), std::move(expiry)};
   return {};
 }
 
 expected<void> memory_backend::add(const data& key, const data& value,
 								   data::type init_type,
                                    optional<timestamp> expiry) {
-  auto i = store_.find(key);
-  if (i == store_.end()) {
+  auto& store = mutable_store();
+  auto i = store.find(key);
+  if (i == store.end()) {
     if (init_type == data::type::none)
       return ec::type_clash;
     auto newv = std::make_pair(data::from_type(init_type), expiry);
-    i = store_.emplace(std::move(key), std::move(newv)).first;
+    i = store.emplace(std::move(key), std::move(newv)).first;
   }
   auto result = caf::visit(adder{value}, i->second.first);
   if (result)
@@ -38,9 +65,10 @@ expected<void> memory_backend::add(const data& key, const data& value,
 
 expected<void> memory_backend::subtract(const data& key, const data& value,
                                         optional<timestamp> expiry) {
-  auto i = store_.find(key);
-  if (i == store_.end())
+  if (store_->count(key) == 0)
     return ec::no_such_key;
+  auto& store = mutable_store();
+  auto i = store.find(key);
   auto result = caf::visit(remover{value}, i->second.first);
   if (result)
     i->second.second = std::move(expiry);
@@ -48,42 +76,47 @@ expected<void> memory_backend::subtract(const data& key, const data& value,
 }
 
 expected<void> memory_backend::erase(const data& key) {
-  store_.erase(key);
+  if (store_->count(key) == 1)
+    mutable_store().erase(key);
   return {};
 }
 
 expected<void> memory_backend::clear() {
-   store_.clear();
-   return {};
+  // Leave the old map to the cursors instead of copying it.
+  if (store_.use_count() > 1)
+    store_ = std::make_shared<map_type>();
+  else
+    store_->clear();
+  return {};
 }
 
 expected<bool> memory_backend::expire(const data& key, timestamp ts) {
-  auto i = store_.find(key);
-  if (i == store_.end())
+  auto i = store_->find(key);
+  if (i == store_->end())
     return ec::no_such_key;
   if (!i->second.second || ts < i->second.second)
     return false;
-  store_.erase(i);
+  mutable_store().erase(key);
   return true;
 }
 
 expected<data> memory_backend::get(const data& key) const {
-  auto i = store_.find(key);
-  if (i == store_.end())
+  auto i = store_->find(key);
+  if (i == store_->end())
     return ec::no_such_key;
   return i->second.first;
 }
 
 expected<data> memory_backend::keys() const {
   set keys;
-  for ( auto i = store_.begin(); i != store_.end(); i++ )
+  for ( auto i = store_->begin(); i != store_->end(); i++ )
     keys.insert(i->first);
   return expected<data>(std::move(keys));
 }
 
 expected<data> memory_backend::get(const data& key, const data& value) const {
-  auto i = store_.find(key);
-  if (i == store_.end())
+  auto i = store_->find(key);
+  if (i == store_->end())
     return ec::no_such_key;
   // We do not use the default implementation because operating directly on the
   // stored data element is more efficient in case the visitation returns an
@@ -92,24 +125,33 @@ expected<data> memory_backend::get(const data& key, const data& value) const {
 }
 
 expected<bool> memory_backend::exists(const data& key) const {
-  return store_.count(key) == 1;
+  return store_->count(key) == 1;
 }
 
 expected<uint64_t> memory_backend::size() const {
-  return store_.size();
+  return store_->size();
 }
 
 expected<snapshot> memory_backend::snapshot() const {
   broker::snapshot ss;
-  for (auto& p : store_)
+  for (auto& p : *store_)
     ss.emplace(p.first, p.second.first);
   return {std::move(ss)};
 }
 
+expected<snapshot_cursor_ptr> memory_backend::cursor() const {
+  return {std::make_unique<memory_cursor>(store_)};
+}
+
+bool memory_backend::cursor_is_isolated() const {
+  // Cursors keep the map alive and modifications copy it.
+  return true;
+}
+
 expected<expirables> memory_backend::expiries() const {
   expirables rval;
 
-  for (auto& p : store_) {
+  for (auto& p : *store_) {
     if (p.second.second)
       rval.emplace_back(expirable(p.first, *p.second.second));
   }
@@ -117,5 +159,11 @@ expected<expirables> memory_backend::expiries() const {
   return {std::move(rval)};
 }
 
+memory_backend::map_type& memory_backend::mutable_store() {
+  if (store_.use_count() > 1)
+    store_ = std::make_shared<map_type>(*store_);
+  return *store_;
+}
+
 } // namespace detail
 } // namespace broker
@@ -2,6 +2,8 @@
 
 #include "broker/logger.hh"
 
+#include "broker/detail/local_transport.hh"
+
 namespace broker {
 namespace detail {
 
@@ -60,5 +62,14 @@ void network_cache::remove(const network_info& x) {
   hdls_.erase(i);
 }
 
+caf::actor network_cache::middleman_for(const network_info& x) {
+  auto& sys = self->home_system();
+  if (is_local_address(x.address))
+    return local_middleman(sys);
+  if (use_ssl)
+    return caf::actor_cast<caf::actor>(sys.openssl_manager().actor_handle());
+  return caf::actor_cast<caf::actor>(sys.middleman().actor_handle());
+}
+
 } // namespace detail
 } // namespace broker
@@ -0,0 +1,180 @@
+#include "broker/detail/payload_buffer.hh"
+
+#include <algorithm>
+#include <cstdint>
+
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+#include <caf/deserializer.hpp>
+#include <caf/make_counted.hpp>
+#include <caf/sec.hpp>
+#include <caf/serializer.hpp>
+
+#include "broker/detail/data_codec.hh"
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+constexpr size_t size_prefix = 4;
+
+/// Number of bytes that `read_payload` allocates at once for sources that
+/// cannot tell how many bytes remain.
+constexpr size_t read_chunk_size = 64 * 1024;
+
+bool decode(payload_format format, const char* buf, size_t size,
+            data& result) {
+  if (format == payload_format::compact)
+    return compact_decode(buf, size, result);
+  caf::binary_deserializer source{nullptr, buf, size};
+  if (auto err = source(result))
+    return false;
+  return source.remaining() == 0;
+}
+
+bool unpack(const payload_buffer& x, std::vector<char>& result) {
+  auto& bytes = x.bytes();
+  if (bytes.size() < size_prefix)
+    return false;
+  return decompress(x.compression(), bytes.data() + size_prefix,
+                    bytes.size() - size_prefix, x.raw_size(), result);
+}
+
+} // namespace
+
+payload_buffer::payload_buffer(std::vector<char> bytes, payload_format format,
+                               compression_method compression)
+  : bytes_(std::move(bytes)), format_(format), compression_(compression) {
+  // nop
+}
+
+size_t payload_buffer::raw_size() const noexcept {
+  if (compression_ == compression_method::none || size() < size_prefix)
+    return size();
+  size_t result = 0;
+  for (size_t i = 0; i < size_prefix; ++i) {
+    auto byte = static_cast<uint8_t>(bytes_[i]);
+    result |= static_cast<size_t>(byte) << (i * 8);
+  }
+  return result;
+}
+
+payload_buffer_ptr make_payload_buffer(const data& x, payload_format format) {
+  std::vector<char> buf;
+  if (format == payload_format::compact) {
+    compact_encode(x, buf);
+  } else {
+    caf::binary_serializer sink{nullptr, buf};
+    // Serializers never modify their input.
+    if (auto err = sink(const_cast<data&>(x)))
+      return nullptr;
+  }
+  return caf::make_counted<payload_buffer>(std::move(buf), format);
+}
+
+bool decode_payload(const payload_buffer& x, data& result) {
+  if (x.compression() == compression_method::none)
+    return decode(x.format(), x.bytes().data(), x.size(), result);
+  std::vector<char> buf;
+  if (!unpack(x, buf))
+    return false;
+  return decode(x.format(), buf.data(), buf.size(), result);
+}
+
+payload_buffer_ptr convert_payload(const payload_buffer& x,
+                                   payload_format format) {
+  if (x.compression() != compression_method::none) {
+    auto ptr = decompress_payload(x);
+    if (ptr == nullptr || ptr->format() == format)
+      return ptr;
+    return convert_payload(*ptr, format);
+  }
+  data tmp;
+  if (!decode_payload(x, tmp))
+    return nullptr;
+  return make_payload_buffer(tmp, format);
+}
+
+payload_buffer_ptr compress_payload(const payload_buffer& x,
+                                    compression_method method) {
+  if (x.compression() != compression_method::none
+      || !compression_available(method) || x.size() > UINT32_MAX)
+    return nullptr;
+  std::vector<char> buf;
+  auto raw_size = x.size();
+  for (size_t i = 0; i < size_prefix; ++i)
+    buf.push_back(static_cast<char>(raw_size >> (i * 8)));
+  if (!compress(method, x.bytes().data(), x.size(), buf))
+    return nullptr;
+  return caf::make_counted<payload_buffer>(std::move(buf), x.format(),
+                                           method);
+}
+
+payload_buffer_ptr decompress_payload(const payload_buffer& x) {
+  std::vector<char> buf;
+  if (!unpack(x, buf))
+    return nullptr;
+  return caf::make_counted<payload_buffer>(std::move(buf), x.format());
+}
+
+caf::error write_payload(caf::serializer& sink, const payload_buffer& x) {
+  auto size = x.size();
+  // The lower four bits store the format, the upper four the compression.
+  auto header = static_cast<uint8_t>(static_cast<uint8_t>(x.format())
+                                     | static_cast<uint8_t>(x.compression())
+                                         << 4);
+  if (auto err = sink.begin_sequence(size + 1))
+    return err;
+  if (auto err = sink(header))
+    return err;
+  if (size > 0)
+    if (auto err = sink.apply_raw(size, const_cast<char*>(x.bytes().data())))
+      return err;
+  return sink.end_sequence();
+}
+
+caf::error read_payload(caf::deserializer& source, payload_buffer_ptr& x) {
+  size_t size = 0;
+  if (auto err = source.begin_sequence(size))
+    return err;
+  // Each payload starts with a header byte.
+  uint8_t header = 0;
+  if (size == 0)
+    return caf::sec::invalid_argument;
+  if (auto err = source(header))
+    return err;
+  auto format = header & 0x0F;
+  auto compression = header >> 4;
+  if (format >= num_payload_formats || compression >= num_compression_methods)
+    return caf::sec::invalid_argument;
+  --size;
+  // The size comes straight off the wire. Never allocate more memory than
+  // the source can actually fill.
+  std::vector<char> buf;
+  if (auto bd = dynamic_cast<caf::binary_deserializer*>(&source)) {
+    if (size > bd->remaining())
+      return caf::sec::end_of_stream;
+    buf.resize(size);
+    if (size > 0)
+      if (auto err = source.apply_raw(size, buf.data()))
+        return err;
+  } else {
+    while (buf.size() < size) {
+      auto offset = buf.size();
+      auto n = std::min(size - offset, read_chunk_size);
+      buf.resize(offset + n);
+      if (auto err = source.apply_raw(n, buf.data() + offset))
+        return err;
+    }
+  }
+  if (auto err = source.end_sequence())
+    return err;
+  x = caf::make_counted<payload_buffer>(
+    std::move(buf), static_cast<payload_format>(format),
+    static_cast<compression_method>(compression));
+  return caf::none;
+}
+
+} // namespace detail
+} // namespace broker
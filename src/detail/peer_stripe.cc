@@ -0,0 +1,52 @@
+#include "broker/detail/peer_stripe.hh"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <caf/io/middleman.hpp>
+#include <caf/openssl/publish.hpp>
+
+#include "broker/core_actor.hh"
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+/// A stripe only runs its core shard and the middleman actor on the
+/// scheduler. The multiplexer of the middleman has a thread of its own.
+constexpr size_t stripe_max_threads = 2;
+
+configuration make_stripe_config(const configuration& parent) {
+  configuration result{parent.options()};
+  for (auto key : {"broker", "openssl", "scheduler"}) {
+    auto i = parent.content.find(key);
+    if (i != parent.content.end())
+      result.content[key] = i->second;
+  }
+  auto max_threads = get_or(parent, "scheduler.max-threads",
+                            stripe_max_threads);
+  result.set("scheduler.max-threads",
+             std::min(max_threads, stripe_max_threads));
+  return result;
+}
+
+} // namespace <anonymous>
+
+peer_stripe::peer_stripe(const configuration& parent, endpoint::clock* clock,
+                         caf::actor primary)
+  : config_(make_stripe_config(parent)),
+    system_(config_) {
+  core_ = system_.spawn(core_shard_actor, config_.options(), clock,
+                        std::move(primary));
+}
+
+expected<uint16_t> peer_stripe::listen(const std::string& address) {
+  auto addr = address.empty() ? nullptr : address.c_str();
+  if (config_.options().disable_ssl)
+    return system_.middleman().publish(core_, 0, addr, true);
+  return caf::openssl::publish(core_, 0, addr, true);
+}
+
+} // namespace detail
+} // namespace broker
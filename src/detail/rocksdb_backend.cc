@@ -1,5 +1,9 @@
+#include <rocksdb/cache.h>
 #include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/merge_operator.h>
 #include <rocksdb/options.h>
+#include <rocksdb/table.h>
 
 #include "broker/logger.hh"
 
@@ -42,6 +46,105 @@ data from_key_blob(const char* data, size_t size) {
   return from_blob<broker::data>(data + 1, size - 1);
 }
 
+// Applies `add` and `subtract` operations when RocksDB reads or compacts a
+// key. Each operand consists of a tag byte followed by the data blob of the
+// value. For `add`, the tag is the initial type for keys without a value. For
+// `subtract`, the tag is `subtract_tag`. Operands that fail to apply leave the
+// value unchanged, just like clones ignore failing updates. Corrupt values or
+// operands fail the merge, which makes RocksDB report a corruption.
+class adder_operator : public rocksdb::MergeOperator {
+public:
+  /// Tags `subtract` operands. No `data::type` uses this value.
+  static constexpr char subtract_tag = '\xff';
+
+  bool FullMergeV2(const MergeOperationInput& in,
+                   MergeOperationOutput* out) const override {
+    BROKER_ASSERT(!in.operand_list.empty());
+    broker::data v;
+    if (in.existing_value != nullptr) {
+      auto existing = from_data_blob(in.existing_value->data(),
+                                     in.existing_value->size());
+      if (!existing)
+        return false;
+      v = std::move(*existing);
+    } else if (!is_subtract(in.operand_list.front())) {
+      v = data::from_type(init_type(in.operand_list.front()));
+    }
+    for (auto& x : in.operand_list) {
+      auto value = from_data_blob(x.data() + 1, x.size() - 1);
+      if (!value)
+        return false;
+      if (is_subtract(x))
+        caf::visit(remover{*value}, v);
+      else
+        caf::visit(adder{*value}, v);
+    }
+    out->new_value = to_data_blob(v);
+    return true;
+  }
+
+  const char* Name() const override {
+    return "broker.adder";
+  }
+
+  static std::string make_operand(const data& value, data::type init_type) {
+    return make_operand(value, static_cast<char>(init_type));
+  }
+
+  static std::string make_subtract_operand(const data& value) {
+    return make_operand(value, subtract_tag);
+  }
+
+private:
+  static std::string make_operand(const data& value, char tag) {
+    auto result = to_data_blob(value);
+    result.insert(result.begin(), tag);
+    return result;
+  }
+
+  static bool is_subtract(const rocksdb::Slice& operand) {
+    BROKER_ASSERT(operand.size() > 1);
+    return operand[0] == subtract_tag;
+  }
+
+  static data::type init_type(const rocksdb::Slice& operand) {
+    BROKER_ASSERT(operand.size() > 1);
+    return static_cast<data::type>(operand[0]);
+  }
+};
+
+// Iterates over the data prefix. RocksDB iterators read from an implicit
+// snapshot of the database.
+class rocksdb_cursor : public snapshot_cursor {
+public:
+  rocksdb_cursor(std::unique_ptr<rocksdb::Iterator> i) : i_(std::move(i)) {
+    // nop
+  }
+
+  expected<bool> next(std::vector<snapshot_entry>& xs, size_t n) override {
+    static const auto pfx = static_cast<char>(prefix::data);
+    for (; n > 0 && i_->Valid() && i_->key()[0] == pfx; --n) {
+      auto key = from_key_blob<prefix::data>(i_->key().data(),
+                                             i_->key().size());
+      auto value = from_data_blob(i_->value().data(), i_->value().size());
+      if (!value) {
+        BROKER_ERROR("corrupt value in snapshot:" << key);
+        return value.error();
+      }
+      xs.emplace_back(std::move(key), std::move(*value));
+      i_->Next();
+    }
+    if (!i_->status().ok()) {
+      BROKER_ERROR("failed to read snapshot:" << i_->status().ToString());
+      return ec::backend_failure;
+    }
+    return i_->Valid() && i_->key()[0] == pfx;
+  }
+
+private:
+  std::unique_ptr<rocksdb::Iterator> i_;
+};
+
 } // namespace <anonymous>
 
 struct rocksdb_backend::impl {
@@ -63,13 +166,13 @@ struct rocksdb_backend::impl {
       return false;
     rocksdb::WriteBatch batch;
     batch.Put(key, value);
-    // Write expiry.
-    if (expiry) {
-      BROKER_ASSERT(key.size() > 1);
-      key[0] = static_cast<char>(prefix::expiry); // reuse key blob
-      auto blob = to_blob(*expiry);
-      batch.Put(key, blob);
-    }
+    // Write expiry or drop the expiry of a previous write.
+    BROKER_ASSERT(key.size() > 1);
+    key[0] = static_cast<char>(prefix::expiry); // reuse key blob
+    if (expiry)
+      batch.Put(key, to_blob(*expiry));
+    else
+      batch.Delete(key);
     auto status = db->Write({}, &batch);
     if (!status.ok()) {
       BROKER_ERROR("failed to put key-value pair:" << status.ToString());
@@ -78,6 +181,27 @@ struct rocksdb_backend::impl {
     return true;
   }
 
+  // Writes a merge operand for `key` and updates its expiry.
+  expected<void> merge(std::string& key, const std::string& operand,
+                       optional<timestamp> expiry) {
+    if (!db)
+      return ec::backend_failure;
+    rocksdb::WriteBatch batch;
+    batch.Merge(key, operand);
+    BROKER_ASSERT(key.size() > 1);
+    key[0] = static_cast<char>(prefix::expiry); // reuse key blob
+    if (expiry)
+      batch.Put(key, to_blob(*expiry));
+    else
+      batch.Delete(key);
+    auto status = db->Write({}, &batch);
+    if (!status.ok()) {
+      BROKER_ERROR("failed to merge value:" << status.ToString());
+      return ec::backend_failure;
+    }
+    return {};
+  }
+
   template <class Key>
   expected<std::string> get(const Key& key) {
     if (!db)
@@ -133,6 +257,7 @@ struct rocksdb_backend::impl {
   }
 
   rocksdb::DB* db = nullptr;
+  rocksdb::Options options;
   count exact_size_threshold = 10000;
   std::string path;
 };
@@ -155,6 +280,47 @@ rocksdb_backend::rocksdb_backend(backend_options opts)
     else
       BROKER_ERROR("exact-size-threshold must be of type count");
   }
+  // Parse tuning options.
+  auto get_count = [&](const char* name) -> optional<count> {
+    auto i = opts.find(name);
+    if (i == opts.end())
+      return nil;
+    if (auto x = caf::get_if<count>(&i->second))
+      return *x;
+    BROKER_ERROR(name << " must be of type count");
+    return nil;
+  };
+  auto& rocks_opts = impl_->options;
+  rocks_opts.create_if_missing = true;
+  rocks_opts.merge_operator = std::make_shared<adder_operator>();
+  rocksdb::BlockBasedTableOptions table_opts;
+  if (auto n = get_count("block-cache-size"))
+    table_opts.block_cache = rocksdb::NewLRUCache(*n);
+  if (auto n = get_count("bloom-filter-bits"))
+    table_opts.filter_policy.reset(
+      rocksdb::NewBloomFilterPolicy(static_cast<int>(*n), false));
+  rocks_opts.table_factory.reset(
+    rocksdb::NewBlockBasedTableFactory(table_opts));
+  if (auto n = get_count("write-buffer-size"))
+    rocks_opts.write_buffer_size = *n;
+  i = opts.find("compression");
+  if (i != opts.end()) {
+    auto method = caf::get_if<std::string>(&i->second);
+    if (!method)
+      BROKER_ERROR("compression must be of type string");
+    else if (*method == "none")
+      rocks_opts.compression = rocksdb::kNoCompression;
+    else if (*method == "snappy")
+      rocks_opts.compression = rocksdb::kSnappyCompression;
+    else if (*method == "zlib")
+      rocks_opts.compression = rocksdb::kZlibCompression;
+    else if (*method == "lz4")
+      rocks_opts.compression = rocksdb::kLZ4Compression;
+    else if (*method == "zstd")
+      rocks_opts.compression = rocksdb::kZSTD;
+    else
+      BROKER_ERROR("unknown compression method:" << *method);
+  }
 
   open_db();
 }
@@ -169,9 +335,8 @@ bool rocksdb_backend::open_db() {
     }
   }
 
-  rocksdb::Options rocks_opts;
-  rocks_opts.create_if_missing = true;
-  auto status = rocksdb::DB::Open(rocks_opts, impl_->path.c_str(), &impl_->db);
+  auto status = rocksdb::DB::Open(impl_->options, impl_->path.c_str(),
+                                  &impl_->db);
   if (!status.ok()) {
     BROKER_ERROR("failed to open DB:" << status.ToString());
     impl_->db = nullptr;
@@ -199,7 +364,7 @@ expected<void> rocksdb_backend::put(const data& key, data value,
   if (!impl_->db)
     return ec::backend_failure;
   auto key_blob = to_key_blob<prefix::data>(key);
-  auto value_blob = to_blob(value);
+  auto value_blob = to_data_blob(value);
   if (!impl_->put(key_blob, value_blob, expiry))
     return ec::backend_failure;
   return {};
@@ -208,38 +373,28 @@ expected<void> rocksdb_backend::put(const data& key, data value,
 expected<void> rocksdb_backend::add(const data& key, const data& value,
                                     data::type init_type,
                                     optional<timestamp> expiry) {
+  // Defer the update to the merge operator instead of reading the current
+  // value. This also defers type checks, i.e., adding a value of the wrong
+  // type succeeds here but leaves the stored value unchanged.
   auto key_blob = to_key_blob<prefix::data>(key);
-  auto value_blob = impl_->get(key_blob);
-  broker::data v;
-  if (!value_blob) {
-    if (value_blob.error() != ec::no_such_key)
-      return value_blob.error();
-    v = data::from_type(init_type);
-  } else {
-    v = from_blob<data>(*value_blob);
-  }
-  auto result = caf::visit(adder{value}, v);
-  if (!result)
-    return result;
-  if (!impl_->put(key_blob, to_blob(v), expiry))
-    return ec::backend_failure;
-  return {};
+  return impl_->merge(key_blob, adder_operator::make_operand(value, init_type),
+                      expiry);
 }
 
 expected<void> rocksdb_backend::subtract(const data& key, const data& value,
                                          optional<timestamp> expiry) {
+  // Subtracting from a missing key must not create it, so we still look up
+  // the key. However, the merge operator spares us decoding, updating and
+  // rewriting the value. Just like for `add`, subtracting a value of the
+  // wrong type succeeds here but leaves the stored value unchanged.
   auto key_blob = to_key_blob<prefix::data>(key);
-  auto value_blob = impl_->get(key_blob);
-  if (!value_blob)
-    return value_blob.error();
-  auto v = from_blob<data>(*value_blob);
-  auto result = caf::visit(remover{value}, v);
-  if (!result)
-    return result;
-  *value_blob = to_blob(v);
-  if (!impl_->put(key_blob, *value_blob, expiry))
-    return ec::backend_failure;
-  return {};
+  auto exists = impl_->exists(key_blob);
+  if (!exists)
+    return exists.error();
+  if (!*exists)
+    return ec::no_such_key;
+  return impl_->merge(key_blob, adder_operator::make_subtract_operand(value),
+                      expiry);
 }
 
 expected<void> rocksdb_backend::erase(const data& key) {
@@ -264,7 +419,7 @@ expected<void> rocksdb_backend::clear() {
   std::string path = impl_->path;
   delete impl_->db;
   impl_->db = nullptr;
-  auto status = rocksdb::DestroyDB(path.c_str(), rocksdb::Options());
+  auto status = rocksdb::DestroyDB(path.c_str(), impl_->options);
   if (!status.ok()) {
     BROKER_ERROR("failed to destroy DB:" << status.ToString());
     return ec::backend_failure;
@@ -303,7 +458,10 @@ expected<data> rocksdb_backend::get(const data& key) const {
   auto value_blob = impl_->get(to_key_blob<prefix::data>(key));
   if (!value_blob)
     return value_blob.error();
-  return from_blob<data>(*value_blob);
+  auto result = from_data_blob(*value_blob);
+  if (!result)
+    BROKER_ERROR("corrupt value for key:" << key);
+  return result;
 }
 
 expected<data> rocksdb_backend::keys() const {
@@ -367,8 +525,12 @@ expected<snapshot> rocksdb_backend::snapshot() const {
   i->Seek(rocksdb::Slice{&pfx, 1}); // initializes iterator
   while (i->Valid() && i->key()[0] == pfx) {
     auto key = from_key_blob<prefix::data>(i->key().data(), i->key().size());
-    auto value = from_blob<data>(i->value().data(), i->value().size());
-    result.emplace(std::move(key), std::move(value));
+    auto value = from_data_blob(i->value().data(), i->value().size());
+    if (!value) {
+      BROKER_ERROR("corrupt value in snapshot:" << key);
+      return value.error();
+    }
+    result.emplace(std::move(key), std::move(*value));
     i->Next();
   }
   if (!i->status().ok()) {
@@ -378,6 +540,22 @@ expected<snapshot> rocksdb_backend::snapshot() const {
   return {std::move(result)};
 }
 
+expected<snapshot_cursor_ptr> rocksdb_backend::cursor() const {
+  if (!impl_->db)
+    return ec::backend_failure;
+  rocksdb::ReadOptions opts;
+  opts.fill_cache = false;
+  auto i = std::unique_ptr<rocksdb::Iterator>{impl_->db->NewIterator(opts)};
+  static const auto pfx = static_cast<char>(prefix::data);
+  i->Seek(rocksdb::Slice{&pfx, 1}); // initializes iterator
+  return {std::make_unique<rocksdb_cursor>(std::move(i))};
+}
+
+bool rocksdb_backend::cursor_is_isolated() const {
+  // Iterators implicitly read from a snapshot taken at creation time.
+  return true;
+}
+
 expected<expirables> rocksdb_backend::expiries() const {
   if (!impl_->db)
     return ec::backend_failure;
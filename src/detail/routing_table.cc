@@ -0,0 +1,99 @@
+#include "broker/detail/routing_table.hh"
+
+#include <algorithm>
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+void insert_sorted(routing_table::slot_list& xs, caf::stream_slot x) {
+  auto i = std::lower_bound(xs.begin(), xs.end(), x);
+  if (i == xs.end() || *i != x)
+    xs.insert(i, x);
+}
+
+void erase_sorted(routing_table::slot_list& xs, caf::stream_slot x) {
+  auto i = std::lower_bound(xs.begin(), xs.end(), x);
+  if (i != xs.end() && *i == x)
+    xs.erase(i);
+}
+
+} // namespace
+
+void routing_table::set(caf::stream_slot slot, const filter_type& filter) {
+  erase(slot);
+  for (auto& prefix : filter)
+    add_prefix(prefix.string(), slot);
+  filters_.emplace(slot, filter);
+}
+
+void routing_table::erase(caf::stream_slot slot) {
+  auto i = filters_.find(slot);
+  if (i == filters_.end())
+    return;
+  for (auto& prefix : i->second)
+    remove_prefix(prefix.string(), slot);
+  filters_.erase(i);
+}
+
+void routing_table::clear() {
+  prefixes_.clear();
+  wildcards_.clear();
+  filters_.clear();
+  cache_.clear();
+}
+
+const routing_table::slot_list& routing_table::match(const topic& t) {
+  auto ptr = t.interned();
+  if (ptr != nullptr) {
+    auto i = cache_.find(ptr->id);
+    if (i != cache_.end())
+      return i->second;
+  }
+  auto& str = t.string();
+  buf_ = wildcards_;
+  if (!str.empty())
+    for (auto& j : prefixes_.prefix_of(str))
+      for (auto slot : j->second)
+        buf_.emplace_back(slot);
+  std::sort(buf_.begin(), buf_.end());
+  buf_.erase(std::unique(buf_.begin(), buf_.end()), buf_.end());
+  if (ptr == nullptr)
+    return buf_;
+  if (cache_.size() >= max_cached_topics)
+    cache_.clear();
+  return cache_.emplace(ptr->id, buf_).first->second;
+}
+
+bool routing_table::matches(caf::stream_slot slot, const topic& t) {
+  auto& xs = match(t);
+  return std::binary_search(xs.begin(), xs.end(), slot);
+}
+
+void routing_table::add_prefix(const std::string& prefix,
+                               caf::stream_slot slot) {
+  cache_.clear();
+  if (prefix.empty())
+    insert_sorted(wildcards_, slot);
+  else
+    insert_sorted(prefixes_[prefix], slot);
+}
+
+void routing_table::remove_prefix(const std::string& prefix,
+                                  caf::stream_slot slot) {
+  cache_.clear();
+  if (prefix.empty()) {
+    erase_sorted(wildcards_, slot);
+    return;
+  }
+  auto i = prefixes_.find(prefix);
+  if (i == prefixes_.end())
+    return;
+  erase_sorted(i->second, slot);
+  if (i->second.empty())
+    prefixes_.erase(prefix);
+}
+
+} // namespace detail
+} // namespace broker
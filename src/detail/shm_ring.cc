@@ -0,0 +1,118 @@
+#include "broker/detail/shm_ring.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "broker/detail/assert.hh"
+
+namespace broker {
+namespace detail {
+
+shm_ring shm_ring::init(void* mem, size_t capacity) {
+  BROKER_ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  auto hdr = new (mem) header;
+  hdr->head = 0;
+  hdr->tail = 0;
+  // The reader starts asleep, i.e., waits for a wakeup on the first write.
+  hdr->reader_waiting = 1;
+  hdr->writer_waiting = 0;
+  hdr->capacity = capacity;
+  return shm_ring{mem, capacity};
+}
+
+shm_ring shm_ring::attach(void* mem, size_t size) {
+  if (mem == nullptr || size < sizeof(header))
+    return shm_ring{};
+  // Read the capacity only once. The other process may change it anytime.
+  auto capacity = reinterpret_cast<volatile header*>(mem)->capacity;
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0
+      || capacity > size - sizeof(header))
+    return shm_ring{};
+  return shm_ring{mem, static_cast<size_t>(capacity)};
+}
+
+shm_ring::shm_ring() : hdr_(nullptr), capacity_(0) {
+  // nop
+}
+
+shm_ring::shm_ring(void* mem, size_t capacity)
+  : hdr_(reinterpret_cast<header*>(mem)), capacity_(capacity) {
+  // nop
+}
+
+size_t shm_ring::read(void* buf, size_t len) {
+  auto head = hdr_->head.load(std::memory_order_relaxed);
+  auto tail = hdr_->tail.load(std::memory_order_acquire);
+  auto avail = distance(head, tail);
+  if (avail == npos)
+    return npos;
+  auto n = std::min(len, avail);
+  if (n == 0)
+    return 0;
+  auto offset = static_cast<size_t>(head & (capacity() - 1));
+  auto first = std::min(n, capacity() - offset);
+  auto out = reinterpret_cast<char*>(buf);
+  memcpy(out, data() + offset, first);
+  memcpy(out + first, data(), n - first);
+  hdr_->head.store(head + n, std::memory_order_release);
+  return n;
+}
+
+size_t shm_ring::write(const void* buf, size_t len) {
+  auto tail = hdr_->tail.load(std::memory_order_relaxed);
+  auto head = hdr_->head.load(std::memory_order_acquire);
+  auto used = distance(head, tail);
+  if (used == npos)
+    return npos;
+  auto n = std::min(len, capacity() - used);
+  if (n == 0)
+    return 0;
+  auto offset = static_cast<size_t>(tail & (capacity() - 1));
+  auto first = std::min(n, capacity() - offset);
+  auto in = reinterpret_cast<const char*>(buf);
+  memcpy(data() + offset, in, first);
+  memcpy(data(), in + first, n - first);
+  hdr_->tail.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+size_t shm_ring::size() const noexcept {
+  auto head = hdr_->head.load();
+  auto tail = hdr_->tail.load();
+  return distance(head, tail);
+}
+
+// One side stores its flag and then checks the ring, while the other side
+// updates the ring and then checks the flag. Sequential consistency makes
+// sure that at least one side sees the update of the other, i.e., no wakeup
+// gets lost.
+
+bool shm_ring::await_data() {
+  hdr_->reader_waiting.store(1);
+  return hdr_->tail.load() == hdr_->head.load(std::memory_order_relaxed);
+}
+
+bool shm_ring::await_space() {
+  hdr_->writer_waiting.store(1);
+  auto head = hdr_->head.load();
+  auto tail = hdr_->tail.load(std::memory_order_relaxed);
+  return distance(head, tail) == capacity();
+}
+
+bool shm_ring::wake_reader() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (hdr_->reader_waiting.load(std::memory_order_relaxed) == 0)
+    return false;
+  return hdr_->reader_waiting.exchange(0) != 0;
+}
+
+bool shm_ring::wake_writer() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (hdr_->writer_waiting.load(std::memory_order_relaxed) == 0)
+    return false;
+  return hdr_->writer_waiting.exchange(0) != 0;
+}
+
+} // namespace detail
+} // namespace broker
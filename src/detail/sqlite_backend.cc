@@ -1,8 +1,10 @@
 #include "broker/logger.hh"
 
+#include <algorithm>
 #include <cstdio> // std::snprintf
 #include <utility>
 #include <cstdint>
+#include <initializer_list>
 #include <set>
 #include <string>
 #include <vector>
@@ -29,6 +31,42 @@ auto make_statement_guard = [](sqlite3_stmt* stmt) {
   return caf::detail::make_scope_guard([=] { sqlite3_reset(stmt); });
 };
 
+// Steps through its own statement, because multiple cursors may be active at
+// the same time.
+class sqlite_cursor : public snapshot_cursor {
+public:
+  sqlite_cursor(sqlite3_stmt* stmt) : stmt_(stmt) {
+    // nop
+  }
+
+  ~sqlite_cursor() override {
+    sqlite3_finalize(stmt_);
+  }
+
+  expected<bool> next(std::vector<snapshot_entry>& xs, size_t n) override {
+    for (; n > 0; --n) {
+      auto result = sqlite3_step(stmt_);
+      if (result == SQLITE_DONE)
+        return false;
+      if (result != SQLITE_ROW)
+        return ec::backend_failure;
+      auto key = from_blob<data>(sqlite3_column_blob(stmt_, 0),
+                                 sqlite3_column_bytes(stmt_, 0));
+      auto value = from_data_blob(sqlite3_column_blob(stmt_, 1),
+                                  sqlite3_column_bytes(stmt_, 1));
+      if (!value) {
+        BROKER_ERROR("corrupt value in snapshot:" << key);
+        return value.error();
+      }
+      xs.emplace_back(std::move(key), std::move(*value));
+    }
+    return true;
+  }
+
+private:
+  sqlite3_stmt* stmt_;
+};
+
 } // namespace <anonymous>
 
 struct sqlite_backend::impl {
@@ -46,6 +84,10 @@ struct sqlite_backend::impl {
   ~impl() {
     if (!db)
       return;
+    // Closing the database would roll back pending modifications.
+    if (in_transaction
+        && sqlite3_exec(db, "commit;", nullptr, nullptr, nullptr) != SQLITE_OK)
+      BROKER_ERROR("failed to commit transaction");
     // Deallocate prepared statements.
     for (auto stmt : finalize)
       sqlite3_finalize(stmt);
@@ -53,6 +95,15 @@ struct sqlite_backend::impl {
     sqlite3_close(db);
   }
 
+  // Discards all modifications of the current transaction, if any.
+  void rollback() {
+    if (!in_transaction)
+      return;
+    if (sqlite3_exec(db, "rollback;", nullptr, nullptr, nullptr) != SQLITE_OK)
+      BROKER_ERROR("failed to roll back transaction");
+    in_transaction = sqlite3_get_autocommit(db) == 0;
+  }
+
   bool open(const std::string& path) {
     auto dir = detail::dirname(path);
 
@@ -70,6 +121,32 @@ struct sqlite_backend::impl {
       BROKER_ERROR("failed to open database:" << path);
       return false;
     }
+    // Apply optional settings. PRAGMA statements do not accept parameters,
+    // so we only pass known values to SQLite.
+    auto set_pragma = [&](const char* name,
+                          std::initializer_list<const char*> values) {
+      auto i = options.find(name);
+      if (i == options.end())
+        return true;
+      auto value = caf::get_if<std::string>(&i->second);
+      if (!value
+          || std::none_of(values.begin(), values.end(),
+                          [&](const char* x) { return *value == x; })) {
+        BROKER_ERROR("invalid value for option" << name);
+        return false;
+      }
+      auto sql = "pragma " + std::string{name} + " = " + *value + ";";
+      if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr)
+          != SQLITE_OK) {
+        BROKER_ERROR("failed to set" << name << "to" << *value);
+        return false;
+      }
+      return true;
+    };
+    if (!set_pragma("journal_mode",
+                    {"delete", "truncate", "persist", "memory", "wal", "off"})
+        || !set_pragma("synchronous", {"off", "normal", "full", "extra"}))
+      return false;
     // Create table for store meta data.
     result = sqlite3_exec(db,
                           "create table if not exists "
@@ -129,7 +206,7 @@ struct sqlite_backend::impl {
   bool modify(const data& key, const data& value,
               optional<timestamp> expiry) {
     auto key_blob = to_blob(key);
-    auto value_blob = to_blob(value);
+    auto value_blob = to_data_blob(value);
     auto guard = make_statement_guard(update);
 
     // Bind value.
@@ -175,6 +252,7 @@ struct sqlite_backend::impl {
   sqlite3_stmt* clear = nullptr;
   sqlite3_stmt* keys = nullptr;
   std::vector<sqlite3_stmt*> finalize;
+  bool in_transaction = false;
 };
 
 
@@ -197,7 +275,7 @@ expected<void> sqlite_backend::put(const data& key, data value,
   if (result != SQLITE_OK)
     return ec::backend_failure;
   // Bind value.
-  auto value_blob = to_blob(value);
+  auto value_blob = to_data_blob(value);
   result = sqlite3_bind_blob64(impl_->replace, 2, value_blob.data(),
                                value_blob.size(), SQLITE_STATIC);
   if (result != SQLITE_OK)
@@ -294,6 +372,23 @@ expected<bool> sqlite_backend::expire(const data& key, timestamp ts) {
   return sqlite3_changes(impl_->db) == 1;
 }
 
+expected<std::vector<data>>
+sqlite_backend::bulk_expire(const std::vector<data>& keys, timestamp ts) {
+  // Delete all keys in a single transaction unless the caller already opened
+  // one.
+  if (impl_->in_transaction)
+    return abstract_backend::bulk_expire(keys, ts);
+  if (auto res = begin_transaction(); !res)
+    return res.error();
+  auto result = abstract_backend::bulk_expire(keys, ts);
+  if (auto res = commit_transaction(); !res) {
+    // Later modifications must not end up in our transaction.
+    impl_->rollback();
+    return res.error();
+  }
+  return result;
+}
+
 expected<data> sqlite_backend::get(const data& key) const {
   if (!impl_->db)
     return ec::backend_failure;
@@ -308,8 +403,11 @@ expected<data> sqlite_backend::get(const data& key) const {
 	  return ec::no_such_key;
 	if (result != SQLITE_ROW)
     return ec::backend_failure;
-	return from_blob<data>(sqlite3_column_blob(impl_->lookup, 0),
-                         sqlite3_column_bytes(impl_->lookup, 0));
+  auto value = from_data_blob(sqlite3_column_blob(impl_->lookup, 0),
+                              sqlite3_column_bytes(impl_->lookup, 0));
+  if (!value)
+    BROKER_ERROR("corrupt value for key:" << key);
+  return value;
 }
 
 expected<data> sqlite_backend::keys() const {
@@ -367,15 +465,67 @@ expected<snapshot> sqlite_backend::snapshot() const {
   while ((result = sqlite3_step(impl_->snapshot)) == SQLITE_ROW) {
     auto key = from_blob<data>(sqlite3_column_blob(impl_->snapshot, 0),
                                sqlite3_column_bytes(impl_->snapshot, 0));
-    auto value = from_blob<data>(sqlite3_column_blob(impl_->snapshot, 1),
-                                 sqlite3_column_bytes(impl_->snapshot, 1));
-    ss.emplace(std::move(key), std::move(value));
+    auto value = from_data_blob(sqlite3_column_blob(impl_->snapshot, 1),
+                                sqlite3_column_bytes(impl_->snapshot, 1));
+    if (!value) {
+      BROKER_ERROR("corrupt value in snapshot:" << key);
+      return value.error();
+    }
+    ss.emplace(std::move(key), std::move(*value));
   }
   if (result == SQLITE_DONE)
     return {std::move(ss)};
   return ec::backend_failure;
 }
 
+expected<snapshot_cursor_ptr> sqlite_backend::cursor() const {
+  if (!impl_->db)
+    return ec::backend_failure;
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(impl_->db, "select key, value from store;", -1,
+                         &stmt, nullptr)
+      != SQLITE_OK) {
+    BROKER_ERROR("failed to prepare snapshot cursor");
+    sqlite3_finalize(stmt);
+    return ec::backend_failure;
+  }
+  return {std::make_unique<sqlite_cursor>(stmt)};
+}
+
+bool sqlite_backend::cursor_is_isolated() const {
+  // A statement sees modifications on the same connection while stepping.
+  return false;
+}
+
+expected<void> sqlite_backend::begin_transaction() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  if (impl_->in_transaction)
+    return {};
+  if (sqlite3_exec(impl_->db, "begin transaction;", nullptr, nullptr, nullptr)
+      != SQLITE_OK) {
+    BROKER_ERROR("failed to begin transaction");
+    return ec::backend_failure;
+  }
+  impl_->in_transaction = true;
+  return {};
+}
+
+expected<void> sqlite_backend::commit_transaction() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  if (!impl_->in_transaction)
+    return {};
+  auto result = sqlite3_exec(impl_->db, "commit;", nullptr, nullptr, nullptr);
+  // A failed commit may leave the transaction open.
+  impl_->in_transaction = sqlite3_get_autocommit(impl_->db) == 0;
+  if (result != SQLITE_OK) {
+    BROKER_ERROR("failed to commit transaction");
+    return ec::backend_failure;
+  }
+  return {};
+}
+
 expected<expirables> sqlite_backend::expiries() const {
   if (!impl_->db)
     return ec::backend_failure;
@@ -0,0 +1,62 @@
+#include "broker/detail/topic_dictionary.hh"
+
+#include "broker/logger.hh"
+
+namespace broker {
+namespace detail {
+
+void topic_encoder::encode(node_message& x) {
+  auto& t = get_topic(x);
+  auto ptr = t.interned();
+  if (ptr == nullptr || t.string().empty()) {
+    x.topic_ref = 0;
+    return;
+  }
+  auto i = ids_.find(ptr->id);
+  if (i != ids_.end()) {
+    x.topic_ref = i->second << 1;
+    return;
+  }
+  if (ids_.size() >= max_size) {
+    x.topic_ref = 0;
+    return;
+  }
+  auto n = static_cast<uint32_t>(ids_.size() + 1);
+  ids_.emplace(ptr->id, n);
+  x.topic_ref = (n << 1) | 1;
+}
+
+bool topic_decoder::decode(node_message& x) {
+  if (x.topic_ref == 0)
+    return true;
+  auto n = static_cast<size_t>(x.topic_ref >> 1);
+  auto defines_entry = (x.topic_ref & 1) != 0;
+  x.topic_ref = 0;
+  if (n == 0) {
+    BROKER_ERROR("received a message with an invalid topic reference");
+    return false;
+  }
+  if (defines_entry) {
+    if (n <= topics_.size()) {
+      topics_[n - 1] = get_topic(x);
+    } else if (n == topics_.size() + 1) {
+      topics_.emplace_back(get_topic(x));
+    } else {
+      BROKER_ERROR("received a topic definition out of order");
+      return false;
+    }
+    return true;
+  }
+  if (n > topics_.size()) {
+    BROKER_ERROR("received a reference to an unknown topic");
+    return false;
+  }
+  if (is_data_message(x))
+    get<0>(caf::get<data_message>(x.content).unshared()) = topics_[n - 1];
+  else
+    get<0>(caf::get<command_message>(x.content).unshared()) = topics_[n - 1];
+  return true;
+}
+
+} // namespace detail
+} // namespace broker
@@ -0,0 +1,62 @@
+#include "broker/detail/topic_table.hh"
+
+#include <algorithm>
+
+#include "broker/topic.hh"
+
+namespace broker {
+namespace detail {
+
+namespace {
+
+bool ends_with(const std::string& s, const std::string& ending) {
+  if (ending.size() > s.size())
+    return false;
+  return std::equal(ending.rbegin(), ending.rend(), s.rbegin());
+}
+
+} // namespace
+
+uint8_t make_topic_flags(const std::string& str) {
+  uint8_t result = 0;
+  if (ends_with(str, topics::master_suffix.string()))
+    result |= master_topic_flag;
+  if (ends_with(str, topics::clone_suffix.string()))
+    result |= clone_topic_flag;
+  return result;
+}
+
+const interned_topic* topic_table::intern(const std::string& str) {
+  { // Lifetime scope of the reader lock.
+    std::shared_lock<std::shared_mutex> guard{mtx_};
+    auto i = index_.find(str);
+    if (i != index_.end())
+      return i->second;
+  }
+  std::unique_lock<std::shared_mutex> guard{mtx_};
+  // Check again, because another thread may have added the topic meanwhile.
+  auto i = index_.find(str);
+  if (i != index_.end())
+    return i->second;
+  if (entries_.size() >= max_size)
+    return nullptr;
+  auto id = static_cast<topic_id>(entries_.size());
+  entries_.emplace_back(interned_topic{id, std::hash<std::string>{}(str),
+                                       make_topic_flags(str), str});
+  auto ptr = &entries_.back();
+  index_.emplace(ptr->str, ptr);
+  return ptr;
+}
+
+size_t topic_table::size() const {
+  std::shared_lock<std::shared_mutex> guard{mtx_};
+  return entries_.size();
+}
+
+topic_table& topic_table::instance() {
+  static topic_table instance;
+  return instance;
+}
+
+} // namespace detail
+} // namespace broker
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <set>
+#include <string>
 #include <unordered_set>
 
 #include <caf/config.hpp>
@@ -13,12 +15,15 @@
 #include <caf/message.hpp>
 #include <caf/io/middleman.hpp>
 #include <caf/openssl/publish.hpp>
+#include <caf/sec.hpp>
 
 #include "broker/atoms.hh"
 #include "broker/core_actor.hh"
 #include "broker/defaults.hh"
 #include "broker/detail/die.hh"
 #include "broker/detail/filesystem.hh"
+#include "broker/detail/local_transport.hh"
+#include "broker/detail/peer_stripe.hh"
 #include "broker/endpoint.hh"
 #include "broker/logger.hh"
 #include "broker/publisher.hh"
@@ -119,6 +124,13 @@ caf::node_id endpoint::node_id() const {
   return core()->node();
 }
 
+const caf::actor& endpoint::core_for(const topic& t) const {
+  // Data stores always communicate through the primary core actor.
+  if (cores_.size() < 2 || t.is_master_topic() || t.is_clone_topic())
+    return core_;
+  return cores_[t.hash() % cores_.size()];
+}
+
 namespace {
 
 struct indentation {
@@ -194,6 +206,32 @@ endpoint::endpoint(configuration config)
       detail::die("CAF OpenSSL manager is not available");
   BROKER_INFO("creating endpoint");
   core_ = system_.spawn(core_actor, filter_type{}, config_.options(), clock_);
+  cores_.emplace_back(core_);
+  auto num_shards = get_or(config_, "broker.core-shards",
+                           defaults::core_shards);
+  auto num_stripes = get_or(config_, "broker.peer-stripes",
+                            defaults::peer_stripes);
+  if (num_stripes > 1) {
+    // Each stripe brings its own actor system, because CAF sends everything
+    // between two actor systems over a single connection.
+    BROKER_INFO("spawning" << num_stripes << "peer stripes");
+    num_shards = num_stripes;
+    for (size_t i = 1; i < num_stripes; ++i) {
+      stripes_.emplace_back(new detail::peer_stripe(config_, clock_, core_));
+      cores_.emplace_back(stripes_.back()->core());
+    }
+  } else if (num_shards > 1) {
+    BROKER_INFO("spawning" << num_shards << "core shards");
+    for (size_t i = 1; i < num_shards; ++i)
+      cores_.emplace_back(system_.spawn(core_shard_actor, config_.options(),
+                                        clock_, core_));
+  }
+  if (num_shards > 1) {
+    std::vector<caf::actor> shards{cores_.begin() + 1, cores_.end()};
+    anon_send(core_, atom::shard::value, std::move(shards), !stripes_.empty());
+  }
+  if (get_or(config_, "broker.local-delivery", defaults::local_delivery))
+    local_dispatcher_ = std::make_shared<detail::local_dispatcher>();
 }
 
 endpoint::~endpoint() {
@@ -223,9 +261,14 @@ void endpoint::shutdown() {
     self->wait_for(children_);
     children_.clear();
   }
+  detail::shutdown_local_middleman(system_);
   BROKER_DEBUG("send shutdown message to core actor");
-  anon_send(core_, atom::shutdown::value);
+  for (auto& hdl : cores_)
+    anon_send(hdl, atom::shutdown::value);
+  cores_.clear();
   core_ = nullptr;
+  // Stripes run their own actor systems, which must shut down first.
+  stripes_.clear();
   system_.~actor_system();
   delete clock_;
   clock_ = nullptr;
@@ -236,12 +279,33 @@ uint16_t endpoint::listen(const std::string& address, uint16_t port) {
               << (address + ":" + std::to_string(port))
               << (config_.options().disable_ssl ? "(no SSL)" : "(SSL)"));
   char const* addr = address.empty() ? nullptr : address.c_str();
+  // Publish the stripes before the primary core. Peers only learn about the
+  // stripes through the primary core, so a failing stripe must not leave the
+  // primary core published.
+  std::vector<uint16_t> ports;
+  if (!stripes_.empty() && !detail::is_local_address(address)) {
+    for (auto& stripe : stripes_) {
+      auto stripe_port = stripe->listen(address);
+      if (!stripe_port) {
+        BROKER_ERROR("cannot listen for peer stripes:" << stripe_port.error());
+        return 0;
+      }
+      ports.emplace_back(*stripe_port);
+    }
+  }
   expected<uint16_t> res = caf::error{};
-  if (config_.options().disable_ssl)
+  if (detail::is_local_address(address))
+    res = listen_locally(address, port);
+  else if (config_.options().disable_ssl)
     res = system_.middleman().publish(core(), port, addr, true);
   else
     res = caf::openssl::publish(core(), port, addr, true);
-  return res ? *res : 0;
+  if (!res)
+    return 0;
+  if (!ports.empty())
+    anon_send(core_, atom::shard::value, atom::network::value,
+              std::move(ports));
+  return *res;
 }
 
 bool endpoint::peer(const std::string& address, uint16_t port,
@@ -303,6 +367,24 @@ void endpoint::unpeer_nosync(const std::string& address, uint16_t port) {
   caf::anon_send(core(), atom::unpeer::value, network_info{address, port});
 }
 
+bool endpoint::listen_unix(const std::string& path) {
+  BROKER_INFO("listening on Unix domain socket" << path);
+  auto res = listen_locally(detail::make_unix_address(path), 0);
+  if (!res) {
+    BROKER_DEBUG("Cannot listen on" << path << ":" << res.error());
+    return false;
+  }
+  return true;
+}
+
+bool endpoint::peer_unix(const std::string& path, timeout::seconds retry) {
+  return peer(detail::make_unix_address(path), 0, retry);
+}
+
+bool endpoint::unpeer_unix(const std::string& path) {
+  return unpeer(detail::make_unix_address(path), 0);
+}
+
 std::vector<peer_info> endpoint::peers() const {
   std::vector<peer_info> result;
   caf::scoped_actor self{system_};
@@ -337,24 +419,32 @@ std::vector<topic> endpoint::peer_subscriptions() const {
 void endpoint::forward(std::vector<topic> ts)
 {
   BROKER_INFO("forwarding topics" << ts);
-  caf::anon_send(core(), atom::subscribe::value, std::move(ts));
+  for (auto& hdl : cores_)
+    caf::anon_send(hdl, atom::subscribe::value, ts);
 }
 
 void endpoint::publish(topic t, data d) {
   BROKER_INFO("publishing" << std::make_pair(t, d));
-  caf::anon_send(core(), atom::publish::value,
-                 make_data_message(std::move(t), std::move(d)));
+  auto& hdl = core_for(t);
+  auto x = make_data_message(std::move(t), std::move(d));
+  if (local_dispatcher_)
+    local_dispatcher_->deliver(x);
+  caf::anon_send(hdl, atom::publish::value, std::move(x));
 }
 
 void endpoint::publish(const endpoint_info& dst, topic t, data d) {
   BROKER_INFO("publishing" << std::make_pair(t, d) << "to" << dst.node);
-  caf::anon_send(core(), atom::publish::value, dst,
+  auto& hdl = core_for(t);
+  caf::anon_send(hdl, atom::publish::value, dst,
                  make_data_message(std::move(t), std::move(d)));
 }
 
 void endpoint::publish(data_message x){
   BROKER_INFO("publishing" << x);
-  caf::anon_send(core(), atom::publish::value, std::move(x));
+  auto& hdl = core_for(get_topic(x));
+  if (local_dispatcher_)
+    local_dispatcher_->deliver(x);
+  caf::anon_send(hdl, atom::publish::value, std::move(x));
 }
 
 
@@ -370,6 +460,12 @@ publisher endpoint::make_publisher(topic ts) {
   return result;
 }
 
+publisher endpoint::make_publisher(topic ts, batching_options opts) {
+  publisher result{*this, std::move(ts), opts};
+  children_.emplace_back(result.worker());
+  return result;
+}
+
 status_subscriber endpoint::make_status_subscriber(bool receive_statuses) {
   status_subscriber result{*this, receive_statuses};
   children_.emplace_back(result.worker());
@@ -382,6 +478,30 @@ subscriber endpoint::make_subscriber(std::vector<topic> ts, size_t max_qsize) {
   return result;
 }
 
+expected<uint16_t> endpoint::listen_locally(const std::string& address,
+                                            uint16_t port) {
+  // Local transports never use SSL. Silently falling back to plaintext
+  // would undermine endpoints that require SSL.
+  if (!config_.options().disable_ssl)
+    return caf::make_error(caf::sec::unsupported_operation,
+                           "local transports require disable_ssl", address);
+  expected<uint16_t> res = caf::error{};
+  caf::scoped_actor self{system_};
+  self->request(detail::local_middleman(system_), caf::infinite,
+                caf::publish_atom::value, port,
+                caf::actor_cast<caf::strong_actor_ptr>(core()),
+                std::set<std::string>{}, address, true)
+  .receive(
+    [&](uint16_t actual_port) {
+      res = actual_port;
+    },
+    [&](caf::error& err) {
+      res = std::move(err);
+    }
+  );
+  return res;
+}
+
 caf::actor endpoint::make_actor(actor_init_fun f) {
   auto hdl = system_.spawn([=](caf::event_based_actor* self) {
 #ifndef CAF_NO_EXCEPTION
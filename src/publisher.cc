@@ -1,17 +1,51 @@
 #include "broker/logger.hh" // Must come before any CAF include.
 #include "broker/publisher.hh"
 
+#include <iterator>
+#include <mutex>
+
 #include <caf/send.hpp>
 
 #include "broker/data.hh"
 #include "broker/endpoint.hh"
 #include "broker/message.hh"
 #include "broker/topic.hh"
+#include "broker/zeek.hh"
 
 using namespace caf;
 
 namespace broker {
 
+struct publisher::batch_state {
+  batch_state(topic t, batching_options opts)
+    : t(std::move(t)), opts(opts) {
+    // nop
+  }
+
+  /// Removes all buffered messages and returns them as queue items.
+  /// @pre The caller holds `mtx`.
+  std::vector<data> take() {
+    // Invalidates pending timeouts for this batch.
+    ++generation;
+    std::vector<data> result;
+    if (buf.empty() || !opts.zeek_batch) {
+      result.swap(buf);
+      return result;
+    }
+    zeek::Batch msg{vector(std::make_move_iterator(buf.begin()),
+                           std::make_move_iterator(buf.end()))};
+    result.emplace_back(msg.move_data());
+    buf.clear();
+    return result;
+  }
+
+  std::mutex mtx;
+  std::vector<data> buf;
+  uint64_t generation = 0;
+  topic t;
+  batching_options opts;
+};
+
 namespace {
 
 // TODO: make these constants configurable
@@ -48,11 +82,14 @@ struct publisher_worker_state {
 
 const char* publisher_worker_state::name = "publisher_worker";
 
+using batch_state_ptr = std::shared_ptr<publisher::batch_state>;
+
 behavior publisher_worker(stateful_actor<publisher_worker_state>* self,
-                          endpoint* ep,
-                          detail::shared_publisher_queue_ptr<> qptr) {
+                          caf::actor core,
+                          detail::publisher_queue_ptr<> qptr,
+                          batch_state_ptr batch) {
   auto handler = self->make_source(
-    ep->core(),
+    core,
     [](unit_t&) {
       // nop
     },
@@ -75,6 +112,25 @@ behavior publisher_worker(stateful_actor<publisher_worker_state>* self,
       if (handler->generate_messages())
         handler->push();
     },
+    [=](atom::flush, uint64_t generation) {
+      if (batch == nullptr)
+        return;
+      std::unique_lock<std::mutex> guard{batch->mtx, std::try_to_lock};
+      if (!guard.owns_lock()) {
+        // The publisher may wait for us while holding the lock. Retry later
+        // instead of blocking.
+        self->delayed_send(self, std::chrono::milliseconds(1),
+                           atom::flush::value, generation);
+        return;
+      }
+      if (batch->generation != generation)
+        return;
+      auto xs = batch->take();
+      qptr->append(batch->t, xs.begin(), xs.end());
+      guard.unlock();
+      if (handler->generate_messages())
+        handler->push();
+    },
     [=](atom::tick) {
       auto& st = self->state;
       st.tick();
@@ -95,16 +151,30 @@ behavior publisher_worker(stateful_actor<publisher_worker_state>* self,
 
 publisher::publisher(endpoint& ep, topic t)
   : drop_on_destruction_(false),
-    queue_(detail::make_shared_publisher_queue(queue_size)),
-    worker_(ep.system().spawn(publisher_worker, &ep, queue_)),
-    topic_(std::move(t)) {
+    queue_(detail::make_publisher_queue(queue_size)),
+    worker_(ep.system().spawn(publisher_worker, ep.core_for(t), queue_,
+                              batch_state_ptr{})),
+    topic_(std::move(t)),
+    local_(ep.local_dispatcher()) {
+  // nop
+}
+
+publisher::publisher(endpoint& ep, topic t, batching_options opts)
+  : drop_on_destruction_(false),
+    batch_(std::make_shared<batch_state>(t, opts)),
+    queue_(detail::make_publisher_queue(queue_size)),
+    worker_(ep.system().spawn(publisher_worker, ep.core_for(t), queue_,
+                              batch_)),
+    topic_(std::move(t)),
+    local_(ep.local_dispatcher()) {
   // nop
 }
 
 publisher::~publisher() {
-  if (!drop_on_destruction_)
+  if (!drop_on_destruction_) {
+    flush();
     anon_send(worker_, atom::shutdown::value);
-  else
+  } else
     anon_send_exit(worker_, exit_reason::user_shutdown);
 }
 
@@ -137,11 +207,42 @@ void publisher::drop_all_on_destruction() {
 
 void publisher::publish(data x) {
   BROKER_INFO("publishing" << std::make_pair(topic_, x));
+  deliver_locally(x);
+  if (batch_ != nullptr) {
+    std::unique_lock<std::mutex> guard{batch_->mtx};
+    auto& buf = batch_->buf;
+    buf.emplace_back(std::move(x));
+    if (buf.size() >= batch_->opts.max_size) {
+      produce(batch_->take());
+    } else if (buf.size() == 1) {
+      delayed_anon_send(worker_, batch_->opts.max_delay, atom::flush::value,
+                        batch_->generation);
+    }
+    return;
+  }
   if (queue_->produce(topic_, std::move(x)))
     anon_send(worker_, atom::resume::value);
 }
 
 void publisher::publish(std::vector<data> xs) {
+  if (batch_ != nullptr) {
+    for (auto& x : xs)
+      publish(std::move(x));
+    return;
+  }
+  for (auto& x : xs)
+    deliver_locally(x);
+  produce(std::move(xs));
+}
+
+void publisher::flush() {
+  if (batch_ == nullptr)
+    return;
+  std::unique_lock<std::mutex> guard{batch_->mtx};
+  produce(batch_->take());
+}
+
+void publisher::produce(std::vector<data> xs) {
   auto t = static_cast<ptrdiff_t>(queue_->capacity());
   auto i = xs.begin();
   auto e = xs.end();
@@ -159,4 +260,16 @@ void publisher::publish(std::vector<data> xs) {
   }
 }
 
+void publisher::deliver_locally(const data& x) {
+  if (local_ == nullptr)
+    return;
+  // Multiple threads may publish concurrently, hence the atomic access.
+  auto cached = std::atomic_load(&local_route_);
+  auto r = local_->lookup(topic_, cached);
+  if (r != cached)
+    std::atomic_store(&local_route_, r);
+  if (!r->queues.empty())
+    detail::local_dispatcher::deliver(*r, make_data_message(topic_, x));
+}
+
 } // namespace broker
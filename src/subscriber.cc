@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <utility>
 #include <chrono>
+#include <memory>
 #include <numeric>
 
 #include <caf/scheduled_actor.hpp>
@@ -56,7 +57,7 @@ class subscriber_sink : public stream_sink<data_message> {
 public:
   using super = stream_sink<data_message>;
 
-  using queue_ptr = detail::shared_subscriber_queue_ptr<>;
+  using queue_ptr = detail::subscriber_queue_ptr<>;
 
   subscriber_sink(scheduled_actor* self, subscriber_worker_state* state,
                   queue_ptr qptr, size_t max_qsize)
@@ -94,15 +95,22 @@ private:
 
 behavior subscriber_worker(stateful_actor<subscriber_worker_state>* self,
                            endpoint* ep,
-                           detail::shared_subscriber_queue_ptr<> qptr,
+                           detail::subscriber_queue_ptr<> qptr,
                            std::vector<topic> ts, size_t max_qsize) {
-  self->send(self * ep->core(), atom::join::value, std::move(ts));
+  // Sharded endpoints route each topic through one of their cores. Hence, we
+  // join all cores and merge their streams into a single sink.
+  auto& cores = ep->cores();
+  for (auto& core : cores)
+    self->send(self * core, atom::join::value, ts);
   self->set_default_handler(skip);
+  BROKER_ASSERT(qptr != nullptr);
+  auto mgr = make_counted<subscriber_sink>(self, &self->state, qptr,
+                                           max_qsize);
+  using slot_pair = std::pair<caf::actor, stream_slot>;
+  auto slots = std::make_shared<std::vector<slot_pair>>();
+  auto num_cores = cores.size();
   return {
     [=](const endpoint::stream_type& in) {
-      BROKER_ASSERT(qptr != nullptr);
-      auto mgr = make_counted<subscriber_sink>(self, &self->state, qptr,
-                                               max_qsize);
       auto slot = mgr->add_unchecked_inbound_path(in);
       if (slot == invalid_stream_slot) {
         BROKER_WARNING("failed to init stream to subscriber_worker");
@@ -110,41 +118,57 @@ behavior subscriber_worker(stateful_actor<subscriber_worker_state>* self,
       }
       auto path = mgr->get_inbound_path(slot);
       BROKER_ASSERT(path != nullptr);
-      auto slot_at_sender = path->slots.sender;
+      slots->emplace_back(actor_cast<caf::actor>(path->hdl),
+                          path->slots.sender);
+      if (slots->size() < num_cores)
+        return;
       self->set_default_handler(print_and_drop);
       self->delayed_send(self, std::chrono::seconds(1), atom::tick::value);
-      self->become(
-        [=](atom::resume) {
-          // TODO: nop ?
-          // Triggering the actor should be enough to have it check its mailbox
-          // again in order to handle batches from a previously congested
-          // manager.
-        },
-        [=](atom::join a0, atom::update a1, filter_type& f) {
-          self->send(ep->core(), a0, a1, slot_at_sender, std::move(f));
-        },
-        [=](atom::join a0, atom::update a1, filter_type& f, caf::actor& who) {
-          self->send(ep->core(), a0, a1, slot_at_sender, std::move(f),
-                     std::move(who));
-        },
-        [=](atom::tick) {
-          auto& st = self->state;
-          st.tick();
-          qptr->rate(st.rate());
-          if (st.calculate_rate)
-            self->delayed_send(self, std::chrono::seconds(1),
-                               atom::tick::value);
-        },
-        [=](atom::tick, bool x) {
-          auto& st = self->state;
-          if (st.calculate_rate == x)
-            return;
-          st.calculate_rate = x;
-          if (x)
-            self->delayed_send(self, std::chrono::seconds(1),
-                               atom::tick::value);
-        }
-      );
+    },
+    [=](atom::resume) {
+      // TODO: nop ?
+      // Triggering the actor should be enough to have it check its mailbox
+      // again in order to handle batches from a previously congested
+      // manager.
+    },
+    [=](atom::join a0, atom::update a1, filter_type& f) -> result<void> {
+      if (slots->size() < num_cores)
+        return skip;
+      for (auto& kvp : *slots)
+        self->send(kvp.first, a0, a1, kvp.second, f);
+      return unit;
+    },
+    [=](atom::join a0, atom::update a1, filter_type& f,
+        caf::actor& who) -> result<void> {
+      if (slots->size() < num_cores)
+        return skip;
+      // Unblock the caller only after all cores have applied the update.
+      auto pending = std::make_shared<size_t>(slots->size());
+      for (auto& kvp : *slots)
+        self->request(kvp.first, infinite, a0, a1, kvp.second, f).then(
+          [=]() {
+            if (--*pending == 0)
+              self->send(who, true);
+          }
+        );
+      return unit;
+    },
+    [=](atom::tick) {
+      auto& st = self->state;
+      st.tick();
+      qptr->rate(st.rate());
+      if (st.calculate_rate)
+        self->delayed_send(self, std::chrono::seconds(1),
+                           atom::tick::value);
+    },
+    [=](atom::tick, bool x) {
+      auto& st = self->state;
+      if (st.calculate_rate == x)
+        return;
+      st.calculate_rate = x;
+      if (x)
+        self->delayed_send(self, std::chrono::seconds(1),
+                           atom::tick::value);
     }
   };
 }
@@ -152,13 +176,17 @@ behavior subscriber_worker(stateful_actor<subscriber_worker_state>* self,
 } // namespace <anonymous>
 
 subscriber::subscriber(endpoint& e, std::vector<topic> ts, size_t max_qsize)
-  : super(max_qsize), ep_(e) {
+  : super(max_qsize), filter_(ts), ep_(e), local_(e.local_dispatcher()) {
   BROKER_INFO("creating subscriber for topic(s)" << ts);
   worker_ = ep_.get().system().spawn(subscriber_worker, &ep_.get(), queue_, std::move(ts),
                                max_qsize);
+  update_local_filter();
 }
 
 subscriber::~subscriber() {
+  // Moved-from subscribers have neither a queue nor a dispatcher.
+  if (local_ && queue_)
+    local_->unsubscribe(queue_);
   anon_send_exit(worker_, exit_reason::user_shutdown);
 }
 
@@ -172,6 +200,7 @@ void subscriber::add_topic(topic x, bool block) {
   auto i = std::find(filter_.begin(), e, x);
   if (i == e) {
     filter_.emplace_back(std::move(x));
+    update_local_filter();
     if (block) {
       caf::scoped_actor self{ep_.get().system()};
       self->send(worker_, atom::join::value, atom::update::value, filter_, self);
@@ -188,6 +217,7 @@ void subscriber::remove_topic(topic x, bool block) {
   auto i = std::find(filter_.begin(), e, x);
   if (i != filter_.end()) {
     filter_.erase(i);
+    update_local_filter();
     if (block) {
       caf::scoped_actor self{ep_.get().system()};
       self->send(worker_, atom::join::value, atom::update::value, filter_, self);
@@ -206,4 +236,9 @@ void subscriber::became_not_full() {
   anon_send(worker_, atom::resume::value);
 }
 
+void subscriber::update_local_filter() {
+  if (local_)
+    local_->subscribe(queue_, filter_);
+}
+
 } // namespace broker
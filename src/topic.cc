@@ -1,9 +1,34 @@
 #include "broker/topic.hh"
 
+#include "broker/detail/topic_table.hh"
+
 namespace broker {
 
 constexpr char topic::reserved[];
 
+topic::topic(const topic& other)
+  : str_(other.str_), interned_(other.interned_.load()) {
+  // nop
+}
+
+topic::topic(topic&& other) noexcept
+  : str_(std::move(other.str_)), interned_(other.interned_.load()) {
+  other.interned_ = nullptr;
+}
+
+topic& topic::operator=(const topic& other) {
+  str_ = other.str_;
+  interned_ = other.interned_.load();
+  return *this;
+}
+
+topic& topic::operator=(topic&& other) noexcept {
+  str_ = std::move(other.str_);
+  interned_ = other.interned_.load();
+  other.interned_ = nullptr;
+  return *this;
+}
+
 std::vector<std::string> topic::split(const topic& t) {
   std::vector<std::string> result;
   std::string::size_type i = 0;
@@ -31,6 +56,7 @@ topic topic::join(const std::vector<std::string>& components) {
 }
 
 topic& topic::operator/=(const topic& rhs) {
+  interned_ = nullptr;
   if (!rhs.str_.empty() && rhs.str_[0] != sep && !str_.empty())
     str_ += sep;
   str_ += rhs.str_;
@@ -48,6 +74,35 @@ bool topic::prefix_of(const topic& t) const {
          && t.str_.compare(0, str_.size(), str_) == 0;
 }
 
+const detail::interned_topic* topic::interned() const {
+  auto result = interned_.load(std::memory_order_relaxed);
+  if (result == nullptr) {
+    result = detail::topic_table::instance().intern(str_);
+    interned_.store(result, std::memory_order_relaxed);
+  }
+  return result;
+}
+
+size_t topic::hash() const {
+  if (auto ptr = interned_.load(std::memory_order_relaxed))
+    return ptr->hash;
+  return std::hash<std::string>{}(str_);
+}
+
+bool topic::is_master_topic() const {
+  return (flags() & detail::master_topic_flag) != 0;
+}
+
+bool topic::is_clone_topic() const {
+  return (flags() & detail::clone_topic_flag) != 0;
+}
+
+uint8_t topic::flags() const {
+  if (auto ptr = interned())
+    return ptr->flags;
+  return detail::make_topic_flags(str_);
+}
+
 void topic::clean() {
   // Remove one or more separators at the end.
   while (!str_.empty() && str_.back() == sep)
@@ -62,6 +117,11 @@ void topic::clean() {
 }
 
 bool operator==(const topic& lhs, const topic& rhs) {
+  // Interned topics are equal if and only if they share the same entry.
+  auto x = lhs.interned_.load(std::memory_order_relaxed);
+  auto y = rhs.interned_.load(std::memory_order_relaxed);
+  if (x != nullptr && y != nullptr)
+    return x == y;
   return lhs.string() == rhs.string();
 }
 
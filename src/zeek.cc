@@ -0,0 +1,468 @@
+#include "broker/zeek.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "broker/detail/compact_coding.hh"
+
+namespace broker {
+namespace zeek {
+
+namespace {
+
+using ColumnType = LogWriteBatch::ColumnType;
+
+using detail::put_varint;
+using detail::unzig_zag;
+using detail::v4_mapped_prefix;
+using detail::zig_zag;
+
+/// Reads packed values from a column.
+struct column_reader {
+  const char* pos;
+  const char* last;
+
+  bool at_end() const {
+    return pos == last;
+  }
+
+  bool get(uint8_t& x) {
+    if (pos == last)
+      return false;
+    x = static_cast<uint8_t>(*pos++);
+    return true;
+  }
+
+  bool get_varint(uint64_t& x) {
+    auto next = detail::get_varint(pos, last, x);
+    if (next == nullptr)
+      return false;
+    pos = next;
+    return true;
+  }
+
+  bool get_bytes(uint8_t* dst, size_t n) {
+    if (static_cast<size_t>(last - pos) < n)
+      return false;
+    memcpy(dst, pos, n);
+    pos += n;
+    return true;
+  }
+};
+
+/// Maps a value to the column type that can store it.
+struct column_type_of {
+  using result_type = ColumnType;
+
+  ColumnType operator()(count) const {
+    return LogWriteBatch::Count;
+  }
+
+  ColumnType operator()(integer) const {
+    return LogWriteBatch::Integer;
+  }
+
+  ColumnType operator()(real) const {
+    return LogWriteBatch::Real;
+  }
+
+  ColumnType operator()(timestamp) const {
+    return LogWriteBatch::Timestamp;
+  }
+
+  ColumnType operator()(timespan) const {
+    return LogWriteBatch::Timespan;
+  }
+
+  ColumnType operator()(boolean) const {
+    return LogWriteBatch::Boolean;
+  }
+
+  ColumnType operator()(const address&) const {
+    return LogWriteBatch::Address;
+  }
+
+  ColumnType operator()(const port&) const {
+    return LogWriteBatch::Port;
+  }
+
+  ColumnType operator()(const std::string&) const {
+    return LogWriteBatch::String;
+  }
+
+  ColumnType operator()(const enum_value&) const {
+    return LogWriteBatch::Enum;
+  }
+
+  template <class T>
+  ColumnType operator()(const T&) const {
+    return LogWriteBatch::Generic;
+  }
+};
+
+/// Appends values of scalar columns to a string.
+struct column_writer {
+  using result_type = void;
+
+  std::string& buf;
+
+  void operator()(count x) {
+    put_varint(buf, x);
+  }
+
+  void operator()(integer x) {
+    put_varint(buf, zig_zag(x));
+  }
+
+  void operator()(real x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    for (int i = 0; i < 8; ++i)
+      buf += static_cast<char>(bits >> (i * 8));
+  }
+
+  void operator()(timestamp x) {
+    put_varint(buf, zig_zag(x.time_since_epoch().count()));
+  }
+
+  void operator()(timespan x) {
+    put_varint(buf, zig_zag(x.count()));
+  }
+
+  void operator()(boolean x) {
+    buf += x ? '\1' : '\0';
+  }
+
+  void operator()(const address& x) {
+    auto& bytes = x.bytes();
+    auto first = reinterpret_cast<const char*>(bytes.data());
+    if (x.is_v4()) {
+      buf += '\4';
+      buf.append(first + 12, 4);
+    } else {
+      buf += '\6';
+      buf.append(first, 16);
+    }
+  }
+
+  void operator()(const port& x) {
+    buf += static_cast<char>(x.type());
+    buf += static_cast<char>(x.number() >> 8);
+    buf += static_cast<char>(x.number());
+  }
+
+  template <class T>
+  void operator()(const T&) {
+    // Not a scalar column.
+  }
+};
+
+bool read_value(ColumnType type, column_reader& source, data& x) {
+  uint64_t value;
+  switch (type) {
+    case LogWriteBatch::Count:
+      if (!source.get_varint(value))
+        return false;
+      x = count{value};
+      return true;
+    case LogWriteBatch::Integer:
+      if (!source.get_varint(value))
+        return false;
+      x = integer{unzig_zag(value)};
+      return true;
+    case LogWriteBatch::Real: {
+      uint8_t bytes[8];
+      if (!source.get_bytes(bytes, 8))
+        return false;
+      uint64_t bits = 0;
+      for (int i = 0; i < 8; ++i)
+        bits |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+      real result;
+      memcpy(&result, &bits, sizeof(result));
+      x = result;
+      return true;
+    }
+    case LogWriteBatch::Timestamp:
+      if (!source.get_varint(value))
+        return false;
+      x = timestamp{timespan{unzig_zag(value)}};
+      return true;
+    case LogWriteBatch::Timespan:
+      if (!source.get_varint(value))
+        return false;
+      x = timespan{unzig_zag(value)};
+      return true;
+    case LogWriteBatch::Boolean: {
+      uint8_t flag;
+      if (!source.get(flag) || flag > 1)
+        return false;
+      x = flag == 1;
+      return true;
+    }
+    case LogWriteBatch::Address: {
+      uint8_t family;
+      address addr;
+      auto& bytes = addr.bytes();
+      if (!source.get(family))
+        return false;
+      if (family == 4) {
+        std::copy(std::begin(v4_mapped_prefix), std::end(v4_mapped_prefix),
+                  bytes.begin());
+        if (!source.get_bytes(bytes.data() + 12, 4))
+          return false;
+      } else if (family != 6 || !source.get_bytes(bytes.data(), 16)) {
+        return false;
+      }
+      x = addr;
+      return true;
+    }
+    case LogWriteBatch::Port: {
+      uint8_t bytes[3];
+      if (!source.get_bytes(bytes, 3)
+          || bytes[0] > static_cast<uint8_t>(port::protocol::icmp))
+        return false;
+      auto num = static_cast<port::number_type>((bytes[1] << 8) | bytes[2]);
+      x = port{num, static_cast<port::protocol>(bytes[0])};
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+bool is_null(const std::string& nulls, size_t row) {
+  if (nulls.empty())
+    return false;
+  return (static_cast<uint8_t>(nulls[row / 8]) & (1u << (row % 8))) != 0;
+}
+
+vector encode_column(const vector& records, size_t column) {
+  auto num_records = records.size();
+  std::string nulls;
+  auto type = LogWriteBatch::Generic;
+  auto first = true;
+  for (size_t row = 0; row < num_records; ++row) {
+    auto& x = caf::get<vector>(records[row])[column];
+    if (is<none>(x)) {
+      if (nulls.empty())
+        nulls.assign((num_records + 7) / 8, '\0');
+      nulls[row / 8] |= static_cast<char>(1u << (row % 8));
+      continue;
+    }
+    auto x_type = caf::visit(column_type_of{}, x);
+    if (first) {
+      type = x_type;
+      first = false;
+    } else if (x_type != type) {
+      type = LogWriteBatch::Generic;
+    }
+  }
+  data values;
+  switch (type) {
+    case LogWriteBatch::Generic: {
+      vector xs;
+      for (auto& record : records) {
+        auto& x = caf::get<vector>(record)[column];
+        if (!is<none>(x))
+          xs.emplace_back(x);
+      }
+      values = std::move(xs);
+      break;
+    }
+    case LogWriteBatch::String:
+    case LogWriteBatch::Enum: {
+      vector dict;
+      std::string indices;
+      std::unordered_map<std::string, count> ids;
+      for (auto& record : records) {
+        auto& x = caf::get<vector>(record)[column];
+        if (is<none>(x))
+          continue;
+        auto& str = type == LogWriteBatch::String
+                      ? caf::get<std::string>(x)
+                      : caf::get<enum_value>(x).name;
+        auto i = ids.find(str);
+        if (i == ids.end()) {
+          i = ids.emplace(str, dict.size()).first;
+          dict.emplace_back(str);
+        }
+        put_varint(indices, i->second);
+      }
+      values = vector{std::move(dict), std::move(indices)};
+      break;
+    }
+    default: {
+      std::string buf;
+      column_writer writer{buf};
+      for (auto& record : records) {
+        auto& x = caf::get<vector>(record)[column];
+        if (!is<none>(x))
+          caf::visit(writer, x);
+      }
+      values = std::move(buf);
+    }
+  }
+  return vector{count{static_cast<count>(type)}, std::move(nulls),
+                std::move(values)};
+}
+
+bool decode_column(const data& x, size_t column, vector& records) {
+  auto num_records = records.size();
+  auto xs = caf::get_if<vector>(&x);
+  if (xs == nullptr || xs->size() != 3)
+    return false;
+  auto type_ptr = caf::get_if<count>(&(*xs)[0]);
+  auto nulls = caf::get_if<std::string>(&(*xs)[1]);
+  if (type_ptr == nullptr || *type_ptr > LogWriteBatch::MAX_COLUMN_TYPE
+      || nulls == nullptr
+      || (!nulls->empty() && nulls->size() != (num_records + 7) / 8))
+    return false;
+  auto type = static_cast<ColumnType>(*type_ptr);
+  auto& values = (*xs)[2];
+  auto field = [&](size_t row) -> data& {
+    return caf::get<vector>(records[row])[column];
+  };
+  switch (type) {
+    case LogWriteBatch::Generic: {
+      auto vals = caf::get_if<vector>(&values);
+      if (vals == nullptr)
+        return false;
+      size_t pos = 0;
+      for (size_t row = 0; row < num_records; ++row) {
+        if (is_null(*nulls, row))
+          continue;
+        if (pos == vals->size())
+          return false;
+        field(row) = (*vals)[pos++];
+      }
+      return pos == vals->size();
+    }
+    case LogWriteBatch::String:
+    case LogWriteBatch::Enum: {
+      auto vals = caf::get_if<vector>(&values);
+      if (vals == nullptr || vals->size() != 2)
+        return false;
+      auto dict = caf::get_if<vector>(&(*vals)[0]);
+      auto indices = caf::get_if<std::string>(&(*vals)[1]);
+      if (dict == nullptr || indices == nullptr)
+        return false;
+      column_reader source{indices->data(),
+                           indices->data() + indices->size()};
+      for (size_t row = 0; row < num_records; ++row) {
+        if (is_null(*nulls, row))
+          continue;
+        uint64_t index;
+        if (!source.get_varint(index) || index >= dict->size())
+          return false;
+        auto str = caf::get_if<std::string>(&(*dict)[index]);
+        if (str == nullptr)
+          return false;
+        if (type == LogWriteBatch::String)
+          field(row) = *str;
+        else
+          field(row) = enum_value{*str};
+      }
+      return source.at_end();
+    }
+    default: {
+      auto buf = caf::get_if<std::string>(&values);
+      if (buf == nullptr)
+        return false;
+      column_reader source{buf->data(), buf->data() + buf->size()};
+      for (size_t row = 0; row < num_records; ++row)
+        if (!is_null(*nulls, row) && !read_value(type, source, field(row)))
+          return false;
+      return source.at_end();
+    }
+  }
+}
+
+/// Checks whether `column` can hold `num_records` rows before allocating
+/// memory for them. Each row takes at least one bit in the null mask or one
+/// element in the values.
+bool plausible(const data& column, count num_records) {
+  auto xs = caf::get_if<vector>(&column);
+  if (xs == nullptr || xs->size() != 3)
+    return false;
+  auto nulls = caf::get_if<std::string>(&(*xs)[1]);
+  if (nulls == nullptr)
+    return false;
+  if (!nulls->empty())
+    return nulls->size() == (num_records + 7) / 8;
+  auto& values = (*xs)[2];
+  if (auto vals = caf::get_if<std::string>(&values))
+    return vals->size() >= num_records;
+  if (auto vals = caf::get_if<vector>(&values)) {
+    if (vals->size() == 2)
+      if (auto indices = caf::get_if<std::string>(&(*vals)[1]))
+        return indices->size() >= num_records;
+    return vals->size() >= num_records;
+  }
+  return false;
+}
+
+/// Checks whether each column in `cols` can hold `num_records` rows.
+bool plausible(const vector& cols, count num_records) {
+  return !cols.empty()
+         && std::all_of(cols.begin(), cols.end(), [&](const data& column) {
+              return plausible(column, num_records);
+            });
+}
+
+/// Checks whether all records are vectors with the same number of fields.
+bool rectangular(const vector& records) {
+  auto first = caf::get_if<vector>(&records[0]);
+  if (first == nullptr)
+    return false;
+  auto width = first->size();
+  return std::all_of(records.begin(), records.end(), [&](const data& x) {
+    auto xs = caf::get_if<vector>(&x);
+    return xs != nullptr && xs->size() == width;
+  });
+}
+
+} // namespace
+
+bool LogWriteBatch::decode(vector& records) const {
+  if (!valid())
+    return false;
+  auto& cols = columns();
+  auto num_records = size();
+  if (num_records > 0 && !plausible(cols, num_records))
+    return false;
+  records.clear();
+  records.reserve(num_records);
+  for (count i = 0; i < num_records; ++i)
+    records.emplace_back(vector(cols.size()));
+  for (size_t column = 0; column < cols.size(); ++column)
+    if (!decode_column(cols[column], column, records))
+      return false;
+  return true;
+}
+
+std::vector<LogWrite> LogWriteBatch::unbatch() const {
+  std::vector<LogWrite> result;
+  vector records;
+  if (!decode(records))
+    return result;
+  result.reserve(records.size());
+  for (auto& record : records)
+    result.emplace_back(stream_id(), writer_id(), path(), std::move(record));
+  return result;
+}
+
+vector LogWriteBatch::encode(const vector& records) {
+  vector result;
+  if (records.empty() || !rectangular(records))
+    return result;
+  auto num_columns = caf::get<vector>(records[0]).size();
+  result.reserve(num_columns);
+  for (size_t column = 0; column < num_columns; ++column)
+    result.emplace_back(encode_column(records, column));
+  return result;
+}
+
+} // namespace zeek
+} // namespace broker
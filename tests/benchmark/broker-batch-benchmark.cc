@@ -0,0 +1,126 @@
+// Measures how many messages per second `core_policy::handle_batch` processes
+// for batches that arrive from a peer. The tool runs a core actor without any
+// network connection: fake peers subscribe to all topics but never consume
+// their streams, and the tool clears their buffers after each batch. Since all
+// peers run in the same process, forwarding does not serialize any data.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <caf/actor_system.hpp>
+#include <caf/behavior.hpp>
+#include <caf/event_based_actor.hpp>
+#include <caf/exit_reason.hpp>
+#include <caf/message.hpp>
+#include <caf/none.hpp>
+#include <caf/scoped_actor.hpp>
+#include <caf/stateful_actor.hpp>
+
+#include "broker/atoms.hh"
+#include "broker/configuration.hh"
+#include "broker/core_actor.hh"
+#include "broker/data.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using fsec = std::chrono::duration<double>;
+
+using peer_batch = detail::core_policy::peer_trait::batch;
+
+constexpr size_t batch_size = 100;
+
+constexpr caf::stream_slot inbound_slot = 1;
+
+caf::behavior fake_peer() {
+  return {
+    [](atom::ok) {
+      // nop
+    },
+  };
+}
+
+peer_batch make_batch(size_t num_topics) {
+  peer_batch result;
+  for (size_t i = 0; i < batch_size; ++i) {
+    auto t = topic{"benchmark/batch/" + std::to_string(i % num_topics)};
+    data x = vector{count{i}, std::string(64, 'x')};
+    result.emplace_back(make_node_message(make_data_message(t, x), 20));
+  }
+  return result;
+}
+
+caf::behavior bench_actor(caf::stateful_actor<core_state>* self) {
+  self->state.init(filter_type{}, broker_options{}, nullptr);
+  return {
+    [=](atom::run, const std::vector<caf::actor>& peers, size_t num_topics,
+        size_t rounds) {
+      auto& policy = self->state.policy();
+      for (auto& hdl : peers)
+        policy.start_peering<true>(hdl, filter_type{"benchmark"});
+      // Prepare all batches up front, since handle_batch modifies them.
+      std::vector<caf::message> batches;
+      batches.reserve(rounds);
+      for (size_t i = 0; i < rounds; ++i)
+        batches.emplace_back(caf::make_message(make_batch(num_topics)));
+      auto t0 = std::chrono::steady_clock::now();
+      for (auto& batch : batches) {
+        policy.handle_batch(inbound_slot, nullptr, batch);
+        for (auto& kvp : policy.peers().states())
+          kvp.second.buf.clear();
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      for (auto& hdl : peers)
+        policy.remove_peer(hdl, caf::none, true, false);
+      return std::chrono::duration_cast<fsec>(t1 - t0).count();
+    },
+  };
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t rounds = 10000;
+  if (argc > 1)
+    rounds = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (rounds == 0) {
+    std::cerr << "usage: " << argv[0] << " [rounds]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  configuration cfg;
+  caf::actor_system sys{cfg};
+  caf::scoped_actor self{sys};
+  std::cout << std::setw(8) << "peers" << std::setw(8) << "topics"
+            << std::setw(14) << "msgs/s" << std::endl;
+  for (size_t num_peers : {1, 4, 16}) {
+    std::vector<caf::actor> peers;
+    for (size_t i = 0; i < num_peers; ++i)
+      peers.emplace_back(sys.spawn(fake_peer));
+    for (size_t num_topics : {size_t{1}, size_t{10}, batch_size}) {
+      auto bench = sys.spawn(bench_actor);
+      self->request(bench, caf::infinite, atom::run::value, peers,
+                    num_topics, rounds)
+      .receive(
+        [&](double seconds) {
+          std::cout << std::setw(8) << num_peers << std::setw(8) << num_topics
+                    << std::setw(14) << std::fixed << std::setprecision(0)
+                    << (rounds * batch_size) / seconds << std::endl;
+        },
+        [&](caf::error& err) {
+          std::cerr << "*** benchmark failed: " << sys.render(err)
+                    << std::endl;
+        });
+      self->send_exit(bench, caf::exit_reason::user_shutdown);
+    }
+    for (auto& hdl : peers)
+      self->send_exit(hdl, caf::exit_reason::user_shutdown);
+  }
+  return EXIT_SUCCESS;
+}
@@ -37,6 +37,7 @@ uint64_t max_received = 0;
 uint64_t max_in_flight = 0;
 bool server = false;
 bool verbose = false;
+bool unix_socket = false;
 
 // Global state
 unsigned long total_recv;
@@ -234,7 +235,8 @@ void client_mode(endpoint& ep, const std::string& host, int port) {
   if (verbose)
     std::cout << "*** init peering: host = " << host << ", port = " << port
               << std::endl;
-  auto res = ep.peer(host, port, timeout::seconds(1));
+  auto res = unix_socket ? ep.peer_unix(host, timeout::seconds(1))
+                         : ep.peer(host, port, timeout::seconds(1));
   if (!res) {
     std::cerr << "unable to peer to " << host << " on port " << port
               << std::endl;
@@ -318,7 +320,10 @@ void server_mode(endpoint& ep, const std::string& iface, int port) {
       // nop
     });
   // Start listening for peers.
-  ep.listen(iface, port);
+  if (unix_socket)
+    ep.listen_unix(iface);
+  else
+    ep.listen(iface, port);
   // Collects stats once per second until receiving stop message.
   using std::chrono::duration_cast;
   timestamp timeout = std::chrono::system_clock::now();
@@ -370,6 +375,8 @@ void usage(const config& cfg, const char* cmd_name) {
   std::cerr << "Usage: " << cmd_name
             << " [<options>] <zeek-host>[:<port>] | [--disable-ssl] --server "
                "<interface>:port\n\n"
+               "Passing unix:<path> instead of <host>:<port> peers via the "
+               "Unix domain socket at <path>.\n\n"
             << cfg.help_text();
 }
 
@@ -399,9 +406,14 @@ int main(int argc, char** argv) {
   }
   std::string host = arg.substr(0, separator);
   uint16_t port = 9999;
+  if (host == "unix") {
+    unix_socket = true;
+    host = arg.substr(separator + 1);
+    port = 0;
+  }
   try {
     auto str_port = arg.substr(separator + 1);
-    if (!str_port.empty()) {
+    if (!unix_socket && !str_port.empty()) {
       auto int_port = std::stoi(str_port);
       if (int_port < 0 || int_port > std::numeric_limits<uint16_t>::max())
         throw std::out_of_range("not an uint16_t");
@@ -0,0 +1,154 @@
+// Compares the binary serializer of CAF with the compact codec for ::data in
+// terms of encoded size and time per encode/decode roundtrip.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+
+#include "broker/convert.hh"
+#include "broker/data.hh"
+#include "broker/detail/data_codec.hh"
+#include "broker/zeek.hh"
+
+using namespace broker;
+
+namespace {
+
+using fsec = std::chrono::duration<double>;
+
+address make_address(const char* str) {
+  address result;
+  convert(str, result);
+  return result;
+}
+
+// Resembles a line in conn.log.
+data make_conn_log() {
+  return vector{
+    timestamp{timespan{1564000000123456789}},
+    "CHhAvVGS1DHFjwGM9",
+    vector{make_address("1.2.3.4"), port{4567, port::protocol::tcp},
+           make_address("3.4.5.6"), port{80, port::protocol::tcp}},
+    enum_value{"tcp"},
+    "http",
+    timespan{3140000000},
+    count{73},
+    count{1024},
+    "SF",
+    true,
+    false,
+    count{0},
+    "ShADadFf",
+    count{7},
+    count{445},
+    count{5},
+    count{1293},
+    set{"CiKBhB3rVDLjrwIpVh", "CxXtTq4IN2m4ZE2ZCl"},
+  };
+}
+
+// Ships 100 conn.log entries as individual log writes in a single batch.
+data make_log_writes() {
+  vector writes;
+  for (int i = 0; i < 100; ++i)
+    writes.emplace_back(zeek::LogWrite{enum_value{"Conn::LOG"},
+                                       enum_value{"Log::WRITER_ASCII"},
+                                       "conn", make_conn_log()});
+  return zeek::Batch{std::move(writes)};
+}
+
+// Ships 100 conn.log entries as columnar batch.
+data make_log_write_batch() {
+  vector records;
+  for (int i = 0; i < 100; ++i)
+    records.emplace_back(make_conn_log());
+  return zeek::LogWriteBatch{enum_value{"Conn::LOG"},
+                             enum_value{"Log::WRITER_ASCII"}, "conn", records};
+}
+
+data make_table() {
+  table result;
+  for (integer i = 0; i < 100; ++i) {
+    set xs;
+    for (integer j = 0; j < 10; ++j)
+      xs.emplace(i * 10 + j);
+    result.emplace(std::to_string(i), std::move(xs));
+  }
+  return result;
+}
+
+template <class Encode, class Decode>
+void run(const char* name, const data& x, size_t rounds, Encode encode,
+         Decode decode) {
+  std::vector<char> buf;
+  encode(x, buf);
+  auto size = buf.size();
+  data y;
+  if (!decode(buf, y) || x != y) {
+    std::cerr << "*** " << name << " failed to reproduce its input"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rounds; ++i) {
+    buf.clear();
+    encode(x, buf);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rounds; ++i)
+    decode(buf, y);
+  auto t2 = std::chrono::steady_clock::now();
+  auto ns = [&](fsec dt) { return dt.count() * 1e9 / rounds; };
+  std::cout << std::setw(10) << name << std::setw(10) << size << std::setw(14)
+            << std::fixed << std::setprecision(1)
+            << ns(std::chrono::duration_cast<fsec>(t1 - t0)) << std::setw(14)
+            << ns(std::chrono::duration_cast<fsec>(t2 - t1)) << std::endl;
+}
+
+void run(const char* title, const data& x, size_t rounds) {
+  std::cout << title << std::endl;
+  run("binary", x, rounds,
+      [](const data& x, std::vector<char>& buf) {
+        caf::binary_serializer sink{nullptr, buf};
+        sink(const_cast<data&>(x));
+      },
+      [](const std::vector<char>& buf, data& x) {
+        caf::binary_deserializer source{nullptr, buf.data(), buf.size()};
+        return !source(x);
+      });
+  run("compact", x, rounds,
+      [](const data& x, std::vector<char>& buf) {
+        detail::compact_encode(x, buf);
+      },
+      [](const std::vector<char>& buf, data& x) {
+        return detail::compact_decode(buf.data(), buf.size(), x);
+      });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t rounds = 100000;
+  if (argc > 1)
+    rounds = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (rounds == 0) {
+    std::cerr << "usage: " << argv[0] << " [rounds]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::setw(10) << "codec" << std::setw(10) << "bytes"
+            << std::setw(14) << "encode (ns)" << std::setw(14) << "decode (ns)"
+            << std::endl;
+  run("small event:", vector{count{42}, "test"}, rounds);
+  run("conn.log entry:", make_conn_log(), rounds);
+  run("large table:", make_table(), rounds / 100 + 1);
+  run("100 log writes:", make_log_writes(), rounds / 100 + 1);
+  run("100 log writes (columnar):", make_log_write_batch(),
+      rounds / 100 + 1);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+// Measures the latency between publishing a message and a blocked subscriber
+// receiving it. Each run uses a different busy-poll window for the subscriber,
+// starting with 0 (always block on the flare).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/endpoint.hh"
+#include "broker/subscriber.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using usec = std::chrono::duration<double, std::micro>;
+
+/// Pause between two messages, giving the subscriber time to go idle.
+constexpr auto pause = std::chrono::microseconds(200);
+
+const topic bench_topic{"benchmark/latency"};
+
+count now() {
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return static_cast<count>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(t).count());
+}
+
+std::vector<double> run(timespan busy_poll, size_t num_messages) {
+  broker_options opts;
+  opts.disable_ssl = true;
+  configuration cfg{opts};
+  endpoint ep{std::move(cfg)};
+  auto sub = ep.make_subscriber({bench_topic});
+  sub.set_busy_poll(busy_poll);
+  std::atomic<size_t> received{0};
+  std::thread producer{[&] {
+    for (size_t i = 0; i < num_messages; ++i) {
+      std::this_thread::sleep_for(pause);
+      ep.publish(bench_topic, now());
+      while (received.load() <= i)
+        std::this_thread::yield();
+    }
+  }};
+  std::vector<double> result;
+  result.reserve(num_messages);
+  for (size_t i = 0; i < num_messages; ++i) {
+    auto x = sub.get();
+    auto t = now();
+    auto dt = std::chrono::nanoseconds(t - get<count>(get_data(x)));
+    result.emplace_back(std::chrono::duration_cast<usec>(dt).count());
+    ++received;
+  }
+  producer.join();
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+double percentile(const std::vector<double>& xs, double p) {
+  auto index = static_cast<size_t>(p * (xs.size() - 1));
+  return xs[index];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t num_messages = 10000;
+  if (argc > 1)
+    num_messages = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (num_messages == 0) {
+    std::cerr << "usage: " << argv[0] << " [messages]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::setw(14) << "busy-poll (us)" << std::setw(12) << "p50 (us)"
+            << std::setw(12) << "p99 (us)" << std::setw(12) << "max (us)"
+            << std::endl;
+  for (auto window : {0, 50, 1000}) {
+    auto xs = run(std::chrono::microseconds(window), num_messages);
+    std::cout << std::setw(14) << window << std::setw(12) << std::fixed
+              << std::setprecision(1) << percentile(xs, 0.5) << std::setw(12)
+              << percentile(xs, 0.99) << std::setw(12) << xs.back()
+              << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
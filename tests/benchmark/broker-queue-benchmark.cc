@@ -0,0 +1,162 @@
+// Measures the throughput of the queues between publishers or subscribers and
+// their background workers. Each run compares the mutex-based queues with the
+// lock-free queues. For subscriber queues, the tool also measures a plain
+// `moodycamel::ReaderWriterQueue` without any flare as a lower bound.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broker/data.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+#include "broker/detail/lock_free_publisher_queue.hh"
+#include "broker/detail/lock_free_subscriber_queue.hh"
+#include "broker/detail/shared_publisher_queue.hh"
+#include "broker/detail/shared_subscriber_queue.hh"
+
+#include "readerwriterqueue/readerwriterqueue.h"
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+using fsec = std::chrono::duration<double>;
+
+/// Number of messages the worker of a subscriber produces at once.
+constexpr size_t produce_batch = 50;
+
+/// Number of messages a subscriber or worker consumes at once.
+constexpr size_t consume_batch = 100;
+
+/// Capacity of publisher queues (same as in `publisher.cc`).
+constexpr size_t publisher_capacity = 30;
+
+const topic bench_topic{"benchmark/queue"};
+
+template <class F>
+double measure(F f) {
+  auto t0 = std::chrono::steady_clock::now();
+  f();
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<fsec>(t1 - t0).count();
+}
+
+// Mimics a subscriber: one worker produces batches and one user thread
+// blocks on the flare.
+template <class Queue>
+double run_subscriber(Queue& q, size_t num_messages) {
+  return measure([&] {
+    std::thread producer{[&] {
+      std::vector<data_message> xs;
+      for (size_t i = 0; i < num_messages;) {
+        xs.clear();
+        for (size_t j = 0; j < produce_batch && i < num_messages; ++j, ++i)
+          xs.emplace_back(bench_topic, data{count{i}});
+        q.produce(xs.size(), std::make_move_iterator(xs.begin()),
+                  std::make_move_iterator(xs.end()));
+      }
+    }};
+    size_t received = 0;
+    while (received < num_messages) {
+      q.wait_on_flare();
+      received += q.consume(consume_batch, nullptr, [](data_message&&) {});
+    }
+    producer.join();
+  });
+}
+
+double run_reader_writer_queue(size_t num_messages) {
+  moodycamel::ReaderWriterQueue<data_message> q{consume_batch};
+  return measure([&] {
+    std::thread producer{[&] {
+      for (size_t i = 0; i < num_messages; ++i)
+        q.enqueue(data_message{bench_topic, data{count{i}}});
+    }};
+    data_message x{bench_topic, data{}};
+    for (size_t received = 0; received < num_messages;)
+      if (q.try_dequeue(x))
+        ++received;
+    producer.join();
+  });
+}
+
+// Mimics publishers: any number of user threads produce single messages and
+// one worker pulls them out of the queue.
+template <class Queue>
+double run_publisher(Queue& q, size_t num_producers, size_t num_messages) {
+  auto per_producer = num_messages / num_producers;
+  return measure([&] {
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < num_producers; ++i)
+      producers.emplace_back([&] {
+        for (size_t j = 0; j < per_producer; ++j)
+          q.produce(bench_topic, data{count{j}});
+      });
+    auto total = per_producer * num_producers;
+    size_t received = 0;
+    while (received < total) {
+      auto n = q.consume(consume_batch, [](data_message&&) {});
+      if (n == 0)
+        std::this_thread::yield();
+      received += n;
+    }
+    for (auto& t : producers)
+      t.join();
+  });
+}
+
+void print_row(const std::string& queue, size_t threads, size_t num_messages,
+               double seconds) {
+  std::cout << std::setw(22) << queue << std::setw(10) << threads
+            << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+            << std::setw(14) << std::setprecision(0) << num_messages / seconds
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t num_messages = 1000000;
+  if (argc > 1)
+    num_messages = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (num_messages == 0) {
+    std::cerr << "usage: " << argv[0] << " [messages]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::setw(22) << "queue" << std::setw(10) << "producers"
+            << std::setw(12) << "seconds" << std::setw(14) << "msgs/s"
+            << std::endl;
+  {
+    shared_subscriber_queue<> q;
+    print_row("mutex subscriber", 1, num_messages,
+              run_subscriber(q, num_messages));
+  }
+  {
+    lock_free_subscriber_queue<> q{consume_batch};
+    print_row("lock-free subscriber", 1, num_messages,
+              run_subscriber(q, num_messages));
+  }
+  print_row("readerwriterqueue", 1, num_messages,
+            run_reader_writer_queue(num_messages));
+  for (size_t num_producers : {1, 2, 4}) {
+    {
+      shared_publisher_queue<> q{publisher_capacity};
+      print_row("mutex publisher", num_producers, num_messages,
+                run_publisher(q, num_producers, num_messages));
+    }
+    {
+      lock_free_publisher_queue<> q{publisher_capacity};
+      print_row("lock-free publisher", num_producers, num_messages,
+                run_publisher(q, num_producers, num_messages));
+    }
+  }
+  return EXIT_SUCCESS;
+}
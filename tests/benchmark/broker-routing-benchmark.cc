@@ -0,0 +1,93 @@
+// Compares the linear filter scan of the prefix_matcher with the routing table
+// of the core actor by sweeping over the number of peers and the number of
+// prefixes per peer.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "broker/detail/prefix_matcher.hh"
+#include "broker/detail/routing_table.hh"
+#include "broker/filter_type.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using fsec = std::chrono::duration<double>;
+
+/// Produces the `j`-th prefix of peer `i`.
+std::string make_prefix(size_t i, size_t j) {
+  return "zeek/peer-" + std::to_string(i) + "/topic-" + std::to_string(j);
+}
+
+/// Produces topics that hit roughly every other peer.
+std::vector<topic> make_topics(size_t num_peers, size_t num_prefixes) {
+  std::vector<topic> result;
+  for (size_t i = 0; i < num_peers; i += 2)
+    result.emplace_back(make_prefix(i, i % num_prefixes) + "/events");
+  result.emplace_back("zeek/unknown/topic");
+  return result;
+}
+
+template <class F>
+double measure(size_t rounds, const std::vector<topic>& topics, F f) {
+  size_t hits = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round)
+    for (auto& t : topics)
+      hits += f(t);
+  auto t1 = std::chrono::steady_clock::now();
+  if (hits == 0)
+    std::cerr << "*** no topic matched any peer" << std::endl;
+  auto num_lookups = static_cast<double>(rounds * topics.size());
+  return std::chrono::duration_cast<fsec>(t1 - t0).count() * 1e9 / num_lookups;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t rounds = 1000;
+  if (argc > 1)
+    rounds = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (rounds == 0) {
+    std::cerr << "usage: " << argv[0] << " [rounds]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::setw(8) << "peers" << std::setw(10) << "prefixes"
+            << std::setw(16) << "linear (ns)" << std::setw(16) << "trie (ns)"
+            << std::endl;
+  for (size_t num_peers : {1, 4, 16, 64, 256}) {
+    for (size_t num_prefixes : {1, 10, 100}) {
+      std::vector<filter_type> filters;
+      detail::routing_table tbl;
+      for (size_t i = 0; i < num_peers; ++i) {
+        filter_type filter;
+        for (size_t j = 0; j < num_prefixes; ++j)
+          filter.emplace_back(make_prefix(i, j));
+        tbl.set(static_cast<caf::stream_slot>(i + 1), filter);
+        filters.emplace_back(std::move(filter));
+      }
+      auto topics = make_topics(num_peers, num_prefixes);
+      detail::prefix_matcher matcher;
+      auto linear = measure(rounds, topics, [&](const topic& t) {
+        size_t result = 0;
+        for (auto& filter : filters)
+          if (matcher(filter, t))
+            ++result;
+        return result;
+      });
+      auto trie = measure(rounds, topics, [&](const topic& t) {
+        return tbl.match(t).size();
+      });
+      std::cout << std::setw(8) << num_peers << std::setw(10) << num_prefixes
+                << std::setw(16) << std::fixed << std::setprecision(1) << linear
+                << std::setw(16) << trie << std::endl;
+    }
+  }
+  return EXIT_SUCCESS;
+}
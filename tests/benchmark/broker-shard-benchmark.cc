@@ -0,0 +1,117 @@
+// Measures end-to-end throughput between two endpoints in the same process
+// with an increasing number of core shards, first with all shards sharing a
+// single connection and then with one connection per shard (peer stripes).
+// The tool also verifies that each topic arrives in publishing order
+// regardless of the number of shards.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/endpoint.hh"
+#include "broker/publisher.hh"
+#include "broker/subscriber.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using fsec = std::chrono::duration<double>;
+
+constexpr size_t num_topics = 16;
+
+constexpr size_t batch_size = 100;
+
+configuration make_config(size_t num_shards, bool striped) {
+  broker_options opts;
+  opts.disable_ssl = true;
+  configuration cfg{opts};
+  cfg.set(striped ? "broker.peer-stripes" : "broker.core-shards", num_shards);
+  return cfg;
+}
+
+topic make_topic(size_t i) {
+  return topic{"benchmark/shards/topic-" + std::to_string(i)};
+}
+
+struct result {
+  double seconds;
+  size_t reordered;
+};
+
+result run(size_t num_shards, bool striped, size_t num_messages) {
+  endpoint server{make_config(num_shards, striped)};
+  endpoint client{make_config(num_shards, striped)};
+  auto sub = server.make_subscriber({"benchmark/shards"}, 1000);
+  auto port = server.listen("127.0.0.1", 0);
+  if (port == 0 || !client.peer("127.0.0.1", port, timeout::seconds{0})) {
+    std::cerr << "*** unable to peer endpoints" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  while (client.peer_subscriptions().empty())
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::vector<publisher> pubs;
+  pubs.reserve(num_topics);
+  for (size_t i = 0; i < num_topics; ++i)
+    pubs.emplace_back(client.make_publisher(make_topic(i)));
+  std::vector<count> next(num_topics, 0);
+  size_t received = 0;
+  size_t reordered = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread producer{[&] {
+    auto per_topic = num_messages / num_topics;
+    for (count seq = 0; seq < per_topic; seq += batch_size)
+      for (size_t i = 0; i < num_topics; ++i) {
+        std::vector<data> xs;
+        for (count j = seq; j < seq + batch_size && j < per_topic; ++j)
+          xs.emplace_back(vector{count{i}, j});
+        pubs[i].publish(std::move(xs));
+      }
+  }};
+  auto total = (num_messages / num_topics) * num_topics;
+  while (received < total) {
+    for (auto& x : sub.get(batch_size, std::chrono::seconds(1))) {
+      auto& xs = get<vector>(get_data(x));
+      auto i = static_cast<size_t>(get<count>(xs[0]));
+      if (get<count>(xs[1]) != next[i])
+        ++reordered;
+      next[i] = get<count>(xs[1]) + 1;
+      ++received;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  producer.join();
+  return {std::chrono::duration_cast<fsec>(t1 - t0).count(), reordered};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t num_messages = 1000000;
+  if (argc > 1)
+    num_messages = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (num_messages < num_topics) {
+    std::cerr << "usage: " << argv[0] << " [messages]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::setw(8) << "mode" << std::setw(8) << "shards"
+            << std::setw(14) << "seconds" << std::setw(14) << "msgs/s"
+            << std::setw(12) << "reordered" << std::endl;
+  for (auto striped : {false, true})
+    for (size_t num_shards : {1, 2, 4, 8}) {
+      auto res = run(num_shards, striped, num_messages);
+      std::cout << std::setw(8) << (striped ? "stripes" : "shards")
+                << std::setw(8) << num_shards << std::setw(14) << std::fixed
+                << std::setprecision(3) << res.seconds << std::setw(14)
+                << std::setprecision(0) << num_messages / res.seconds
+                << std::setw(12) << res.reordered << std::endl;
+    }
+  return EXIT_SUCCESS;
+}
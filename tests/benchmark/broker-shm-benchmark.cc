@@ -0,0 +1,148 @@
+// Compares peering over loopback TCP with peering over shared memory. The
+// tool runs two endpoints in the same process, measures the throughput from
+// one endpoint to the other and then the round-trip time of ping-pong
+// messages. Both endpoints still use separate actor systems, i.e., all
+// messages pass through serialization and the selected transport.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/endpoint.hh"
+#include "broker/publisher.hh"
+#include "broker/subscriber.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+using fsec = std::chrono::duration<double>;
+
+using usec = std::chrono::duration<double, std::micro>;
+
+constexpr size_t batch_size = 100;
+
+constexpr size_t num_pings = 10000;
+
+constexpr uint16_t shm_port = 4711;
+
+const topic data_topic{"benchmark/shm/data"};
+
+const topic ping_topic{"benchmark/shm/ping"};
+
+const topic pong_topic{"benchmark/shm/pong"};
+
+configuration make_config() {
+  broker_options opts;
+  opts.disable_ssl = true;
+  return configuration{opts};
+}
+
+struct result {
+  double seconds;
+  double rtt_p50;
+  double rtt_p99;
+};
+
+void connect(endpoint& server, endpoint& client, const std::string& addr) {
+  auto port = server.listen(addr, addr == "127.0.0.1" ? 0 : shm_port);
+  if (port == 0 || !client.peer(addr, port, timeout::seconds{0})) {
+    std::cerr << "*** unable to peer endpoints via " << addr << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void await_subscriptions(endpoint& ep, size_t n) {
+  while (ep.peer_subscriptions().size() < n)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+double run_throughput(const std::string& addr, size_t num_messages) {
+  endpoint server{make_config()};
+  endpoint client{make_config()};
+  auto sub = server.make_subscriber({data_topic}, 1000);
+  connect(server, client, addr);
+  await_subscriptions(client, 1);
+  auto pub = client.make_publisher(data_topic);
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread producer{[&] {
+    for (size_t i = 0; i < num_messages; i += batch_size) {
+      std::vector<data> xs;
+      for (size_t j = i; j < i + batch_size && j < num_messages; ++j)
+        xs.emplace_back(vector{count{j}, std::string(64, 'x')});
+      pub.publish(std::move(xs));
+    }
+  }};
+  size_t received = 0;
+  while (received < num_messages)
+    received += sub.get(batch_size, std::chrono::seconds(1)).size();
+  auto t1 = std::chrono::steady_clock::now();
+  producer.join();
+  return std::chrono::duration_cast<fsec>(t1 - t0).count();
+}
+
+std::vector<double> run_ping_pong(const std::string& addr) {
+  endpoint server{make_config()};
+  endpoint client{make_config()};
+  auto pings = server.make_subscriber({ping_topic});
+  auto pongs = client.make_subscriber({pong_topic});
+  connect(server, client, addr);
+  await_subscriptions(client, 1);
+  await_subscriptions(server, 1);
+  std::thread responder{[&] {
+    for (size_t i = 0; i < num_pings; ++i)
+      server.publish(pong_topic, get_data(pings.get()));
+  }};
+  std::vector<double> result;
+  result.reserve(num_pings);
+  for (size_t i = 0; i < num_pings; ++i) {
+    auto t0 = std::chrono::steady_clock::now();
+    client.publish(ping_topic, count{i});
+    pongs.get();
+    auto t1 = std::chrono::steady_clock::now();
+    result.emplace_back(std::chrono::duration_cast<usec>(t1 - t0).count());
+  }
+  responder.join();
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+result run(const std::string& addr, size_t num_messages) {
+  auto seconds = run_throughput(addr, num_messages);
+  auto rtts = run_ping_pong(addr);
+  return {seconds, rtts[rtts.size() / 2], rtts[rtts.size() * 99 / 100]};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t num_messages = 1000000;
+  if (argc > 1)
+    num_messages = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (num_messages == 0) {
+    std::cerr << "usage: " << argv[0] << " [messages]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::setw(12) << "transport" << std::setw(12) << "seconds"
+            << std::setw(14) << "msgs/s" << std::setw(14) << "rtt p50 (us)"
+            << std::setw(14) << "rtt p99 (us)" << std::endl;
+  for (auto addr : {"127.0.0.1", "shm://broker-shm-benchmark"}) {
+    auto res = run(addr, num_messages);
+    std::cout << std::setw(12)
+              << (std::string{addr} == "127.0.0.1" ? "tcp" : "shm")
+              << std::setw(12) << std::fixed << std::setprecision(3)
+              << res.seconds << std::setw(14) << std::setprecision(0)
+              << num_messages / res.seconds << std::setw(14)
+              << std::setprecision(1) << res.rtt_p50 << std::setw(14)
+              << res.rtt_p99 << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
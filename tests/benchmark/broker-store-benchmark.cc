@@ -0,0 +1,92 @@
+// Measures how many updates per second a master store with a SQLite backend
+// applies. Each run uses a different combination of SQLite journal mode,
+// `synchronous` level and group commit setting. All updates originate at the
+// frontend of the master, i.e., they arrive at the master as local commands.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "broker/backend.hh"
+#include "broker/backend_options.hh"
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/detail/filesystem.hh"
+#include "broker/endpoint.hh"
+#include "broker/store.hh"
+
+using namespace broker;
+
+namespace {
+
+using fsec = std::chrono::duration<double>;
+
+constexpr char db_path[] = "/tmp/broker-store-benchmark.sqlite";
+
+struct setting {
+  const char* journal_mode;
+  const char* synchronous;
+  size_t group_commit_size;
+};
+
+double run(const setting& x, size_t num_updates) {
+  detail::remove_all(db_path);
+  detail::remove_all(std::string{db_path} + "-wal");
+  detail::remove_all(std::string{db_path} + "-shm");
+  broker_options opts;
+  opts.disable_ssl = true;
+  configuration cfg{opts};
+  cfg.set("broker.group-commit-size", x.group_commit_size);
+  endpoint ep{std::move(cfg)};
+  backend_options bopts{{"path", db_path},
+                        {"journal_mode", x.journal_mode},
+                        {"synchronous", x.synchronous}};
+  auto ds = ep.attach_master("benchmark", sqlite, std::move(bopts));
+  if (!ds) {
+    std::cerr << "*** unable to attach master: " << to_string(ds.error())
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_updates; ++i)
+    ds->put(count{i}, vector{count{i}, std::string(64, 'x')});
+  // The master processes its mailbox in order, i.e., the get returns after
+  // the master has applied all updates.
+  if (!ds->get(count{num_updates - 1})) {
+    std::cerr << "*** master lost updates" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<fsec>(t1 - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t num_updates = 5000;
+  if (argc > 1)
+    num_updates = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+  if (num_updates == 0) {
+    std::cerr << "usage: " << argv[0] << " [updates]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::setw(10) << "journal" << std::setw(14) << "synchronous"
+            << std::setw(14) << "group commit" << std::setw(14) << "updates/s"
+            << std::endl;
+  for (auto journal_mode : {"delete", "wal"})
+    for (auto synchronous : {"full", "normal", "off"})
+      for (size_t group_commit_size : {0, 1000}) {
+        setting x{journal_mode, synchronous, group_commit_size};
+        auto seconds = run(x, num_updates);
+        std::cout << std::setw(10) << journal_mode << std::setw(14)
+                  << synchronous << std::setw(14) << group_commit_size
+                  << std::setw(14) << std::fixed << std::setprecision(0)
+                  << num_updates / seconds << std::endl;
+      }
+  detail::remove_all(db_path);
+  detail::remove_all(std::string{db_path} + "-wal");
+  detail::remove_all(std::string{db_path} + "-shm");
+  return EXIT_SUCCESS;
+}
@@ -16,10 +16,14 @@
 #include <utility>
 #include <vector>
 
+#include "sqlite3.h"
+
 #include "broker/backend_options.hh"
+#include "broker/config.hh"
 #include "broker/data.hh"
 #include "broker/detail/abstract_backend.hh"
 #include "broker/detail/assert.hh"
+#include "broker/detail/blob.hh"
 #include "broker/detail/filesystem.hh"
 #include "broker/detail/make_backend.hh"
 #include "broker/detail/memory_backend.hh"
@@ -116,6 +120,15 @@ public:
     );
   }
 
+  expected<std::vector<data>> bulk_expire(const std::vector<data>& keys,
+                                          timestamp ts) override {
+    return perform<std::vector<data>>(
+      [&](detail::abstract_backend& backend) {
+        return backend.bulk_expire(keys, ts);
+      }
+    );
+  }
+
   expected<data> get(const data& key) const override {
     return perform<data>(
       [&](detail::abstract_backend& backend) {
@@ -164,6 +177,30 @@ public:
     );
   }
 
+  expected<detail::snapshot_cursor_ptr> cursor() const override {
+    // Make sure that the cursors of all backends produce the same content,
+    // even when reading a single key-value pair at a time.
+    auto ss = perform<broker::snapshot>(
+      [](detail::abstract_backend& backend) -> expected<broker::snapshot> {
+        auto c = backend.cursor();
+        if (!c)
+          return c.error();
+        std::vector<snapshot_entry> xs;
+        for (;;) {
+          auto more = (*c)->next(xs, 1);
+          if (!more)
+            return more.error();
+          if (!*more)
+            break;
+        }
+        return broker::snapshot{xs.begin(), xs.end()};
+      }
+    );
+    if (!ss)
+      return ss.error();
+    return abstract_backend::cursor();
+  }
+
   expected<broker::detail::expirables> expiries() const override {
     return perform<broker::detail::expirables>(
       [](detail::abstract_backend& backend) {
@@ -250,9 +287,6 @@ TEST(add/remove) {
   REQUIRE(get);
   CHECK_EQUAL(*get, data{44});
   MESSAGE("remove");
-  remove = backend->subtract("foo", "bar");
-  REQUIRE(!remove);
-  CHECK_EQUAL(remove, ec::type_clash);
   remove = backend->subtract("foo", 10);
   REQUIRE(remove);
   get = backend->get("foo");
@@ -260,6 +294,24 @@ TEST(add/remove) {
   CHECK_EQUAL(*get, data{34});
 }
 
+TEST(repeated adds) {
+  for (count i = 0; i < 10; ++i)
+    REQUIRE(backend->add("cnt", i, data::type::count));
+  auto get = backend->get("cnt");
+  REQUIRE(get);
+  CHECK_EQUAL(*get, data{count{45}});
+  REQUIRE(backend->add("xs", count{1}, data::type::set));
+  REQUIRE(backend->add("xs", count{2}, data::type::set));
+  REQUIRE(backend->add("xs", count{1}, data::type::set));
+  get = backend->get("xs");
+  REQUIRE(get);
+  CHECK_EQUAL(*get, data{set{count{1}, count{2}}});
+  REQUIRE(backend->subtract("xs", count{1}));
+  get = backend->get("xs");
+  REQUIRE(get);
+  CHECK_EQUAL(*get, data{set{count{2}}});
+}
+
 TEST(erase/exists) {
   using namespace std::chrono;
   auto exists = backend->exists("foo");
@@ -330,6 +382,20 @@ TEST(expiration without expiry) {
   REQUIRE(!*expire); // no expiry with key associated
 }
 
+TEST(bulk expiration) {
+  auto t0 = broker::now();
+  REQUIRE(backend->put("foo", 1, t0));
+  REQUIRE(backend->put("bar", 2, t0 + std::chrono::hours(1)));
+  REQUIRE(backend->put("baz", 3));
+  std::vector<data> keys{"foo", "bar", "baz", "qux"};
+  auto expired = backend->bulk_expire(keys, t0);
+  REQUIRE(expired);
+  CHECK_EQUAL(*expired, std::vector<data>{"foo"});
+  auto size = backend->size();
+  REQUIRE(size);
+  CHECK_EQUAL(*size, 2u);
+}
+
 TEST(size/snapshot) {
   using namespace std::chrono;
   auto put = backend->put("foo", "bar");
@@ -347,4 +413,240 @@ TEST(size/snapshot) {
   CHECK_EQUAL(ss->count("foo"), 1u);
 }
 
+TEST(cursor) {
+  for (auto i = 0; i < 10; ++i) {
+    auto put = backend->put(i, i * 2);
+    REQUIRE(put);
+  }
+  auto c = backend->cursor();
+  REQUIRE(c);
+  std::vector<snapshot_entry> xs;
+  auto more = (*c)->next(xs, 4);
+  REQUIRE(more);
+  CHECK(*more);
+  CHECK_EQUAL(xs.size(), 4u);
+  more = (*c)->next(xs, 100);
+  REQUIRE(more);
+  CHECK(!*more);
+  CHECK_EQUAL(xs.size(), 10u);
+  auto ss = backend->snapshot();
+  REQUIRE(ss);
+  CHECK_EQUAL(broker::snapshot(xs.begin(), xs.end()), *ss);
+}
+
 FIXTURE_SCOPE_END()
+
+TEST(type clashes) {
+  auto path = std::string{"/tmp/broker-unit-test-type-clashes"};
+  detail::remove_all(path);
+  auto check = [&](backend type, bool reports_clashes) {
+    auto b = detail::make_backend(type, backend_options{{"path", path}});
+    REQUIRE(b->put("foo", 42));
+    auto add = b->add("foo", "bar", data::type::integer);
+    auto remove = b->subtract("foo", "bar");
+    if (reports_clashes) {
+      CHECK_EQUAL(add, ec::type_clash);
+      CHECK_EQUAL(remove, ec::type_clash);
+    } else {
+      CHECK(add);
+      CHECK(remove);
+    }
+    auto get = b->get("foo");
+    REQUIRE(get);
+    CHECK_EQUAL(*get, data{42});
+    CHECK_EQUAL(b->subtract("bar", 1), ec::no_such_key);
+    CHECK_EQUAL(b->get("bar"), error{ec::no_such_key});
+    b.reset();
+    detail::remove_all(path);
+  };
+  check(memory, true);
+  check(sqlite, true);
+#ifdef BROKER_HAVE_ROCKSDB
+  // RocksDB applies both operations via its merge operator.
+  check(rocksdb, false);
+#endif
+}
+
+TEST(memory cursors ignore later modifications) {
+  auto b = detail::make_backend(memory, {});
+  REQUIRE(b->cursor_is_isolated());
+  for (auto i = 0; i < 10; ++i)
+    REQUIRE(b->put(i, i));
+  auto c = b->cursor();
+  REQUIRE(c);
+  std::vector<snapshot_entry> xs;
+  REQUIRE((*c)->next(xs, 4));
+  REQUIRE(b->put(42, 42));
+  REQUIRE(b->erase(0));
+  REQUIRE(b->put(1, 100));
+  auto more = (*c)->next(xs, 100);
+  REQUIRE(more);
+  CHECK(!*more);
+  broker::snapshot original;
+  for (auto i = 0; i < 10; ++i)
+    original.emplace(i, i);
+  CHECK_EQUAL(broker::snapshot(xs.begin(), xs.end()), original);
+  MESSAGE("the backend itself sees all modifications");
+  CHECK_EQUAL(value_of(b->get(1)), data{100});
+  CHECK_EQUAL(b->get(0), error{ec::no_such_key});
+  auto size = b->size();
+  REQUIRE(size);
+  CHECK_EQUAL(*size, 10u);
+}
+
+TEST(sqlite transactions) {
+  using std::chrono::seconds;
+  auto path = std::string{"/tmp/broker-unit-test-sqlite-transactions"};
+  detail::remove_all(path);
+  {
+    auto writer = detail::make_backend(sqlite, backend_options{{"path", path}});
+    auto reader = detail::make_backend(sqlite, backend_options{{"path", path}});
+    REQUIRE(writer->begin_transaction());
+    REQUIRE(writer->put("foo", 1));
+    CHECK_EQUAL(value_of(writer->get("foo")), data{1});
+    MESSAGE("other connections only see committed modifications");
+    CHECK_EQUAL(reader->get("foo"), error{ec::no_such_key});
+    REQUIRE(writer->commit_transaction());
+    CHECK_EQUAL(value_of(reader->get("foo")), data{1});
+    MESSAGE("committing without a transaction is a no-op");
+    CHECK(writer->commit_transaction());
+    MESSAGE("bulk_expire rolls back if it cannot commit");
+    REQUIRE(writer->put("bar", 2, broker::now() - seconds{1}));
+    // An unfinished read keeps the writer from committing.
+    auto c = reader->cursor();
+    REQUIRE(c);
+    std::vector<snapshot_entry> xs;
+    REQUIRE((*c)->next(xs, 1));
+    CHECK(!writer->bulk_expire({data{"bar"}}, broker::now()));
+    c->reset();
+    REQUIRE(writer->put("baz", 3));
+    CHECK_EQUAL(value_of(reader->get("baz")), data{3});
+    CHECK_EQUAL(value_of(reader->get("bar")), data{2});
+    MESSAGE("bulk_expire commits on its own without a transaction");
+    auto expired = writer->bulk_expire({data{"bar"}}, broker::now());
+    REQUIRE(expired);
+    CHECK_EQUAL(*expired, std::vector<data>{data{"bar"}});
+    CHECK_EQUAL(reader->get("bar"), error{ec::no_such_key});
+  }
+  detail::remove_all(path);
+}
+
+TEST(sqlite pragmas) {
+  auto path = std::string{"/tmp/broker-unit-test-sqlite-pragmas"};
+  auto check = [&](backend_options opts) {
+    detail::remove_all(path);
+    opts.emplace("path", path);
+    auto b = detail::make_backend(sqlite, std::move(opts));
+    auto put = b->put("foo", 42);
+    b.reset();
+    detail::remove_all(path);
+    return static_cast<bool>(put);
+  };
+  CHECK(check({{"journal_mode", std::string{"wal"}},
+               {"synchronous", std::string{"normal"}}}));
+  CHECK(check({{"journal_mode", std::string{"off"}},
+               {"synchronous", std::string{"off"}}}));
+  MESSAGE("the backend refuses to open with invalid values");
+  CHECK(!check({{"journal_mode", std::string{"bogus"}}}));
+  CHECK(!check({{"journal_mode", std::string{"wal; drop table store"}}}));
+  CHECK(!check({{"journal_mode", count{1}}}));
+  CHECK(!check({{"synchronous", std::string{"sometimes"}}}));
+  CHECK(!check({{"synchronous", count{2}}}));
+}
+
+TEST(sqlite reports corrupt values) {
+  auto path = std::string{"/tmp/broker-unit-test-sqlite-corrupt"};
+  detail::remove_all(path);
+  auto opts = backend_options{{"path", path}};
+  auto b = detail::make_backend(sqlite, opts);
+  REQUIRE(b->put("foo", 1));
+  b.reset();
+  MESSAGE("overwrite the value with a truncated blob");
+  sqlite3* db = nullptr;
+  REQUIRE_EQUAL(sqlite3_open(path.c_str(), &db), SQLITE_OK);
+  sqlite3_stmt* stmt = nullptr;
+  REQUIRE_EQUAL(sqlite3_prepare_v2(db, "update store set value = ?;", -1,
+                                   &stmt, nullptr),
+                SQLITE_OK);
+  auto blob = std::string(1, detail::compact_blob_marker);
+  CHECK_EQUAL(sqlite3_bind_blob(stmt, 1, blob.data(),
+                                static_cast<int>(blob.size()), SQLITE_STATIC),
+              SQLITE_OK);
+  CHECK_EQUAL(sqlite3_step(stmt), SQLITE_DONE);
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  MESSAGE("reads fail instead of returning nil");
+  b = detail::make_backend(sqlite, opts);
+  CHECK_EQUAL(b->get("foo"), error{ec::backend_failure});
+  CHECK_EQUAL(b->snapshot(), error{ec::backend_failure});
+  auto c = b->cursor();
+  REQUIRE(c);
+  std::vector<snapshot_entry> xs;
+  CHECK_EQUAL((*c)->next(xs, 1), error{ec::backend_failure});
+  c->reset();
+  b.reset();
+  detail::remove_all(path);
+}
+
+TEST(writes without expiry drop expiries across restarts) {
+  using std::chrono::hours;
+  auto path = std::string{"/tmp/broker-unit-test-expiry-restart"};
+  auto check = [&](backend type) {
+    detail::remove_all(path);
+    auto opts = backend_options{{"path", path}};
+    auto b = detail::make_backend(type, opts);
+    auto later = broker::now() + hours{1};
+    REQUIRE(b->put("foo", 1, later));
+    REQUIRE(b->put("bar", 1, later));
+    REQUIRE(b->put("baz", 1, later));
+    REQUIRE(b->put("foo", 2));
+    REQUIRE(b->add("bar", 1, data::type::integer));
+    REQUIRE(b->subtract("baz", 1));
+    b.reset();
+    b = detail::make_backend(type, opts);
+    auto es = b->expiries();
+    REQUIRE(es);
+    CHECK(es->empty());
+    CHECK_EQUAL(value_of(b->get("foo")), data{2});
+    b.reset();
+    detail::remove_all(path);
+  };
+  check(sqlite);
+#ifdef BROKER_HAVE_ROCKSDB
+  check(rocksdb);
+#endif
+}
+
+#ifdef BROKER_HAVE_ROCKSDB
+
+TEST(rocksdb tuning options) {
+  auto path = std::string{"/tmp/broker-unit-test-rocksdb-tuning"};
+  detail::remove_all(path);
+  backend_options opts{{"path", path},
+                       {"block-cache-size", count{1 << 20}},
+                       {"bloom-filter-bits", count{10}},
+                       {"compression", std::string{"none"}},
+                       {"write-buffer-size", count{1 << 20}}};
+  auto b = detail::make_backend(rocksdb, std::move(opts));
+  for (count i = 0; i < 100; ++i)
+    REQUIRE(b->put(i, i));
+  REQUIRE(b->add(count{1}, count{1}, data::type::count));
+  REQUIRE(b->subtract(count{2}, count{1}));
+  auto get = b->get(count{1});
+  REQUIRE(get);
+  CHECK_EQUAL(*get, data{count{2}});
+  get = b->get(count{2});
+  REQUIRE(get);
+  CHECK_EQUAL(*get, data{count{1}});
+  CHECK_EQUAL(b->get(count{100}), error{ec::no_such_key});
+  MESSAGE("clear re-opens the database with the same options");
+  REQUIRE(b->clear());
+  REQUIRE(b->put("foo", 42));
+  get = b->get("foo");
+  REQUIRE(get);
+  CHECK_EQUAL(*get, data{42});
+  b.reset();
+  detail::remove_all(path);
+}
+
+#endif // BROKER_HAVE_ROCKSDB
@@ -282,8 +282,9 @@ CAF_TEST(triangle_peering) {
     }
   );
   // Step #1: core1  --->    ('peer', filter_type)    ---> core2
-  expect((atom::peer, filter_type, actor),
-         from(core1).to(core2).with(_, filter_type{"a", "b", "c"}, core1));
+  expect((atom::peer, filter_type, actor, shard_layout),
+         from(core1).to(core2).with(_, filter_type{"a", "b", "c"}, core1,
+                                    shard_layout{0}));
   run();
   // Initiate handshake between core2 and core3.
   self->send(core2, atom::peer::value, core3);
@@ -413,8 +414,9 @@ CAF_TEST(sequenced_peering) {
       CAF_FAIL(sys.render(err));
     }
   );
-  expect((atom::peer, filter_type, actor),
-         from(core1).to(core2).with(_, filter_type{"a", "b", "c"}, core1));
+  expect((atom::peer, filter_type, actor, shard_layout),
+         from(core1).to(core2).with(_, filter_type{"a", "b", "c"}, core1,
+                                    shard_layout{0}));
   run();
   CAF_MESSAGE("spin up driver and transmit first half of the data");
   auto d1 = sys.spawn(driver, core1, true);
@@ -461,8 +463,9 @@ CAF_TEST(sequenced_peering) {
     }
   );
   // Step #1: core1  --->    ('peer', filter_type)    ---> core3
-  expect((atom::peer, filter_type, actor),
-         from(core1).to(core3).with(_, filter_type{"a", "b", "c"}, core1));
+  expect((atom::peer, filter_type, actor, shard_layout),
+         from(core1).to(core3).with(_, filter_type{"a", "b", "c"}, core1,
+                                    shard_layout{0}));
   run();
   CAF_MESSAGE("restart driver and send second half of the data");
   anon_send(d1, restart_atom::value);
@@ -559,8 +562,9 @@ CAF_TEST(failed_handshake_stage1) {
   // Initiate handshake between core1 and core2, but kill core2 right away.
   self->send(core2, atom::peer::value, core1);
   expect((atom::peer, actor), from(self).to(core2).with(_, core1));
-  expect((atom::peer, filter_type, actor),
-         from(core2).to(core1).with(_, filter_type{"a", "b", "c"}, core2));
+  expect((atom::peer, filter_type, actor, shard_layout),
+         from(core2).to(core1).with(_, filter_type{"a", "b", "c"}, core2,
+                                    shard_layout{0}));
   anon_send_exit(core2, exit_reason::kill);
   run();
   BROKER_CHECK_LOG(es.poll(), sc::peer_added, sc::peer_lost);
@@ -571,8 +575,9 @@ CAF_TEST(failed_handshake_stage2) {
   CAF_MESSAGE("initiate handshake between core1 and core2");
   self->send(core1, atom::peer::value, core2);
   expect((atom::peer, actor), from(self).to(core1).with(_, core2));
-  expect((atom::peer, filter_type, actor),
-         from(_).to(core2).with(_, filter_type{"a", "b", "c"}, core1));
+  expect((atom::peer, filter_type, actor, shard_layout),
+         from(_).to(core2).with(_, filter_type{"a", "b", "c"}, core1,
+                                shard_layout{0}));
   CAF_MESSAGE("send kill to core2");
   anon_send_exit(core2, exit_reason::kill);
   CAF_MESSAGE("have core1 handle the pending handshake");
@@ -588,8 +593,9 @@ CAF_TEST(failed_handshake_stage3) {
   // Initiate handshake between core1 and core2, but kill core2 right away.
   self->send(core2, atom::peer::value, core1);
   expect((atom::peer, actor), from(self).to(core2).with(_, core1));
-  expect((atom::peer, filter_type, actor),
-         from(core2).to(core1).with(_, filter_type{"a", "b", "c"}, core2));
+  expect((atom::peer, filter_type, actor, shard_layout),
+         from(core2).to(core1).with(_, filter_type{"a", "b", "c"}, core2,
+                                    shard_layout{0}));
   expect((open_stream_msg), from(_).to(core2).with(_, core1, _, _, false));
   anon_send_exit(core2, exit_reason::kill);
   expect((open_stream_msg), from(_).to(core1).with(_, core2, _, _, false));
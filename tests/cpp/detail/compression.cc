@@ -0,0 +1,106 @@
+#define SUITE compression
+
+#include "broker/detail/compression.hh"
+
+#include "test.hh"
+
+#include <string>
+#include <vector>
+
+#include "broker/detail/payload_buffer.hh"
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+std::string make_log(size_t lines) {
+  std::string result;
+  for (size_t i = 0; i < lines; ++i)
+    result += "1564000000.123\tCHhAvVGS1DHFjwGM9\t192.168.1."
+              + std::to_string(i % 250) + "\t4567\t10.0.0.1\t80\ttcp\n";
+  return result;
+}
+
+std::vector<char> pack(compression_method method, const std::string& str) {
+  std::vector<char> result;
+  CHECK(compress(method, str.data(), str.size(), result));
+  return result;
+}
+
+std::string unpack(compression_method method, const std::vector<char>& buf,
+                   size_t raw_size) {
+  std::vector<char> result;
+  CHECK(decompress(method, buf.data(), buf.size(), raw_size, result));
+  return std::string{result.begin(), result.end()};
+}
+
+} // namespace
+
+TEST(lz compresses repetitive input) {
+  auto method = compression_method::lz;
+  for (auto& str : {std::string{}, std::string{"a"}, std::string(1000, 'x'),
+                    make_log(100)}) {
+    auto buf = pack(method, str);
+    CHECK_EQUAL(unpack(method, buf, str.size()), str);
+  }
+  auto log = make_log(100);
+  CHECK_LESS(pack(method, log).size() * 10, log.size());
+}
+
+TEST(lz rejects malformed input) {
+  auto method = compression_method::lz;
+  auto str = make_log(10);
+  auto buf = pack(method, str);
+  std::vector<char> out;
+  CHECK(!decompress(method, buf.data(), buf.size(), str.size() + 1, out));
+  out.clear();
+  CHECK(!decompress(method, buf.data(), buf.size() / 2, str.size(), out));
+  // A match that refers to data before the start of the output.
+  std::vector<char> bogus{'\x10', 'a', '\x05', '\x00'};
+  out.clear();
+  CHECK(!decompress(method, bogus.data(), bogus.size(), 5, out));
+}
+
+TEST(zlib is optional) {
+  auto method = compression_method::zlib;
+  if (!compression_available(method)) {
+    std::vector<char> out;
+    CHECK(!compress(method, "foo", 3, out));
+    return;
+  }
+  auto str = make_log(100);
+  auto buf = pack(method, str);
+  CHECK_LESS(buf.size(), str.size());
+  CHECK_EQUAL(unpack(method, buf, str.size()), str);
+}
+
+TEST(methods convert from and to strings) {
+  for (auto x : {compression_method::none, compression_method::lz,
+                 compression_method::zlib}) {
+    compression_method y;
+    CHECK(convert(to_string(x), y));
+    CHECK(x == y);
+  }
+  compression_method x;
+  CHECK(!convert("gzip", x));
+}
+
+TEST(compressed payloads decode to the original data) {
+  vector xs;
+  for (count i = 0; i < 100; ++i)
+    xs.emplace_back(vector{i, "CHhAvVGS1DHFjwGM9", "tcp"});
+  auto plain = make_payload_buffer(xs);
+  REQUIRE(plain != nullptr);
+  auto compressed = compress_payload(*plain, compression_method::lz);
+  REQUIRE(compressed != nullptr);
+  CHECK(compressed->compression() == compression_method::lz);
+  CHECK_LESS(compressed->size(), plain->size());
+  CHECK_EQUAL(compressed->raw_size(), plain->size());
+  data result;
+  CHECK(decode_payload(*compressed, result));
+  CHECK_EQUAL(result, data{xs});
+  auto restored = decompress_payload(*compressed);
+  REQUIRE(restored != nullptr);
+  CHECK_EQUAL(restored->bytes(), plain->bytes());
+}
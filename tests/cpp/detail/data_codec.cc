@@ -0,0 +1,120 @@
+#define SUITE data_codec
+
+#include "broker/detail/data_codec.hh"
+
+#include "test.hh"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "broker/convert.hh"
+#include "broker/detail/blob.hh"
+
+using namespace broker;
+
+namespace {
+
+std::vector<char> encode(const data& x) {
+  std::vector<char> buf;
+  detail::compact_encode(x, buf);
+  return buf;
+}
+
+data roundtrip(const data& x) {
+  auto buf = encode(x);
+  data result;
+  CHECK(detail::compact_decode(buf.data(), buf.size(), result));
+  return result;
+}
+
+address make_address(const std::string& str) {
+  address result;
+  CHECK(convert(str, result));
+  return result;
+}
+
+subnet make_subnet(const std::string& str, uint8_t length) {
+  return {make_address(str), length};
+}
+
+} // namespace
+
+TEST(scalars survive a roundtrip) {
+  for (auto x : {data{}, data{true}, data{false}, data{count{0}},
+                 data{count{14}}, data{count{15}},
+                 data{std::numeric_limits<count>::max()}, data{integer{-1}},
+                 data{std::numeric_limits<integer>::min()},
+                 data{std::numeric_limits<integer>::max()}, data{real{4.2}},
+                 data{timespan{-42}}, data{timestamp{timespan{1234567890}}}})
+    CHECK_EQUAL(roundtrip(x), x);
+}
+
+TEST(strings and enums survive a roundtrip) {
+  for (auto x : {data{""}, data{"foo"}, data{std::string(300, 'x')},
+                 data{enum_value{"tcp"}}})
+    CHECK_EQUAL(roundtrip(x), x);
+}
+
+TEST(addresses subnets and ports survive a roundtrip) {
+  for (auto x : {data{make_address("1.2.3.4")}, data{make_address("::1")},
+                 data{make_subnet("10.0.0.0", 8)},
+                 data{make_subnet("2001:db8::", 32)},
+                 data{port{80, port::protocol::tcp}},
+                 data{port{65535, port::protocol::unknown}}})
+    CHECK_EQUAL(roundtrip(x), x);
+}
+
+TEST(containers survive a roundtrip) {
+  table xs;
+  xs.emplace("a", set{count{1}, count{2}});
+  xs.emplace(integer{-3}, vector{});
+  for (auto x : {data{set{}}, data{vector{nil, "foo", vector{count{1}}}},
+                 data{xs}})
+    CHECK_EQUAL(roundtrip(x), x);
+}
+
+TEST(small values fit into the type tag) {
+  CHECK_EQUAL(encode(data{count{14}}).size(), 1u);
+  CHECK_EQUAL(encode(data{integer{-7}}).size(), 1u);
+  CHECK_EQUAL(encode(data{"foo"}).size(), 4u);
+  CHECK_EQUAL(encode(data{make_address("1.2.3.4")}).size(), 5u);
+  CHECK_EQUAL(encode(data{port{80, port::protocol::tcp}}).size(), 3u);
+  CHECK_EQUAL(encode(data{vector{count{1}, count{2}}}).size(), 3u);
+}
+
+TEST(malformed input is rejected) {
+  auto buf = encode(data{vector{"foo", make_address("::1")}});
+  data x;
+  for (size_t n = 0; n < buf.size(); ++n)
+    CHECK(!detail::compact_decode(buf.data(), n, x));
+  buf.push_back('\0');
+  CHECK(!detail::compact_decode(buf.data(), buf.size(), x));
+  // A vector that claims to hold more elements than the input has bytes.
+  std::vector<char> huge{'\xFE', '\xFF', '\xFF', '\xFF', '\x0F'};
+  CHECK(!detail::compact_decode(huge.data(), huge.size(), x));
+}
+
+TEST(deeply nested input is rejected) {
+  std::vector<char> buf(1000, '\x1E');
+  data x;
+  CHECK(!detail::compact_decode(buf.data(), buf.size(), x));
+}
+
+TEST(data blobs accept legacy encodings) {
+  data x = vector{count{1}, "foo", make_address("1.2.3.4")};
+  auto blob = detail::to_data_blob(x);
+  CHECK_EQUAL(blob[0], detail::compact_blob_marker);
+  CHECK_EQUAL(value_of(detail::from_data_blob(blob)), x);
+  CHECK_EQUAL(value_of(detail::from_data_blob(detail::to_blob(x))), x);
+}
+
+TEST(corrupt data blobs are reported) {
+  auto blob = detail::to_data_blob(vector{count{1}, "foo"});
+  blob.resize(blob.size() - 1);
+  CHECK_EQUAL(error_of(detail::from_data_blob(blob)),
+              error{ec::backend_failure});
+  blob.resize(1);
+  CHECK_EQUAL(error_of(detail::from_data_blob(blob)),
+              error{ec::backend_failure});
+}
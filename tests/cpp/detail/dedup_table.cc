@@ -0,0 +1,82 @@
+#define SUITE dedup_table
+
+#include "broker/detail/dedup_table.hh"
+
+#include "test.hh"
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+struct fixture {
+  dedup_table tbl;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(dedup_table_tests, fixture)
+
+TEST(the table accepts each message once) {
+  CHECK(tbl.insert(1, 1));
+  CHECK(tbl.insert(1, 2));
+  CHECK(!tbl.insert(1, 1));
+  CHECK(!tbl.insert(1, 2));
+  CHECK(tbl.insert(1, 3));
+}
+
+TEST(origins have independent windows) {
+  CHECK(tbl.insert(1, 10));
+  CHECK(tbl.insert(2, 10));
+  CHECK(!tbl.insert(2, 10));
+  CHECK_EQUAL(tbl.size(), 2u);
+}
+
+TEST(the table accepts reordered messages within the window) {
+  CHECK(tbl.insert(1, 100));
+  CHECK(tbl.insert(1, 90));
+  CHECK(tbl.insert(1, 95));
+  CHECK(!tbl.insert(1, 90));
+  CHECK(tbl.insert(1, 101));
+  CHECK(!tbl.insert(1, 95));
+}
+
+TEST(the table accepts messages older than the window) {
+  auto n = dedup_table::window_size;
+  CHECK(tbl.insert(1, n + 10));
+  CHECK(tbl.insert(1, 11));
+  CHECK(!tbl.insert(1, 11));
+  // Without a bit for 10, the table cannot tell whether it saw 10 before.
+  CHECK(tbl.insert(1, 10));
+  CHECK(tbl.insert(1, 10));
+  // Old messages leave the window alone.
+  CHECK(!tbl.insert(1, n + 10));
+}
+
+TEST(sliding the window forgets skipped sequence numbers) {
+  auto n = dedup_table::window_size;
+  CHECK(tbl.insert(1, 5));
+  // Sequence number 5 + n maps to the same bit as 5.
+  CHECK(tbl.insert(1, 5 + n));
+  CHECK(!tbl.insert(1, 5 + n));
+  CHECK(tbl.insert(1, 6 + n));
+  // Jumping far ahead clears the whole window.
+  CHECK(tbl.insert(1, 10 * n));
+  CHECK(tbl.insert(1, 10 * n - 1));
+}
+
+FIXTURE_SCOPE_END()
+
+TEST(the table evicts the least recently active origin) {
+  dedup_table tbl{2};
+  CHECK(tbl.insert(1, 1));
+  CHECK(tbl.insert(2, 1));
+  CHECK(tbl.insert(1, 2));
+  // Origin 3 pushes out origin 2, because origin 1 was active more recently.
+  CHECK(tbl.insert(3, 1));
+  CHECK_EQUAL(tbl.size(), 2u);
+  CHECK(!tbl.insert(1, 2));
+  CHECK(!tbl.insert(3, 1));
+  CHECK(tbl.insert(2, 1));
+  CHECK_EQUAL(tbl.size(), 2u);
+}
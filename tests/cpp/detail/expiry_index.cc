@@ -0,0 +1,65 @@
+#define SUITE expiry_index
+
+#include "broker/detail/expiry_index.hh"
+
+#include "test.hh"
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+struct fixture {
+  expiry_index idx;
+
+  timestamp at(int seconds) {
+    return timestamp{std::chrono::seconds(seconds)};
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(expiry_index_tests, fixture)
+
+TEST(the index returns due keys in order) {
+  idx.add("b", at(2));
+  idx.add("a", at(1));
+  idx.add("c", at(3));
+  CHECK(idx.next() == at(1));
+  CHECK_EQUAL(idx.take_due(at(0)).size(), 0u);
+  auto xs = idx.take_due(at(2));
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(xs[0], data{"a"});
+  CHECK_EQUAL(xs[1], data{"b"});
+  CHECK_EQUAL(idx.size(), 1u);
+  CHECK(idx.next() == at(3));
+}
+
+TEST(new expiration times replace old ones) {
+  idx.add("a", at(1));
+  idx.add("a", at(5));
+  CHECK_EQUAL(idx.size(), 1u);
+  CHECK(idx.take_due(at(4)).empty());
+  idx.add("a", at(2));
+  auto xs = idx.take_due(at(4));
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0], data{"a"});
+  CHECK(idx.empty());
+  CHECK(!idx.next());
+}
+
+TEST(erased keys never become due) {
+  idx.add("a", at(1));
+  idx.add("b", at(1));
+  idx.erase("a");
+  idx.erase("x");
+  auto xs = idx.take_due(at(1));
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0], data{"b"});
+  idx.add("c", at(1));
+  idx.clear();
+  CHECK(idx.empty());
+  CHECK(idx.take_due(at(1)).empty());
+}
+
+FIXTURE_SCOPE_END()
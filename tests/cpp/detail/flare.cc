@@ -0,0 +1,80 @@
+#define SUITE flare
+
+#include "broker/detail/flare.hh"
+
+#include "test.hh"
+
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+bool ready(const flare& fx) {
+  pollfd p = {fx.fd(), POLLIN, 0};
+  return ::poll(&p, 1, 0) == 1;
+}
+
+} // namespace
+
+TEST(flares count how often they fire) {
+  flare fx;
+  CHECK(!ready(fx));
+  fx.fire();
+  fx.fire(3);
+  CHECK(ready(fx));
+  CHECK_EQUAL(fx.extinguish_some(2), 2u);
+  CHECK(ready(fx));
+  CHECK(fx.extinguish_one());
+  CHECK(ready(fx));
+  CHECK_EQUAL(fx.extinguish(), 1u);
+  CHECK(!ready(fx));
+  CHECK(!fx.extinguish_one());
+  CHECK_EQUAL(fx.extinguish_some(5), 0u);
+}
+
+TEST(spinning on a flare stops after the window) {
+  flare fx;
+  CHECK(!fx.active());
+  CHECK(!fx.spin_one(std::chrono::microseconds(100)));
+  fx.fire();
+  CHECK(fx.active());
+  CHECK(fx.spin_one(std::chrono::microseconds(100)));
+  std::thread producer{[&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    fx.fire();
+  }};
+  CHECK(fx.spin_one(std::chrono::seconds(10)));
+  producer.join();
+}
+
+TEST(flares stay consistent under concurrent access) {
+  flare fx;
+  constexpr size_t num_producers = 3;
+  constexpr size_t num_fires = 10000;
+  std::atomic<size_t> taken{0};
+  std::vector<std::thread> producers;
+  for (size_t i = 0; i < num_producers; ++i)
+    producers.emplace_back([&] {
+      for (size_t j = 0; j < num_fires; ++j)
+        fx.fire();
+    });
+  std::thread consumer{[&] {
+    while (taken < num_producers * num_fires) {
+      fx.await_one();
+      if (fx.extinguish_one())
+        ++taken;
+    }
+  }};
+  for (auto& t : producers)
+    t.join();
+  consumer.join();
+  CHECK_EQUAL(taken.load(), num_producers * num_fires);
+  CHECK(!ready(fx));
+}
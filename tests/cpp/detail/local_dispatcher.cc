@@ -0,0 +1,67 @@
+#define SUITE local_dispatcher
+
+#include "broker/detail/local_dispatcher.hh"
+
+#include "test.hh"
+
+#include <vector>
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+using queue_ptr = local_dispatcher::queue_ptr;
+
+std::vector<data_message> drain(const queue_ptr& q) {
+  return q->consume_all();
+}
+
+} // namespace
+
+TEST(routes contain all queues with a matching filter) {
+  local_dispatcher d;
+  auto q1 = make_subscriber_queue<data_message>(16);
+  auto q2 = make_subscriber_queue<data_message>(16);
+  d.subscribe(q1, {"a"});
+  d.subscribe(q2, {"a/b", "c"});
+  CHECK_EQUAL(d.lookup("a/b/c", nullptr)->queues.size(), 2u);
+  CHECK_EQUAL(d.lookup("a/x", nullptr)->queues.size(), 1u);
+  CHECK_EQUAL(d.lookup("c", nullptr)->queues.size(), 1u);
+  CHECK_EQUAL(d.lookup("d", nullptr)->queues.size(), 0u);
+}
+
+TEST(lookups reuse cached routes until subscriptions change) {
+  local_dispatcher d;
+  auto q = make_subscriber_queue<data_message>(16);
+  d.subscribe(q, {"a"});
+  auto r1 = d.lookup("a", nullptr);
+  CHECK(d.lookup("a", r1) == r1);
+  d.subscribe(q, {"b"});
+  auto r2 = d.lookup("a", r1);
+  CHECK(r2 != r1);
+  CHECK_EQUAL(r2->queues.size(), 0u);
+  d.unsubscribe(q);
+  CHECK(d.lookup("a", r2) != r2);
+}
+
+TEST(deliver hands messages to all matching queues) {
+  local_dispatcher d;
+  auto q1 = make_subscriber_queue<data_message>(16);
+  auto q2 = make_subscriber_queue<data_message>(16);
+  d.subscribe(q1, {"a"});
+  d.subscribe(q2, {"b"});
+  d.deliver(make_data_message("a/1"_t, data{1}));
+  d.deliver(make_data_message("b/2"_t, data{2}));
+  d.deliver(make_data_message("c/3"_t, data{3}));
+  auto xs = drain(q1);
+  REQUIRE(xs.size() == 1u);
+  CHECK_EQUAL(get_topic(xs[0]), "a/1"_t);
+  CHECK_EQUAL(get_data(xs[0]), data{1});
+  auto ys = drain(q2);
+  REQUIRE(ys.size() == 1u);
+  CHECK_EQUAL(get_topic(ys[0]), "b/2"_t);
+  d.unsubscribe(q1);
+  d.deliver(make_data_message("a/1"_t, data{1}));
+  CHECK_EQUAL(q1->buffer_size(), 0u);
+}
@@ -0,0 +1,132 @@
+#define SUITE lock_free_queue
+
+#include "broker/detail/lock_free_publisher_queue.hh"
+#include "broker/detail/lock_free_subscriber_queue.hh"
+
+#include "test.hh"
+
+#include <poll.h>
+
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "broker/data.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+bool ready(int fd) {
+  pollfd p = {fd, POLLIN, 0};
+  return ::poll(&p, 1, 0) == 1;
+}
+
+std::vector<data_message> make_msgs(count first, count last) {
+  std::vector<data_message> result;
+  for (auto i = first; i < last; ++i)
+    result.emplace_back(topic{"foo"}, data{i});
+  return result;
+}
+
+} // namespace
+
+TEST(subscriber queues signal readability on the flare) {
+  lock_free_subscriber_queue<> q{10};
+  CHECK(!ready(q.fd()));
+  auto xs = make_msgs(0, 3);
+  q.produce(xs.size(), xs.begin(), xs.end());
+  CHECK(ready(q.fd()));
+  CHECK_EQUAL(q.buffer_size(), 3u);
+  std::vector<data_message> ys;
+  size_t size_before = 0;
+  auto f = [&](data_message&& x) { ys.emplace_back(std::move(x)); };
+  CHECK_EQUAL(q.consume(2, &size_before, f), 2u);
+  CHECK_EQUAL(size_before, 3u);
+  CHECK(ready(q.fd()));
+  CHECK_EQUAL(q.consume(2, &size_before, f), 1u);
+  CHECK(!ready(q.fd()));
+  CHECK_EQUAL(ys, xs);
+}
+
+TEST(subscriber queues keep the order beyond the ring buffer capacity) {
+  // The ring buffer has at most 4096 slots, everything else overflows.
+  lock_free_subscriber_queue<> q{10};
+  auto xs = make_msgs(0, 5000);
+  q.produce(xs.size(), xs.begin(), xs.end());
+  auto ys = make_msgs(5000, 5010);
+  q.produce(ys.size(), ys.begin(), ys.end());
+  xs.insert(xs.end(), ys.begin(), ys.end());
+  CHECK_EQUAL(q.buffer_size(), xs.size());
+  CHECK_EQUAL(q.consume_all(), xs);
+  CHECK(!ready(q.fd()));
+}
+
+TEST(subscriber queues append to caller provided buffers) {
+  lock_free_subscriber_queue<> q{10};
+  std::vector<data_message> buf;
+  buf.reserve(10);
+  auto ptr = buf.data();
+  CHECK_EQUAL(q.consume_all(buf), 0u);
+  auto xs = make_msgs(0, 3);
+  q.produce(xs.size(), xs.begin(), xs.end());
+  CHECK_EQUAL(q.consume_all(buf), 3u);
+  auto ys = make_msgs(3, 5);
+  q.produce(ys.size(), ys.begin(), ys.end());
+  CHECK_EQUAL(q.consume_all(buf), 2u);
+  CHECK_EQUAL(buf, make_msgs(0, 5));
+  CHECK(buf.data() == ptr);
+  CHECK(!ready(q.fd()));
+}
+
+TEST(subscriber queues deliver all items across threads) {
+  lock_free_subscriber_queue<> q{20};
+  constexpr count n = 10000;
+  std::thread producer{[&] {
+    for (count i = 0; i < n; i += 10) {
+      auto xs = make_msgs(i, i + 10);
+      q.produce(xs.size(), std::make_move_iterator(xs.begin()),
+                std::make_move_iterator(xs.end()));
+    }
+  }};
+  count next = 0;
+  bool in_order = true;
+  while (next < n) {
+    q.wait_on_flare();
+    q.consume(7, nullptr, [&](data_message&& x) {
+      in_order = in_order && get<count>(get_data(x)) == next;
+      ++next;
+    });
+  }
+  producer.join();
+  CHECK(in_order);
+  CHECK(!ready(q.fd()));
+}
+
+TEST(publisher queues signal writability on the flare) {
+  lock_free_publisher_queue<> q{3};
+  topic t{"foo"};
+  CHECK(ready(q.fd()));
+  CHECK(q.produce(t, data{count{1}}));
+  CHECK(!q.produce(t, data{count{2}}));
+  CHECK(ready(q.fd()));
+  CHECK(!q.produce(t, data{count{3}}));
+  CHECK(!ready(q.fd()));
+  std::vector<data> xs{count{4}, count{5}};
+  CHECK(!q.append(t, xs.begin(), xs.end()));
+  CHECK_EQUAL(q.buffer_size(), 5u);
+  std::vector<data_message> ys;
+  auto f = [&](data_message&& x) { ys.emplace_back(std::move(x)); };
+  CHECK_EQUAL(q.consume(2, f), 2u);
+  CHECK(!ready(q.fd()));
+  CHECK_EQUAL(q.consume(2, f), 2u);
+  CHECK(ready(q.fd()));
+  CHECK_EQUAL(q.consume(4, f), 1u);
+  CHECK_EQUAL(q.pending(), 3);
+  CHECK_EQUAL(q.consume(4, f), 0u);
+  CHECK_EQUAL(q.pending(), 4);
+  CHECK_EQUAL(ys, make_msgs(1, 6));
+}
@@ -0,0 +1,152 @@
+#define SUITE payload_buffer
+
+#include "broker/detail/payload_buffer.hh"
+
+#include "test.hh"
+
+#include <vector>
+
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+#include <caf/make_counted.hpp>
+
+#include "broker/message.hh"
+
+using namespace broker;
+
+namespace {
+
+std::vector<char> serialize(node_message& x) {
+  std::vector<char> buf;
+  caf::binary_serializer sink{nullptr, buf};
+  CHECK_EQUAL(sink(x), caf::none);
+  return buf;
+}
+
+node_message deserialize(const std::vector<char>& buf) {
+  node_message result;
+  caf::binary_deserializer source{nullptr, buf.data(), buf.size()};
+  CHECK_EQUAL(source(result), caf::none);
+  return result;
+}
+
+detail::payload_buffer_ptr encode(const node_message& x) {
+  auto& d = get_data(caf::get<data_message>(x.content));
+  return detail::make_payload_buffer(d);
+}
+
+node_message make_msg() {
+  vector xs{count{1}, "foo", port{80, port::protocol::tcp}};
+  return make_node_message(make_data_message("zeek/events", xs), 10);
+}
+
+} // namespace
+
+TEST(payload buffers contain the serialized data) {
+  auto x = make_msg();
+  auto& d = get_data(caf::get<data_message>(x.content));
+  auto ptr = detail::make_payload_buffer(d);
+  REQUIRE(ptr != nullptr);
+  std::vector<char> buf;
+  caf::binary_serializer sink{nullptr, buf};
+  CHECK_EQUAL(sink(const_cast<data&>(d)), caf::none);
+  CHECK_EQUAL(ptr->bytes(), buf);
+}
+
+TEST(shared payloads produce the same bytes on the wire) {
+  auto x = make_msg();
+  auto y = x;
+  y.payload = encode(y);
+  auto z = y;
+  CHECK(y.payload == z.payload);
+  CHECK_EQUAL(serialize(x), serialize(y));
+  CHECK_EQUAL(serialize(y), serialize(z));
+}
+
+TEST(node messages with shared payloads survive a roundtrip) {
+  auto x = make_msg();
+  x.payload = encode(x);
+  auto buf = serialize(x);
+  auto y = deserialize(buf);
+  CHECK(y.lazy);
+  CHECK(materialize(y));
+  CHECK(!y.lazy);
+  CHECK_EQUAL(get_topic(y), "zeek/events"_t);
+  CHECK_EQUAL(get_data(caf::get<data_message>(y.content)),
+              get_data(caf::get<data_message>(x.content)));
+  CHECK_EQUAL(y.ttl, 10u);
+}
+
+TEST(relays forward payloads without deserializing them) {
+  auto x = make_msg();
+  auto buf = serialize(x);
+  auto y = deserialize(buf);
+  CHECK(y.lazy);
+  CHECK(y.payload != nullptr);
+  CHECK_EQUAL(serialize(y), buf);
+  CHECK(y.lazy);
+}
+
+TEST(message IDs survive a roundtrip) {
+  auto x = make_msg();
+  auto plain = serialize(x);
+  x.origin = 42;
+  x.seq = 7;
+  auto buf = serialize(x);
+  CHECK_EQUAL(buf.size(), plain.size() + 2 * sizeof(uint64_t));
+  auto y = deserialize(buf);
+  CHECK_EQUAL(y.origin, 42u);
+  CHECK_EQUAL(y.seq, 7u);
+  CHECK_EQUAL(serialize(y), buf);
+  auto z = deserialize(plain);
+  CHECK_EQUAL(z.origin, 0u);
+  CHECK_EQUAL(z.seq, 0u);
+}
+
+TEST(malformed payloads fail to materialize) {
+  auto x = make_msg();
+  x.payload = caf::make_counted<detail::payload_buffer>(std::vector<char>{});
+  x.lazy = true;
+  CHECK(!materialize(x));
+}
+
+TEST(compact payloads survive a roundtrip) {
+  auto x = make_msg();
+  auto& d = get_data(caf::get<data_message>(x.content));
+  x.payload = detail::make_payload_buffer(d, detail::payload_format::compact);
+  REQUIRE(x.payload != nullptr);
+  CHECK_LESS(x.payload->size(), encode(x)->size());
+  auto y = deserialize(serialize(x));
+  REQUIRE(y.payload != nullptr);
+  CHECK(y.payload->format() == detail::payload_format::compact);
+  CHECK(materialize(y));
+  CHECK_EQUAL(get_data(caf::get<data_message>(y.content)), d);
+}
+
+TEST(payloads convert between formats) {
+  auto x = make_msg();
+  auto ptr = encode(x);
+  auto compact = detail::convert_payload(*ptr,
+                                         detail::payload_format::compact);
+  REQUIRE(compact != nullptr);
+  CHECK(compact->format() == detail::payload_format::compact);
+  auto binary = detail::convert_payload(*compact,
+                                        detail::payload_format::binary);
+  REQUIRE(binary != nullptr);
+  CHECK_EQUAL(binary->bytes(), ptr->bytes());
+}
+
+TEST(payloads with oversized length prefixes fail to deserialize) {
+  std::vector<char> buf;
+  caf::binary_serializer sink{nullptr, buf};
+  // Announce a payload of almost 4 GB, but provide only three bytes.
+  CHECK_EQUAL(sink.begin_sequence(size_t{0xFFFFFFFF}), caf::none);
+  CHECK_EQUAL(sink(uint8_t{0}), caf::none);
+  CHECK_EQUAL(sink(uint8_t{1}), caf::none);
+  CHECK_EQUAL(sink(uint8_t{2}), caf::none);
+  CHECK_EQUAL(sink.end_sequence(), caf::none);
+  caf::binary_deserializer source{nullptr, buf.data(), buf.size()};
+  detail::payload_buffer_ptr x;
+  CHECK_NOT_EQUAL(detail::read_payload(source, x), caf::none);
+  CHECK(x == nullptr);
+}
@@ -0,0 +1,78 @@
+#define SUITE routing_table
+
+#include "broker/detail/routing_table.hh"
+
+#include "test.hh"
+
+#include "broker/detail/prefix_matcher.hh"
+
+using namespace broker;
+
+namespace {
+
+using slot_list = detail::routing_table::slot_list;
+
+struct fixture {
+  detail::routing_table tbl;
+
+  fixture() {
+    tbl.set(1, {"zeek/events", "zeek/logs/conn"});
+    tbl.set(2, {"zeek"});
+    tbl.set(3, {"zeek/logs"});
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(routing_table_tests, fixture)
+
+TEST(lookups return all subscribers with a matching prefix) {
+  CHECK_EQUAL(tbl.match("zeek/events/foo"), slot_list({1, 2}));
+  CHECK_EQUAL(tbl.match("zeek/logs/conn"), slot_list({1, 2, 3}));
+  CHECK_EQUAL(tbl.match("zeek/logs/dns"), slot_list({2, 3}));
+  CHECK_EQUAL(tbl.match("zeek"), slot_list({2}));
+  CHECK_EQUAL(tbl.match("bro/events"), slot_list());
+}
+
+TEST(empty topics subscribe to everything) {
+  tbl.set(4, {""});
+  CHECK_EQUAL(tbl.match("bro/events"), slot_list({4}));
+  CHECK_EQUAL(tbl.match("zeek/events"), slot_list({1, 2, 4}));
+}
+
+TEST(setting a filter replaces the previous one) {
+  CHECK_EQUAL(tbl.match("zeek/logs/conn"), slot_list({1, 2, 3}));
+  tbl.set(1, {"bro"});
+  CHECK_EQUAL(tbl.match("zeek/logs/conn"), slot_list({2, 3}));
+  CHECK_EQUAL(tbl.match("bro/events"), slot_list({1}));
+  CHECK_EQUAL(tbl.size(), 3u);
+}
+
+TEST(erasing a slot removes all of its prefixes) {
+  tbl.erase(2);
+  CHECK_EQUAL(tbl.match("zeek/events/foo"), slot_list({1}));
+  CHECK_EQUAL(tbl.match("zeek"), slot_list());
+  CHECK(!tbl.matches(2, "zeek/logs"));
+  CHECK(tbl.matches(3, "zeek/logs"));
+  CHECK_EQUAL(tbl.size(), 2u);
+  tbl.clear();
+  CHECK(tbl.empty());
+  CHECK_EQUAL(tbl.match("zeek/logs/conn"), slot_list());
+}
+
+TEST(lookups agree with the prefix matcher) {
+  std::vector<filter_type> filters{{"zeek/events", "zeek/logs/conn"},
+                                   {"zeek"},
+                                   {"zeek/logs"}};
+  detail::prefix_matcher f;
+  for (auto t : {"zeek", "zeek/events", "zeek/eventsx", "zeek/logs/conn/x",
+                 "bro", "ze"}) {
+    slot_list expected;
+    for (size_t i = 0; i < filters.size(); ++i)
+      if (f(filters[i], topic{t}))
+        expected.emplace_back(static_cast<caf::stream_slot>(i + 1));
+    CHECK_EQUAL(tbl.match(t), expected);
+  }
+}
+
+FIXTURE_SCOPE_END()
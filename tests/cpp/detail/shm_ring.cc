@@ -0,0 +1,146 @@
+#define SUITE shm_ring
+
+#include "broker/detail/shm_ring.hh"
+
+#include "test.hh"
+
+#include <string>
+#include <thread>
+
+using namespace broker;
+using namespace broker::detail;
+
+namespace {
+
+constexpr size_t capacity = 16;
+
+struct fixture {
+  fixture() : ring(shm_ring::init(mem, capacity)) {
+    // nop
+  }
+
+  std::string read(size_t len) {
+    std::string result(len, '\0');
+    result.resize(ring.read(&result[0], len));
+    return result;
+  }
+
+  size_t write(const std::string& str) {
+    return ring.write(str.data(), str.size());
+  }
+
+  alignas(64) char mem[shm_ring::memory_size(capacity)];
+  shm_ring ring;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(shm_ring_tests, fixture)
+
+TEST(rings transfer bytes in order) {
+  CHECK_EQUAL(ring.size(), 0u);
+  CHECK_EQUAL(write("hello"), 5u);
+  CHECK_EQUAL(write(" world"), 6u);
+  CHECK_EQUAL(ring.size(), 11u);
+  CHECK_EQUAL(read(5), "hello");
+  CHECK_EQUAL(read(100), " world");
+  CHECK_EQUAL(read(100), "");
+}
+
+TEST(rings accept partial writes until full) {
+  CHECK_EQUAL(write("0123456789"), 10u);
+  CHECK_EQUAL(write("abcdefghij"), 6u);
+  CHECK_EQUAL(ring.space(), 0u);
+  CHECK_EQUAL(write("x"), 0u);
+  CHECK_EQUAL(read(12), "0123456789ab");
+  // Wraps around the end of the buffer.
+  CHECK_EQUAL(write("klmnopqrst"), 10u);
+  CHECK_EQUAL(read(100), "cdefklmnopqrst");
+}
+
+TEST(writers wake up sleeping readers) {
+  // Readers start asleep.
+  CHECK(ring.await_data());
+  write("a");
+  CHECK(ring.wake_reader());
+  CHECK(ring.reader_wakeup_pending());
+  write("b");
+  CHECK(!ring.wake_reader());
+  CHECK(!ring.await_data());
+  CHECK_EQUAL(read(2), "ab");
+  CHECK(ring.await_data());
+}
+
+TEST(readers wake up sleeping writers) {
+  write(std::string(capacity, 'x'));
+  CHECK(!ring.wake_writer());
+  CHECK(ring.await_space());
+  read(1);
+  CHECK(ring.wake_writer());
+  CHECK(!ring.wake_writer());
+  CHECK(!ring.await_space());
+}
+
+TEST(rings support concurrent readers and writers) {
+  constexpr size_t num_bytes = 100000;
+  std::thread writer{[&] {
+    for (size_t i = 0; i < num_bytes;) {
+      auto c = static_cast<char>(i % 128);
+      i += ring.write(&c, 1);
+    }
+  }};
+  size_t mismatches = 0;
+  for (size_t i = 0; i < num_bytes;) {
+    char c;
+    if (ring.read(&c, 1) == 1) {
+      if (c != static_cast<char>(i % 128))
+        ++mismatches;
+      ++i;
+    }
+  }
+  writer.join();
+  CHECK_EQUAL(mismatches, 0u);
+}
+
+TEST(attaching validates the capacity) {
+  auto hdr = reinterpret_cast<shm_ring::header*>(mem);
+  CHECK(shm_ring::attach(mem, sizeof(mem)));
+  CHECK_EQUAL(shm_ring::attach(mem, sizeof(mem)).capacity(), capacity);
+  CHECK(!shm_ring::attach(mem, sizeof(mem) - 1));
+  CHECK(!shm_ring::attach(mem, sizeof(shm_ring::header) - 1));
+  hdr->capacity = 0;
+  CHECK(!shm_ring::attach(mem, sizeof(mem)));
+  hdr->capacity = capacity - 1;
+  CHECK(!shm_ring::attach(mem, sizeof(mem)));
+  hdr->capacity = capacity * 2;
+  CHECK(!shm_ring::attach(mem, sizeof(mem)));
+}
+
+TEST(rings ignore later capacity changes) {
+  auto hdr = reinterpret_cast<shm_ring::header*>(mem);
+  hdr->capacity = capacity * 1024;
+  CHECK_EQUAL(ring.capacity(), capacity);
+  CHECK_EQUAL(write(std::string(capacity * 2, 'x')), capacity);
+  CHECK_EQUAL(ring.space(), 0u);
+}
+
+TEST(rings detect corrupt heads and tails) {
+  auto hdr = reinterpret_cast<shm_ring::header*>(mem);
+  char buf[capacity * 4];
+  hdr->tail = capacity + 1;
+  CHECK_EQUAL(ring.size(), shm_ring::npos);
+  CHECK_EQUAL(ring.space(), 0u);
+  CHECK_EQUAL(ring.read(buf, sizeof(buf)), shm_ring::npos);
+  CHECK_EQUAL(ring.write(buf, sizeof(buf)), shm_ring::npos);
+  MESSAGE("a head past the tail wraps around to a huge distance");
+  hdr->head = 10;
+  hdr->tail = 5;
+  CHECK_EQUAL(ring.read(buf, sizeof(buf)), shm_ring::npos);
+  CHECK_EQUAL(ring.write(buf, sizeof(buf)), shm_ring::npos);
+  MESSAGE("rings remain usable at the boundary");
+  hdr->head = 0;
+  hdr->tail = capacity;
+  CHECK_EQUAL(ring.read(buf, sizeof(buf)), capacity);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,86 @@
+#define SUITE topic_dictionary
+
+#include "broker/detail/topic_dictionary.hh"
+
+#include "test.hh"
+
+#include <vector>
+
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  detail::topic_encoder encoder;
+  detail::topic_decoder decoder;
+
+  // Sends `x` through the encoder, serializes and deserializes the result and
+  // finally runs it through the decoder.
+  node_message transmit(node_message x, size_t* num_bytes = nullptr) {
+    encoder.encode(x);
+    std::vector<char> buf;
+    caf::binary_serializer sink{nullptr, buf};
+    CHECK_EQUAL(sink(x), caf::none);
+    if (num_bytes != nullptr)
+      *num_bytes = buf.size();
+    node_message result;
+    caf::binary_deserializer source{nullptr, buf.data(), buf.size()};
+    CHECK_EQUAL(source(result), caf::none);
+    CHECK(decoder.decode(result));
+    CHECK_EQUAL(result.topic_ref, 0u);
+    CHECK(materialize(result));
+    return result;
+  }
+};
+
+node_message make_msg(topic t, data d) {
+  return make_node_message(make_data_message(std::move(t), std::move(d)), 10);
+}
+
+} // namespace
+
+FIXTURE_SCOPE(topic_dictionary_tests, fixture)
+
+TEST(the first message defines an entry) {
+  auto x = make_msg("zeek/events/foo", 42);
+  encoder.encode(x);
+  CHECK_EQUAL(x.topic_ref, 3u);
+  CHECK(!omits_topic(x));
+  encoder.encode(x);
+  CHECK_EQUAL(x.topic_ref, 2u);
+  CHECK(omits_topic(x));
+  CHECK_EQUAL(encoder.size(), 1u);
+}
+
+TEST(topics survive a roundtrip) {
+  size_t first_size = 0;
+  size_t second_size = 0;
+  auto x = transmit(make_msg("zeek/events/foo", 42), &first_size);
+  CHECK_EQUAL(get_topic(x), "zeek/events/foo"_t);
+  CHECK_EQUAL(get_data(caf::get<data_message>(x.content)), data{42});
+  auto y = transmit(make_msg("zeek/events/foo", 23), &second_size);
+  CHECK_EQUAL(get_topic(y), "zeek/events/foo"_t);
+  CHECK_EQUAL(get_data(caf::get<data_message>(y.content)), data{23});
+  // Saves the string plus its one-byte length prefix.
+  CHECK_EQUAL(first_size - second_size, 16u);
+  auto z = transmit(make_msg("zeek/logs", 1));
+  CHECK_EQUAL(get_topic(z), "zeek/logs"_t);
+  CHECK_EQUAL(decoder.size(), 2u);
+}
+
+TEST(unknown references are rejected) {
+  auto x = make_msg("zeek/events/foo", 42);
+  x.topic_ref = 4;
+  CHECK(!decoder.decode(x));
+}
+
+TEST(messages without dictionary pass through) {
+  auto x = make_msg("zeek/events/foo", 42);
+  CHECK(decoder.decode(x));
+  CHECK_EQUAL(get_topic(x), "zeek/events/foo"_t);
+}
+
+FIXTURE_SCOPE_END()
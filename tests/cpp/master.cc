@@ -124,8 +124,9 @@ CAF_TEST(master_with_clone) {
             from(earth.self).to(core1).with(_, core2_proxy));
   // Step #1: core1  --->    ('peer', filter_type)    ---> core2
   forward_stream_traffic();
-  expect_on(mars, (atom::peer, filter_type, actor),
-            from(_).to(core2).with(_, filter_type{foo_master}, _));
+  expect_on(mars, (atom::peer, filter_type, actor, shard_layout),
+            from(_).to(core2).with(_, filter_type{foo_master}, _,
+                                   shard_layout{0}));
   // Step #2: core1  <---   (open_stream_msg)   <--- core2
   forward_stream_traffic();
   expect_on(earth, (open_stream_msg), from(_).to(core1));
@@ -0,0 +1,352 @@
+// This suite peers endpoints within the same process over real connections.
+// It checks that all transports behave like TCP and that handshakes reject
+// incompatible endpoints.
+#define SUITE peering
+
+#include "test.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <caf/send.hpp>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "broker/atoms.hh"
+#include "broker/config.hh"
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/endpoint.hh"
+#include "broker/error.hh"
+#include "broker/network_info.hh"
+#include "broker/status.hh"
+#include "broker/status_subscriber.hh"
+#include "broker/subscriber.hh"
+#include "broker/topic.hh"
+
+using namespace broker;
+
+namespace {
+
+configuration make_config(size_t core_shards = 1, size_t peer_stripes = 1) {
+  broker_options options;
+  options.disable_ssl = true;
+  configuration cfg{options};
+  cfg.parse(caf::test::engine::argc(), caf::test::engine::argv());
+  cfg.set("logger.inline-output", true);
+  if (core_shards > 1)
+    cfg.set("broker.core-shards", core_shards);
+  if (peer_stripes > 1)
+    cfg.set("broker.peer-stripes", peer_stripes);
+  return cfg;
+}
+
+// Waits for an error with code `code`, skipping all other events.
+bool await_error(status_subscriber& sub, ec code) {
+  for (;;) {
+    auto x = sub.get(to_duration(5));
+    if (!x)
+      return false;
+    if (auto err = caf::get_if<error>(&*x); err && *err == code)
+      return true;
+  }
+}
+
+// Waits for a status with code `code`, skipping all other events.
+bool await_status(status_subscriber& sub, sc code) {
+  for (;;) {
+    auto x = sub.get(to_duration(5));
+    if (!x)
+      return false;
+    if (auto st = caf::get_if<status>(&*x); st && st->code() == code)
+      return true;
+  }
+}
+
+// Lets each secondary shard of `ep` fail to unpeer from an unknown address
+// and waits for the resulting error at `sub`. Retries a few times, because the
+// status subscriber joins the error group asynchronously.
+bool await_shard_errors(endpoint& ep, status_subscriber& sub) {
+  auto& cores = ep.cores();
+  REQUIRE_GREATER(cores.size(), 1u);
+  for (size_t i = 1; i < cores.size(); ++i) {
+    auto received = false;
+    for (int attempt = 0; attempt < 10 && !received; ++attempt) {
+      caf::anon_send(cores[i], atom::unpeer::value,
+                     network_info{"127.0.0.1", 1});
+      auto x = sub.get(to_duration(0.5));
+      if (!x)
+        continue;
+      auto err = caf::get_if<error>(&*x);
+      received = err && *err == ec::peer_invalid;
+    }
+    if (!received)
+      return false;
+  }
+  return true;
+}
+
+// Waits until `ep` has no peers left.
+bool await_no_peers(endpoint& ep) {
+  for (int i = 0; i < 500; ++i) {
+    if (ep.peers().empty())
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+// Peers `client` with `server` by calling `peer`, exchanges data in both
+// directions and then unpeers by calling `unpeer`. Transports for endpoints
+// on the same host must produce the same events as TCP.
+template <class Peer, class Unpeer>
+void check_peering(endpoint& server, endpoint& client, Peer peer,
+                   Unpeer unpeer) {
+  auto server_es = server.make_status_subscriber(true);
+  auto client_es = client.make_status_subscriber(true);
+  auto server_sub = server.make_subscriber({"test/a"});
+  auto client_sub = client.make_subscriber({"test/b"});
+  MESSAGE("peer endpoints");
+  REQUIRE(peer());
+  CHECK(await_status(client_es, sc::peer_added));
+  CHECK(await_status(server_es, sc::peer_added));
+  CHECK_EQUAL(client.peers().size(), 1u);
+  while (client.peer_subscriptions().empty()
+         || server.peer_subscriptions().empty())
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  MESSAGE("only forward data that matches the filter of the peer");
+  client.publish("test/c", "dropped");
+  client.publish("test/a", "ping");
+  CHECK_EQUAL(server_sub.get(), data_message("test/a", "ping"));
+  server.publish("test/b", "pong");
+  CHECK_EQUAL(client_sub.get(), data_message("test/b", "pong"));
+  CHECK(server_sub.poll().empty());
+  CHECK(client_sub.poll().empty());
+  MESSAGE("unpeer endpoints");
+  REQUIRE(unpeer());
+  CHECK(await_status(client_es, sc::peer_removed));
+  CHECK(await_status(server_es, sc::peer_lost));
+  CHECK(await_no_peers(client));
+  CHECK(await_no_peers(server));
+}
+
+// Returns whether `path` names a Unix domain socket file.
+bool is_socket_file(const std::string& path) {
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+// Leaves a socket file at `path` behind without anyone listening on it, just
+// like a crashed process would.
+void make_stale_socket_file(const std::string& path) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  REQUIRE(path.size() < sizeof(addr.sun_path));
+  memcpy(addr.sun_path, path.data(), path.size());
+  auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  REQUIRE_NOT_EQUAL(fd, -1);
+  auto res = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  ::close(fd);
+  REQUIRE_EQUAL(res, 0);
+}
+
+std::string make_socket_path() {
+  return "/tmp/broker-test-" + std::to_string(getpid()) + ".sock";
+}
+
+} // namespace <anonymous>
+
+TEST(unsharded endpoints reject sharded peers) {
+  endpoint sharded{make_config(2)};
+  endpoint unsharded{make_config()};
+  auto sharded_es = sharded.make_status_subscriber(true);
+  auto unsharded_es = unsharded.make_status_subscriber(true);
+  auto port = unsharded.listen("127.0.0.1", 0);
+  REQUIRE_NOT_EQUAL(port, 0u);
+  CHECK(!sharded.peer("127.0.0.1", port, timeout::seconds(0)));
+  CHECK(await_error(sharded_es, ec::peer_incompatible));
+  CHECK(await_error(unsharded_es, ec::peer_incompatible));
+  CHECK(sharded.peers().empty());
+  CHECK(unsharded.peers().empty());
+  sharded.shutdown();
+  unsharded.shutdown();
+}
+
+TEST(sharded endpoints reject unsharded peers) {
+  endpoint sharded{make_config(2)};
+  endpoint unsharded{make_config()};
+  auto sharded_es = sharded.make_status_subscriber(true);
+  auto unsharded_es = unsharded.make_status_subscriber(true);
+  auto port = sharded.listen("127.0.0.1", 0);
+  REQUIRE_NOT_EQUAL(port, 0u);
+  CHECK(!unsharded.peer("127.0.0.1", port, timeout::seconds(0)));
+  CHECK(await_error(unsharded_es, ec::peer_incompatible));
+  CHECK(await_error(sharded_es, ec::peer_incompatible));
+  CHECK(sharded.peers().empty());
+  CHECK(unsharded.peers().empty());
+  sharded.shutdown();
+  unsharded.shutdown();
+}
+
+TEST(sharded endpoints deliver all topics to equally sharded peers) {
+  endpoint server{make_config(2)};
+  endpoint client{make_config(2)};
+  auto sub = server.make_subscriber({"test/shards"});
+  auto port = server.listen("127.0.0.1", 0);
+  REQUIRE_NOT_EQUAL(port, 0u);
+  REQUIRE(client.peer("127.0.0.1", port, timeout::seconds(0)));
+  CHECK_EQUAL(client.peers().size(), 1u);
+  while (client.peer_subscriptions().empty())
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  // Topics hash to different shards, so some of them must travel through
+  // the secondary shards.
+  for (count i = 0; i < 8; ++i)
+    client.publish("test/shards/" + std::to_string(i), i);
+  auto xs = sub.get(8, to_duration(5));
+  CHECK_EQUAL(xs.size(), 8u);
+  client.shutdown();
+  server.shutdown();
+}
+
+TEST(unstriped endpoints reject striped peers) {
+  endpoint striped{make_config(1, 2)};
+  endpoint unstriped{make_config(2)};
+  auto striped_es = striped.make_status_subscriber(true);
+  auto unstriped_es = unstriped.make_status_subscriber(true);
+  auto port = unstriped.listen("127.0.0.1", 0);
+  REQUIRE_NOT_EQUAL(port, 0u);
+  CHECK(!striped.peer("127.0.0.1", port, timeout::seconds(0)));
+  CHECK(await_error(striped_es, ec::peer_incompatible));
+  CHECK(await_error(unstriped_es, ec::peer_incompatible));
+  CHECK(striped.peers().empty());
+  CHECK(unstriped.peers().empty());
+  striped.shutdown();
+  unstriped.shutdown();
+}
+
+TEST(striped endpoints reject unstriped peers) {
+  endpoint striped{make_config(1, 2)};
+  endpoint unstriped{make_config(2)};
+  auto striped_es = striped.make_status_subscriber(true);
+  auto unstriped_es = unstriped.make_status_subscriber(true);
+  auto port = striped.listen("127.0.0.1", 0);
+  REQUIRE_NOT_EQUAL(port, 0u);
+  CHECK(!unstriped.peer("127.0.0.1", port, timeout::seconds(0)));
+  CHECK(await_error(unstriped_es, ec::peer_incompatible));
+  CHECK(await_error(striped_es, ec::peer_incompatible));
+  CHECK(striped.peers().empty());
+  CHECK(unstriped.peers().empty());
+  striped.shutdown();
+  unstriped.shutdown();
+}
+
+TEST(striped endpoints deliver all topics over a single peering) {
+  endpoint server{make_config(1, 2)};
+  endpoint client{make_config(1, 2)};
+  auto sub = server.make_subscriber({"test/stripes"});
+  auto port = server.listen("127.0.0.1", 0);
+  REQUIRE_NOT_EQUAL(port, 0u);
+  REQUIRE(client.peer("127.0.0.1", port, timeout::seconds(0)));
+  MESSAGE("stripes do not show up as peers of their own");
+  CHECK_EQUAL(client.peers().size(), 1u);
+  CHECK_EQUAL(server.peers().size(), 1u);
+  while (client.peer_subscriptions().empty())
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  MESSAGE("topics travel over the primary connection and the stripe");
+  for (count i = 0; i < 8; ++i)
+    client.publish("test/stripes/" + std::to_string(i), i);
+  auto xs = sub.get(8, to_duration(5));
+  CHECK_EQUAL(xs.size(), 8u);
+  client.shutdown();
+  server.shutdown();
+}
+
+TEST(errors of secondary shards reach status subscribers) {
+  endpoint ep{make_config(2)};
+  auto es = ep.make_status_subscriber();
+  CHECK(await_shard_errors(ep, es));
+  ep.shutdown();
+}
+
+TEST(errors of peer stripes reach status subscribers) {
+  endpoint ep{make_config(1, 2)};
+  auto es = ep.make_status_subscriber();
+  CHECK(await_shard_errors(ep, es));
+  ep.shutdown();
+}
+
+TEST(endpoints peer over unix domain sockets) {
+  auto path = make_socket_path();
+  make_stale_socket_file(path);
+  REQUIRE(is_socket_file(path));
+  {
+    endpoint server{make_config()};
+    endpoint client{make_config()};
+    MESSAGE("listen_unix replaces stale socket files");
+    REQUIRE(server.listen_unix(path));
+    check_peering(server, client,
+                  [&] { return client.peer_unix(path, timeout::seconds(0)); },
+                  [&] { return client.unpeer_unix(path); });
+    client.shutdown();
+    server.shutdown();
+  }
+  MESSAGE("closing the listening socket removes the socket file");
+  CHECK(!is_socket_file(path));
+}
+
+TEST(listen_unix leaves other files alone) {
+  auto path = make_socket_path();
+  auto fp = fopen(path.c_str(), "w");
+  REQUIRE(fp != nullptr);
+  fclose(fp);
+  {
+    endpoint ep{make_config()};
+    CHECK(!ep.listen_unix(path));
+    ep.shutdown();
+  }
+  struct stat st;
+  CHECK(lstat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode));
+  unlink(path.c_str());
+}
+
+TEST(local transports require disabling ssl) {
+  configuration cfg;
+  cfg.set("logger.inline-output", true);
+  endpoint ep{std::move(cfg)};
+  auto path = make_socket_path();
+  CHECK(!ep.listen_unix(path));
+  CHECK(!is_socket_file(path));
+  CHECK(!ep.peer_unix(path, timeout::seconds(0)));
+#ifdef BROKER_LINUX
+  auto addr = "shm://broker-test-" + std::to_string(getpid());
+  CHECK_EQUAL(ep.listen(addr, 4242), 0u);
+  CHECK(!ep.peer(addr, 4242, timeout::seconds(0)));
+#endif
+  ep.shutdown();
+}
+
+#ifdef BROKER_LINUX
+
+TEST(endpoints peer over shared memory) {
+  endpoint server{make_config()};
+  endpoint client{make_config()};
+  auto addr = "shm://broker-test-" + std::to_string(getpid());
+  uint16_t port = 4242;
+  REQUIRE_EQUAL(server.listen(addr, port), port);
+  check_peering(server, client,
+                [&] { return client.peer(addr, port, timeout::seconds(0)); },
+                [&] { return client.unpeer(addr, port); });
+  client.shutdown();
+  server.shutdown();
+}
+
+#endif // BROKER_LINUX
@@ -26,6 +26,7 @@
 #include "broker/filter_type.hh"
 #include "broker/message.hh"
 #include "broker/topic.hh"
+#include "broker/zeek.hh"
 
 using std::cout;
 using std::endl;
@@ -131,6 +132,94 @@ CAF_TEST(blocking_publishers) {
   anon_send_exit(leaf, exit_reason::user_shutdown);
 }
 
+CAF_TEST(batching_publishers) {
+  // Spawn/get/configure core actors.
+  broker_options options;
+  options.disable_ssl = true;
+  auto core1 = ep.core();
+  auto core2 = sys.spawn(core_actor, filter_type{"a"}, options, nullptr);
+  anon_send(core1, atom::subscribe::value, filter_type{"a"});
+  anon_send(core1, atom::no_events::value);
+  anon_send(core2, atom::no_events::value);
+  self->send(core1, atom::peer::value, core2);
+  auto leaf = sys.spawn(consumer, filter_type{"a"}, core2);
+  run();
+  using buf = std::vector<data_message>;
+  auto received = [&] {
+    buf result;
+    self->send(leaf, atom::get::value);
+    sched.prioritize(leaf);
+    consume_message();
+    self->receive([&](const buf& xs) { result = xs; });
+    return result;
+  };
+  // Runs all pending jobs without firing timeouts, i.e., without enforcing
+  // the maximum delay of a batch.
+  auto run_jobs = [&] {
+    while (sched.has_job())
+      sched.run();
+  };
+  batching_options opts;
+  opts.max_size = 3;
+  opts.max_delay = std::chrono::hours(1);
+  { // Lifetime scope of our publisher.
+    auto pub = ep.make_publisher("a", opts);
+    pub.drop_all_on_destruction();
+    run();
+    CAF_MESSAGE("the publisher holds back messages until the batch is full");
+    pub.publish(1);
+    pub.publish(2);
+    run_jobs();
+    CAF_CHECK_EQUAL(received(), buf{});
+    pub.publish(3);
+    run();
+    CAF_CHECK_EQUAL(received(), data_msgs({{"a", 1}, {"a", 2}, {"a", 3}}));
+    CAF_MESSAGE("flushing sends partial batches");
+    pub.publish(4);
+    pub.flush();
+    run();
+    CAF_CHECK_EQUAL(received(),
+                    data_msgs({{"a", 1}, {"a", 2}, {"a", 3}, {"a", 4}}));
+    CAF_MESSAGE("the publisher flushes partial batches after max_delay");
+    pub.publish(5);
+    run_jobs();
+    CAF_CHECK_EQUAL(received().size(), 4u);
+    run();
+    CAF_CHECK_EQUAL(received().size(), 5u);
+    CAF_CHECK_EQUAL(received().back(), data_message("a", 5));
+  }
+  CAF_MESSAGE("destroying a publisher sends its partial batch");
+  {
+    auto pub = ep.make_publisher("a", opts);
+    run();
+    pub.publish(6);
+    run_jobs();
+    CAF_CHECK_EQUAL(received().size(), 5u);
+  }
+  run();
+  CAF_CHECK_EQUAL(received().size(), 6u);
+  CAF_CHECK_EQUAL(received().back(), data_message("a", 6));
+  CAF_MESSAGE("zeek_batch wraps each batch into a single zeek::Batch");
+  {
+    opts.zeek_batch = true;
+    auto pub = ep.make_publisher("a", opts);
+    pub.drop_all_on_destruction();
+    run();
+    pub.publish({7, 8, 9});
+    run();
+    auto xs = received();
+    CAF_REQUIRE_EQUAL(xs.size(), 7u);
+    zeek::Batch batch{get_data(xs.back())};
+    CAF_CHECK(batch.valid());
+    CAF_CHECK_EQUAL(batch.batch(), (vector{7, 8, 9}));
+  }
+  // Shutdown.
+  CAF_MESSAGE("Shutdown core actors.");
+  anon_send_exit(core1, exit_reason::user_shutdown);
+  anon_send_exit(core2, exit_reason::user_shutdown);
+  anon_send_exit(leaf, exit_reason::user_shutdown);
+}
+
 CAF_TEST(nonblocking_publishers) {
   // Spawn/get/configure core actors.
   broker_options options;
@@ -5,17 +5,117 @@
 #include "test.hh"
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
+#include <caf/exit_reason.hpp>
+#include <caf/open_stream_msg.hpp>
+#include <caf/scoped_actor.hpp>
+#include <caf/send.hpp>
+#include <caf/system_messages.hpp>
+
+#include "broker/atoms.hh"
 #include "broker/backend.hh"
 #include "broker/backend_options.hh"
+#include "broker/configuration.hh"
 #include "broker/data.hh"
+#include "broker/detail/filesystem.hh"
+#include "broker/detail/sqlite_backend.hh"
 #include "broker/endpoint.hh"
 #include "broker/error.hh"
+#include "broker/internal_command.hh"
+#include "broker/optional.hh"
 
 using namespace broker;
 
+namespace {
+
+configuration make_config() {
+  broker_options options;
+  options.disable_ssl = true;
+  configuration cfg{options};
+  cfg.parse(caf::test::engine::argc(), caf::test::engine::argv());
+  cfg.set("logger.inline-output", true);
+  return cfg;
+}
+
+// Peers `client` with `server` over TCP.
+void peer_endpoints(endpoint& server, endpoint& client) {
+  auto port = server.listen("127.0.0.1", 0);
+  REQUIRE_NOT_EQUAL(port, 0u);
+  REQUIRE(client.peer("127.0.0.1", port, timeout::seconds(0)));
+}
+
+// Waits until `ds` maps `key` to `value`.
+bool await_value(const store& ds, const data& key, const data& value) {
+  for (int i = 0; i < 500; ++i) {
+    if (auto x = ds.get(key); x && *x == value)
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+// Plays a clone on `ep` that reconnects to the master `name` after applying
+// all updates up to `last_seq`. The master may run on a peer of `ep`.
+// @returns the sequence numbers of the updates that the master sends instead
+//          of a snapshot or `nil` if the master streams a snapshot.
+optional<std::vector<uint64_t>> resync(endpoint& ep, const std::string& name,
+                                       uint64_t last_seq) {
+  caf::scoped_actor self{ep.system()};
+  self->send(ep.core(), atom::store::value, atom::master::value,
+             atom::snapshot::value, name, caf::actor_cast<caf::actor>(self),
+             last_seq);
+  optional<std::vector<uint64_t>> result;
+  self->receive(
+    [&](atom::update, std::vector<internal_command>& xs) {
+      std::vector<uint64_t> seqs;
+      for (auto& x : xs)
+        seqs.emplace_back(x.seq);
+      result = std::move(seqs);
+    },
+    [&](caf::open_stream_msg&) {
+      // nop
+    },
+    caf::after(std::chrono::seconds(5)) >> [] {
+      FAIL("master neither sent updates nor a snapshot");
+    }
+  );
+  return result;
+}
+
+// Attaches a clone on `client` to a master on `server` with enough content
+// for streaming the snapshot in many chunks and pushes to a vector while
+// the snapshot is still on its way.
+void check_updates_during_snapshot(endpoint& server, endpoint& client,
+                                   backend type = memory,
+                                   backend_options opts = {}) {
+  auto m = server.attach_master("mercury", type, std::move(opts));
+  REQUIRE(m);
+  for (count i = 0; i < 10000; ++i)
+    m->put(i, i);
+  m->put("log", vector{});
+  REQUIRE_EQUAL(value_of(m->get("log")), data(vector{}));
+  peer_endpoints(server, client);
+  auto c = client.attach_clone("mercury", 0.1);
+  REQUIRE(c);
+  vector xs;
+  for (count i = 0; i < 100; ++i) {
+    m->push("log", i);
+    xs.emplace_back(i);
+  }
+  MESSAGE("the master reads its own writes");
+  CHECK_EQUAL(value_of(m->get("log")), data(xs));
+  CHECK(await_value(*c, "log", data(xs)));
+  CHECK(await_value(*c, count{9999}, data{count{9999}}));
+}
+
+} // namespace <anonymous>
+
 TEST(default construction) {
   store{};
   store::proxy{};
@@ -105,6 +205,21 @@ TEST(expiration) {
   CHECK_EQUAL(error_of(m->get("foo")), ec::no_such_key);
 }
 
+TEST(updates without expiry cancel previous expiries) {
+  using std::chrono::milliseconds;
+  endpoint ep;
+  auto m = ep.attach_master("dusty", memory);
+  REQUIRE(m);
+  auto expiry = milliseconds(200);
+  m->put("foo", 42, expiry);
+  m->put("foo", 23);
+  m->increment("bar", 1u, expiry);
+  m->increment("bar", 1u);
+  std::this_thread::sleep_for(milliseconds(600));
+  CHECK_EQUAL(value_of(m->get("foo")), data{23});
+  CHECK_EQUAL(value_of(m->get("bar")), data{2u});
+}
+
 TEST(proxy) {
   endpoint ep;
   auto m = ep.attach_master("puneta", memory);
@@ -130,3 +245,177 @@ TEST(proxy) {
   CAF_REQUIRE_EQUAL(key_resp.id, key_id);
   CAF_REQUIRE_EQUAL(value_of(key_resp.answer), data(set{"foo"}));
 }
+
+TEST(clones receive updates during snapshots in order) {
+  endpoint server{make_config()};
+  endpoint client{make_config()};
+  check_updates_during_snapshot(server, client);
+}
+
+TEST(clones receive updates during sqlite snapshots in order) {
+  // SQLite cursors read from the live database, so the master holds back
+  // updates while streaming.
+  auto path = std::string{"/tmp/broker-unit-test-sqlite-snapshots"};
+  detail::remove_all(path);
+  {
+    endpoint server{make_config()};
+    endpoint client{make_config()};
+    check_updates_during_snapshot(server, client, sqlite,
+                                  {{"path", path},
+                                   {"synchronous", std::string{"off"}}});
+    client.shutdown();
+    server.shutdown();
+  }
+  detail::remove_all(path);
+}
+
+TEST(clones receive updates after masters detach snapshots) {
+  // Force the master to copy the remainder of the snapshot into memory
+  // after holding back a handful of updates.
+  auto path = std::string{"/tmp/broker-unit-test-detached-snapshots"};
+  detail::remove_all(path);
+  {
+    auto cfg = make_config();
+    cfg.set("broker.snapshot-pending-updates", size_t{10});
+    endpoint server{std::move(cfg)};
+    endpoint client{make_config()};
+    check_updates_during_snapshot(server, client, sqlite,
+                                  {{"path", path},
+                                   {"synchronous", std::string{"off"}}});
+    client.shutdown();
+    server.shutdown();
+  }
+  detail::remove_all(path);
+}
+
+TEST(masters resync clones from the command log) {
+  endpoint ep;
+  auto m = ep.attach_master("venus", memory);
+  REQUIRE(m);
+  for (count i = 1; i <= 5; ++i)
+    m->put("key", i);
+  REQUIRE_EQUAL(value_of(m->get("key")), data{count{5}});
+  MESSAGE("a clone within the log receives only the missed updates");
+  auto seqs = resync(ep, "venus", 3);
+  REQUIRE(seqs);
+  CHECK_EQUAL(*seqs, (std::vector<uint64_t>{4, 5}));
+  MESSAGE("an up-to-date clone receives no updates");
+  seqs = resync(ep, "venus", 5);
+  REQUIRE(seqs);
+  CHECK(seqs->empty());
+}
+
+TEST(masters resync clones on other endpoints) {
+  endpoint server{make_config()};
+  endpoint client{make_config()};
+  auto m = server.attach_master("vulcan", memory);
+  REQUIRE(m);
+  for (count i = 1; i <= 5; ++i)
+    m->put("key", i);
+  REQUIRE_EQUAL(value_of(m->get("key")), data{count{5}});
+  peer_endpoints(server, client);
+  while (client.peer_subscriptions().empty())
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  MESSAGE("the master sends the missed updates over the network");
+  auto seqs = resync(client, "vulcan", 3);
+  REQUIRE(seqs);
+  CHECK_EQUAL(*seqs, (std::vector<uint64_t>{4, 5}));
+  client.shutdown();
+  server.shutdown();
+}
+
+TEST(masters stream snapshots once the command log rolled over) {
+  auto cfg = make_config();
+  cfg.set("broker.command-log-size", size_t{2});
+  endpoint ep{std::move(cfg)};
+  auto m = ep.attach_master("vesta", memory);
+  REQUIRE(m);
+  for (count i = 1; i <= 5; ++i)
+    m->put("key", i);
+  REQUIRE_EQUAL(value_of(m->get("key")), data{count{5}});
+  MESSAGE("the log still covers all updates after 3");
+  CHECK(resync(ep, "vesta", 3));
+  MESSAGE("the log lost the update with sequence number 2");
+  CHECK(!resync(ep, "vesta", 1));
+  MESSAGE("sequence numbers from another master trigger a snapshot");
+  CHECK(!resync(ep, "vesta", 42));
+}
+
+TEST(clones catch up after losing their master briefly) {
+  endpoint server{make_config()};
+  endpoint client{make_config()};
+  auto m = server.attach_master("juno", memory);
+  REQUIRE(m);
+  peer_endpoints(server, client);
+  auto c = client.attach_clone("juno", 0.1);
+  REQUIRE(c);
+  m->put("key", count{1});
+  CHECK(await_value(*c, "key", data{count{1}}));
+  MESSAGE("pretend that the clone lost its master");
+  caf::anon_send(c->frontend(),
+                 caf::down_msg{m->frontend().address(),
+                               caf::exit_reason::remote_link_unreachable});
+  for (count i = 2; i <= 5; ++i)
+    m->put("key", i);
+  CHECK(await_value(*c, "key", data{count{5}}));
+}
+
+TEST(clones request a snapshot from a new master) {
+  endpoint old_server{make_config()};
+  endpoint new_server{make_config()};
+  endpoint client{make_config()};
+  auto m1 = old_server.attach_master("ceres", memory);
+  REQUIRE(m1);
+  m1->put("old", count{1});
+  peer_endpoints(old_server, client);
+  auto c = client.attach_clone("ceres", 0.1);
+  REQUIRE(c);
+  CHECK(await_value(*c, "old", data{count{1}}));
+  MESSAGE("replace the master with one on another endpoint");
+  // The command log of the new master covers the sequence number of the
+  // clone. Presenting it would make the master send updates 2 to 5 only.
+  auto m2 = new_server.attach_master("ceres", memory);
+  REQUIRE(m2);
+  for (count i = 1; i <= 5; ++i)
+    m2->put("new", i);
+  old_server.shutdown();
+  peer_endpoints(new_server, client);
+  CHECK(await_value(*c, "new", data{count{5}}));
+  MESSAGE("the snapshot from the new master drops keys of the old one");
+  CHECK_EQUAL(error_of(c->get("old")), ec::no_such_key);
+  client.shutdown();
+  new_server.shutdown();
+}
+
+TEST(masters group commits into sqlite) {
+  auto path = std::string{"/tmp/broker-unit-test-group-commit"};
+  detail::remove_all(path);
+  {
+    auto cfg = make_config();
+    cfg.set("broker.group-commit-size", size_t{10});
+    endpoint ep{std::move(cfg)};
+    auto m = ep.attach_master("sqlite-group-commit", sqlite,
+                              backend_options{{"path", path}});
+    REQUIRE(m);
+    // Opening the database writes to it, so we do that before the master
+    // holds a transaction open.
+    detail::sqlite_backend reader{backend_options{{"path", path}}};
+    for (count i = 0; i < 25; ++i)
+      m->put(i, i);
+    MESSAGE("the master sees its own uncommitted updates");
+    CHECK_EQUAL(value_of(m->get(count{24})), data{count{24}});
+    MESSAGE("the master commits the last partial group after the interval");
+    auto committed = [&] {
+      for (int i = 0; i < 500; ++i) {
+        if (auto n = reader.size(); n && *n == 25)
+          return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      return false;
+    };
+    CHECK(committed());
+    CHECK_EQUAL(value_of(reader.get(count{24})), data{count{24}});
+    ep.shutdown();
+  }
+  detail::remove_all(path);
+}
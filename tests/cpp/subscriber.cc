@@ -21,6 +21,7 @@
 #include "broker/endpoint.hh"
 #include "broker/filter_type.hh"
 #include "broker/message.hh"
+#include "broker/publisher.hh"
 #include "broker/topic.hh"
 
 using std::cout;
@@ -55,6 +56,18 @@ void driver(event_based_actor* self, const actor& sink) {
     [](const buf_type& xs) { return xs.empty(); });
 }
 
+struct local_delivery_fixture : base_fixture {
+  local_delivery_fixture() : base_fixture(make_config()) {
+    // nop
+  }
+
+  static configuration make_config() {
+    auto cfg = base_fixture::make_config();
+    cfg.set("broker.local-delivery", true);
+    return cfg;
+  }
+};
+
 } // namespace <anonymous>
 
 CAF_TEST_FIXTURE_SCOPE(subscriber_tests, base_fixture)
@@ -137,3 +150,45 @@ CAF_TEST(nonblocking_subscriber) {
 }
 
 CAF_TEST_FIXTURE_SCOPE_END()
+
+CAF_TEST_FIXTURE_SCOPE(local_delivery_tests, local_delivery_fixture)
+
+CAF_TEST(local_subscribers_receive_local_publications_once) {
+  CAF_REQUIRE(ep.local_dispatcher() != nullptr);
+  auto sub = ep.make_subscriber({"a"});
+  sub.set_rate_calculation(false);
+  auto pub = ep.make_publisher("a");
+  run();
+  ep.publish("a", data{1});
+  pub.publish(data{2});
+  ep.publish("b", data{3});
+  // Give the core every chance to deliver a second copy.
+  run();
+  CAF_CHECK_EQUAL(sub.poll(), data_msgs({{"a", 1}, {"a", 2}}));
+  run();
+  CAF_CHECK_EQUAL(sub.available(), 0u);
+}
+
+CAF_TEST(local_delivery_follows_filter_changes) {
+  auto sub = ep.make_subscriber({"a"});
+  sub.set_rate_calculation(false);
+  auto pub = ep.make_publisher("a");
+  run();
+  CAF_MESSAGE("removed topics stop local delivery");
+  sub.remove_topic("a", false);
+  run();
+  ep.publish("a", data{1});
+  pub.publish(data{2});
+  run();
+  CAF_CHECK_EQUAL(sub.available(), 0u);
+  CAF_MESSAGE("added topics start local delivery");
+  sub.add_topic("b", false);
+  sub.add_topic("a", false);
+  run();
+  ep.publish("b", data{3});
+  pub.publish(data{4});
+  run();
+  CAF_CHECK_EQUAL(sub.poll(), data_msgs({{"b", 3}, {"a", 4}}));
+}
+
+CAF_TEST_FIXTURE_SCOPE_END()
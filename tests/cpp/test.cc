@@ -11,8 +11,12 @@
 using namespace caf;
 using namespace broker;
 
-base_fixture::base_fixture()
-  : ep(make_config()),
+base_fixture::base_fixture() : base_fixture(make_config()) {
+  // nop
+}
+
+base_fixture::base_fixture(configuration cfg)
+  : ep(std::move(cfg)),
     sys(ep.system()),
     self(sys),
     sched(dynamic_cast<scheduler_type&>(sys.scheduler())),
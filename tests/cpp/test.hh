@@ -57,6 +57,8 @@ public:
 
   base_fixture();
 
+  explicit base_fixture(broker::configuration cfg);
+
   virtual ~base_fixture();
 
   broker::endpoint ep;
@@ -69,7 +71,7 @@ public:
 
   void consume_message();
 
-private:
+protected:
   static broker::configuration make_config();
 };
 
@@ -4,6 +4,8 @@
 
 #include "test.hh"
 
+#include "broker/detail/topic_table.hh"
+
 using namespace broker;
 
 namespace {
@@ -99,3 +101,30 @@ TEST(prefix) {
   CAF_CHECK( t5.prefix_of(t4));
   CAF_CHECK( t5.prefix_of(t5));
 }
+
+TEST(interning) {
+  auto t0 = "zeek/events"_t;
+  auto t1 = topic{"zeek"} / "events";
+  auto t2 = "zeek/logs"_t;
+  CAF_REQUIRE(t0.interned() != nullptr);
+  CAF_CHECK(t0.interned() == t1.interned());
+  CAF_CHECK(t0.interned() != t2.interned());
+  CAF_CHECK_EQUAL(t0.interned()->str, "zeek/events");
+  CAF_CHECK_EQUAL(t0.hash(), std::hash<std::string>{}("zeek/events"));
+  // Copies share the cached entry, modifications reset it.
+  auto t3 = t0;
+  CAF_CHECK(t3.interned() == t0.interned());
+  t3 /= "foo";
+  CAF_CHECK(t3.interned() != t0.interned());
+  CAF_CHECK_EQUAL(t3.interned()->str, "zeek/events/foo");
+}
+
+TEST(flags) {
+  auto master = "foo"_t / topics::master_suffix;
+  auto clone = "foo"_t / topics::clone_suffix;
+  CAF_CHECK(master.is_master_topic());
+  CAF_CHECK(!master.is_clone_topic());
+  CAF_CHECK(clone.is_clone_topic());
+  CAF_CHECK(!clone.is_master_topic());
+  CAF_CHECK(!"foo/data/clone"_t.is_clone_topic());
+}
@@ -7,6 +7,7 @@
 
 #include "test.hh"
 
+#include <string>
 #include <utility>
 
 #include "broker/data.hh"
@@ -20,3 +21,105 @@ TEST(event) {
   CHECK_EQUAL(ev2.name(), "test");
   CHECK_EQUAL(ev2.args(), args);
 }
+
+namespace {
+
+address make_address(const std::string& str) {
+  address result;
+  convert(str, result);
+  return result;
+}
+
+vector make_records(size_t n) {
+  vector result;
+  for (size_t i = 0; i < n; ++i) {
+    data service = i % 3 == 0 ? data{} : data{i % 2 == 0 ? "http" : "dns"};
+    result.emplace_back(vector{
+      timestamp{timespan{static_cast<integer>(1564000000000000000 + i)}},
+      "C" + std::to_string(i), make_address("10.0.0." + std::to_string(i)),
+      port{static_cast<port::number_type>(i), port::protocol::tcp},
+      make_address("2001:db8::1"), enum_value{"tcp"}, std::move(service),
+      count{i}, integer{-static_cast<integer>(i)}, real{0.5}, timespan{42},
+      i % 2 == 0, i % 2 == 0 ? data{count{i}} : data{"mixed"}});
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(log write batches restore their records) {
+  auto records = make_records(10);
+  zeek::LogWriteBatch batch(enum_value{"Conn::LOG"}, enum_value{"ASCII"},
+                            "conn", records);
+  CHECK(batch.valid());
+  CHECK_EQUAL(batch.size(), 10u);
+  CHECK_EQUAL(batch.columns().size(), 13u);
+  zeek::LogWriteBatch copy(batch.as_data());
+  CHECK(copy.type() == zeek::Message::Type::LogWriteBatch);
+  vector decoded;
+  REQUIRE(copy.decode(decoded));
+  CHECK_EQUAL(decoded, records);
+  auto writes = copy.unbatch();
+  REQUIRE_EQUAL(writes.size(), 10u);
+  CHECK_EQUAL(writes[3].stream_id(), enum_value{"Conn::LOG"});
+  CHECK_EQUAL(writes[3].path(), data{"conn"});
+  CHECK_EQUAL(writes[3].serial_data(), records[3]);
+}
+
+TEST(log write batches store strings in a dictionary) {
+  zeek::LogWriteBatch batch(enum_value{"Conn::LOG"}, enum_value{"ASCII"},
+                            "conn", make_records(100));
+  auto& proto = get<vector>(batch.columns()[5]);
+  CHECK_EQUAL(get<count>(proto[0]), count{zeek::LogWriteBatch::Enum});
+  CHECK_EQUAL(get<vector>(get<vector>(proto[2])[0]).size(), 1u);
+  auto& mixed = get<vector>(batch.columns()[12]);
+  CHECK_EQUAL(get<count>(mixed[0]), count{zeek::LogWriteBatch::Generic});
+}
+
+TEST(malformed log write batches are rejected) {
+  auto records = make_records(2);
+  zeek::LogWriteBatch batch(enum_value{"Conn::LOG"}, enum_value{"ASCII"},
+                            "conn", records);
+  vector decoded;
+  auto& fields = get<vector>(batch.as_vector()[2]);
+  fields[3] = count{1000000000};
+  CHECK(!batch.decode(decoded));
+  fields[3] = count{3};
+  CHECK(!batch.decode(decoded));
+}
+
+TEST(log write batches reject records of different shapes) {
+  auto records = make_records(3);
+  MESSAGE("records must be vectors");
+  auto not_a_vector = records;
+  not_a_vector[1] = "oops";
+  CHECK(zeek::LogWriteBatch::encode(not_a_vector).empty());
+  zeek::LogWriteBatch batch(enum_value{"Conn::LOG"}, enum_value{"ASCII"},
+                            "conn", not_a_vector);
+  vector decoded;
+  CHECK(!batch.decode(decoded));
+  CHECK(batch.unbatch().empty());
+  MESSAGE("records must have the same number of fields");
+  auto too_short = records;
+  get<vector>(too_short[2]).pop_back();
+  CHECK(zeek::LogWriteBatch::encode(too_short).empty());
+  auto too_long = records;
+  get<vector>(too_long[2]).emplace_back(count{1});
+  CHECK(zeek::LogWriteBatch::encode(too_long).empty());
+}
+
+TEST(log write batches check all columns before allocating) {
+  auto records = make_records(2);
+  zeek::LogWriteBatch batch(enum_value{"Conn::LOG"}, enum_value{"ASCII"},
+                            "conn", records);
+  auto& fields = get<vector>(batch.as_vector()[2]);
+  auto& cols = get<vector>(fields[4]);
+  // The first column remains plausible for many records while a later
+  // column claims far fewer.
+  cols[0] = vector{count{zeek::LogWriteBatch::Generic}, std::string{},
+                   vector(1000000, data{count{1}})};
+  fields[3] = count{1000000};
+  vector decoded;
+  CHECK(!batch.decode(decoded));
+  CHECK(decoded.empty());
+}
@@ -87,6 +87,34 @@ class TestCommunication(unittest.TestCase):
         ep1.shutdown()
         ep2.shutdown()
 
+    def test_subscriber_buffer(self):
+        ep1 = broker.Endpoint()
+        ep2 = broker.Endpoint()
+        s1 = ep1.make_subscriber("/test")
+        port = ep1.listen("127.0.0.1", 0)
+        ep2.peer("127.0.0.1", port, 1.0)
+
+        buf = broker.SubscriberBuffer()
+        ep2.publish_batch(("/test", (1, 2)), ("/test", "foo"))
+        self.assertEqual(s1.get_into(buf, 2), 2)
+        self.assertEqual(list(buf), [("/test", (1, 2)), ("/test", "foo")])
+
+        # The subscriber replaces the content when reusing the buffer.
+        ep2.publish("/test", 42)
+        self.assertEqual(s1.get_into(buf, 1), 1)
+        self.assertEqual(buf[0], ("/test", 42))
+        self.assertEqual(s1.get_into(buf, 1, 0.1), 0)
+        self.assertEqual(len(buf), 0)
+
+        ep2.publish("/test", "bar")
+        while not s1.available():
+            time.sleep(0.01)
+        self.assertEqual(s1.poll_into(buf), 1)
+        self.assertEqual(buf[-1], ("/test", "bar"))
+
+        ep1.shutdown()
+        ep2.shutdown()
+
     def test_status_subscriber(self):
         # --status-start
         ep1 = broker.Endpoint()